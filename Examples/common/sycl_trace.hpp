@@ -0,0 +1,310 @@
+#pragma once
+#include <CL/sycl.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+// shared instrumentation for the examples
+// Tracer wraps queue::submit and keeps, for every command, the host time spent in submit and the event,
+// whose command_submit, command_start, and command_end are read when the trace is written
+// waits and other host work can be recorded as host ranges, so one timeline shows host overhead, queue gaps,
+// and commands of several queues overlapping
+// write_chrome_trace writes the JSON trace event format, open it in chrome://tracing or ui.perfetto.dev,
+// print_summary prints a table per command name, every time in it is in milliseconds
+// device times come from event profiling, so the queues need property::queue::enable_profiling,
+// commands on queues without it appear only with their host submit time
+// device timestamps are in the device's clock, they are moved onto the host clock per queue with the offset that puts
+// every command_submit inside the host call that submitted it, so host and device rows line up to within a submit latency
+class Tracer {
+public:
+	Tracer() : origin(now()) {}
+
+	// a host range that is recorded when it goes out of scope
+	class HostRange {
+	public:
+		HostRange(Tracer& tracer, std::string name, std::string category)
+			: tracer(tracer), name(std::move(name)), category(std::move(category)), begin(Tracer::now()) {}
+		~HostRange() { tracer.add_host(name, category, begin, Tracer::now()); }
+		HostRange(const HostRange&) = delete;
+		HostRange& operator=(const HostRange&) = delete;
+
+	private:
+		Tracer& tracer;
+		std::string name;
+		std::string category;
+		uint64_t begin;
+	};
+
+	// submit a command group and record it under name
+	template <typename CommandGroup>
+	cl::sycl::event submit(cl::sycl::queue& deviceQueue, const std::string& name, CommandGroup&& commandGroup) {
+		uint64_t begin = now();
+		cl::sycl::event commandEvent = deviceQueue.submit(std::forward<CommandGroup>(commandGroup));
+		add_command(deviceQueue, name, commandEvent, begin, now());
+		return commandEvent;
+	}
+
+	// record the command behind the event a function returns, for code that submits on its own (a kernel function,
+	// queue::memcpy), the host time is the time spent in the function
+	template <typename Submit>
+	cl::sycl::event record(cl::sycl::queue& deviceQueue, const std::string& name, Submit&& submitFunction) {
+		uint64_t begin = now();
+		cl::sycl::event commandEvent = submitFunction();
+		add_command(deviceQueue, name, commandEvent, begin, now());
+		return commandEvent;
+	}
+
+	// wait for an event or a whole queue and record the time the host was blocked
+	void wait(cl::sycl::event& commandEvent, const std::string& name) {
+		HostRange range(*this, name, "wait");
+		commandEvent.wait();
+	}
+
+	void wait(cl::sycl::queue& deviceQueue, const std::string& name) {
+		HostRange range(*this, name, "wait");
+		deviceQueue.wait();
+	}
+
+	// time host work under name: auto range = tracer.host("pack panels");
+	HostRange host(const std::string& name) {
+		return HostRange(*this, name, "host");
+	}
+
+	// write the Chrome trace event JSON, waits for every recorded command
+	bool write_chrome_trace(const std::string& path) {
+		std::vector<Resolved> commands = resolve();
+		std::ofstream file(path);
+		if (!file) {
+			return false;
+		}
+		std::lock_guard<std::mutex> lock(traceMutex);
+		file << std::fixed << std::setprecision(3) << "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [\n";
+		file << "  {\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 0, \"args\": {\"name\": \"host\"}}";
+		file << ",\n  {\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 1, \"args\": {\"name\": \"devices\"}}";
+		for (size_t lane = 0; lane < lanes.size(); lane++) {
+			file << ",\n  {\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << lane << ", \"args\": {\"name\": \"queue " << lane << ": "
+				<< escape(lanes[lane].get_device().get_info<cl::sycl::info::device::name>()) << "\"}}";
+		}
+
+		auto span = [&](const std::string& name, const std::string& category, int pid, size_t tid, uint64_t begin, uint64_t end) {
+			file << ",\n  {\"name\": \"" << escape(name) << "\", \"cat\": \"" << category << "\", \"ph\": \"X\", \"pid\": " << pid
+				<< ", \"tid\": " << tid << ", \"ts\": " << micros(begin) << ", \"dur\": " << (end - begin) / 1.0e3;
+		};
+		for (auto& command : commands) {
+			// the host row shows the submit call, the queue row the command itself, with its time waiting in the queue
+			span("submit " + command.name, "submit", 0, 0, command.hostBegin, command.hostEnd);
+			file << "}";
+			if (command.profiled) {
+				span(command.name, "command", 1, command.lane, command.start, command.end);
+				file << ", \"args\": {\"queued ms\": " << (command.start > command.submit ? command.start - command.submit : 0) / 1.0e6
+					<< ", \"submit latency ms\": " << (command.hostEnd - command.hostBegin) / 1.0e6 << "}}";
+			}
+		}
+		for (auto& range : hostRanges) {
+			span(range.name, range.category, 0, 0, range.begin, range.end);
+			file << "}";
+		}
+		file << "\n]}\n";
+		return static_cast<bool>(file);
+	}
+
+	// print per command name: count, device time, time waiting in the queue, and host submit time,
+	// then the host waits, and for the device timeline the busy time, the gaps, and the time commands overlapped
+	void print_summary(std::ostream& out = std::cout) {
+		std::vector<Resolved> commands = resolve();
+		std::lock_guard<std::mutex> lock(traceMutex);
+		std::ios_base::fmtflags flags = out.flags();
+		std::streamsize precision = out.precision();
+
+		struct Totals {
+			size_t count = 0;
+			size_t profiled = 0;
+			double device = 0.0;
+			double deviceMin = 0.0;
+			double deviceMax = 0.0;
+			double queued = 0.0;
+			double submit = 0.0;
+		};
+		std::map<std::string, Totals> byName;
+		std::vector<std::pair<uint64_t, uint64_t>> intervals;
+		for (auto& command : commands) {
+			Totals& totals = byName[command.name];
+			totals.count++;
+			totals.submit += (command.hostEnd - command.hostBegin) / 1.0e6;
+			if (command.profiled) {
+				double device = (command.end - command.start) / 1.0e6;
+				totals.deviceMin = totals.profiled == 0 ? device : std::min(totals.deviceMin, device);
+				totals.deviceMax = std::max(totals.deviceMax, device);
+				totals.device += device;
+				totals.queued += (command.start > command.submit ? command.start - command.submit : 0) / 1.0e6;
+				totals.profiled++;
+				intervals.push_back({ command.start, command.end });
+			}
+		}
+
+		out << std::fixed << std::setprecision(3)
+			<< std::left << std::setw(28) << "command" << std::right << std::setw(8) << "count" << std::setw(14) << "device total"
+			<< std::setw(12) << "mean" << std::setw(12) << "min" << std::setw(12) << "max" << std::setw(14) << "queued mean"
+			<< std::setw(14) << "submit mean" << "   (ms)\n";
+		for (auto& [name, totals] : byName) {
+			out << std::left << std::setw(28) << name << std::right << std::setw(8) << totals.count;
+			if (totals.profiled > 0) {
+				out << std::setw(14) << totals.device << std::setw(12) << totals.device / totals.profiled << std::setw(12) << totals.deviceMin
+					<< std::setw(12) << totals.deviceMax << std::setw(14) << totals.queued / totals.profiled;
+			}
+			else {
+				out << std::setw(14) << "-" << std::setw(12) << "-" << std::setw(12) << "-" << std::setw(12) << "-" << std::setw(14) << "-";
+			}
+			out << std::setw(14) << totals.submit / totals.count << "\n";
+		}
+
+		std::map<std::string, std::pair<size_t, double>> waits;
+		for (auto& range : hostRanges) {
+			if (range.category == "wait") {
+				waits[range.name].first++;
+				waits[range.name].second += (range.end - range.begin) / 1.0e6;
+			}
+		}
+		for (auto& [name, wait] : waits) {
+			out << "host wait " << name << ": " << wait.first << " waits, " << wait.second << " ms\n";
+		}
+
+		// busy is the union of the command intervals of all queues, overlap is what the commands add up to beyond it
+		if (!intervals.empty()) {
+			std::sort(intervals.begin(), intervals.end());
+			uint64_t busy = 0;
+			uint64_t total = 0;
+			uint64_t runBegin = intervals.front().first;
+			uint64_t runEnd = intervals.front().second;
+			for (auto& [begin, end] : intervals) {
+				total += end - begin;
+				if (begin > runEnd) {
+					busy += runEnd - runBegin;
+					runBegin = begin;
+				}
+				runEnd = std::max(runEnd, end);
+			}
+			busy += runEnd - runBegin;
+			uint64_t span = runEnd - intervals.front().first;
+			out << "device timeline: span " << span / 1.0e6 << " ms, busy " << busy / 1.0e6 << " ms, gaps " << (span - busy) / 1.0e6
+				<< " ms, overlapped " << (total - busy) / 1.0e6 << " ms\n";
+		}
+		out.flags(flags);
+		out.precision(precision);
+	}
+
+	// forget everything recorded so far, for example the warmup iterations
+	void clear() {
+		std::lock_guard<std::mutex> lock(traceMutex);
+		commands.clear();
+		hostRanges.clear();
+	}
+
+private:
+	struct Command {
+		std::string name;
+		size_t lane;
+		cl::sycl::event commandEvent;
+		uint64_t hostBegin;
+		uint64_t hostEnd;
+		bool profiled;
+	};
+
+	struct Range {
+		std::string name;
+		std::string category;
+		uint64_t begin;
+		uint64_t end;
+	};
+
+	// a command with every time on the host clock, in nanoseconds
+	struct Resolved {
+		std::string name;
+		size_t lane;
+		uint64_t hostBegin;
+		uint64_t hostEnd;
+		bool profiled;
+		uint64_t submit;
+		uint64_t start;
+		uint64_t end;
+	};
+
+	static uint64_t now() {
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	double micros(uint64_t time) const {
+		return (static_cast<double>(time) - static_cast<double>(origin)) / 1.0e3;
+	}
+
+	static std::string escape(const std::string& text) {
+		std::string escaped;
+		for (char c : text) {
+			if (c == '"' || c == '\\') {
+				escaped += '\\';
+			}
+			escaped += (c == '\n' || c == '\t') ? ' ' : c;
+		}
+		return escaped;
+	}
+
+	void add_command(cl::sycl::queue& deviceQueue, const std::string& name, const cl::sycl::event& commandEvent, uint64_t begin, uint64_t end) {
+		std::lock_guard<std::mutex> lock(traceMutex);
+		size_t lane = 0;
+		while (lane < lanes.size() && !(lanes[lane] == deviceQueue)) {
+			lane++;
+		}
+		if (lane == lanes.size()) {
+			lanes.push_back(deviceQueue);
+		}
+		bool profiled = deviceQueue.has_property<cl::sycl::property::queue::enable_profiling>();
+		commands.push_back({ name, lane, commandEvent, begin, end, profiled });
+	}
+
+	void add_host(const std::string& name, const std::string& category, uint64_t begin, uint64_t end) {
+		std::lock_guard<std::mutex> lock(traceMutex);
+		hostRanges.push_back({ name, category, begin, end });
+	}
+
+	// wait for every command, read its profile, and move the device times onto the host clock
+	std::vector<Resolved> resolve() {
+		std::lock_guard<std::mutex> lock(traceMutex);
+		std::vector<Resolved> resolved;
+		// offset per queue: the smallest shift that puts every command_submit at or after the start of its submit call
+		std::vector<int64_t> offsets(lanes.size(), INT64_MIN);
+		for (auto& command : commands) {
+			Resolved entry{ command.name, command.lane, command.hostBegin, command.hostEnd, command.profiled, 0, 0, 0 };
+			if (command.profiled) {
+				command.commandEvent.wait();
+				entry.submit = command.commandEvent.get_profiling_info<cl::sycl::info::event_profiling::command_submit>();
+				entry.start = command.commandEvent.get_profiling_info<cl::sycl::info::event_profiling::command_start>();
+				entry.end = command.commandEvent.get_profiling_info<cl::sycl::info::event_profiling::command_end>();
+				offsets[command.lane] = std::max(offsets[command.lane], static_cast<int64_t>(command.hostBegin) - static_cast<int64_t>(entry.submit));
+			}
+			resolved.push_back(entry);
+		}
+		for (auto& entry : resolved) {
+			if (entry.profiled) {
+				int64_t offset = offsets[entry.lane];
+				entry.submit = static_cast<uint64_t>(static_cast<int64_t>(entry.submit) + offset);
+				entry.start = static_cast<uint64_t>(static_cast<int64_t>(entry.start) + offset);
+				entry.end = static_cast<uint64_t>(static_cast<int64_t>(entry.end) + offset);
+			}
+		}
+		return resolved;
+	}
+
+	uint64_t origin;
+	std::mutex traceMutex;
+	std::vector<cl::sycl::queue> lanes;   // every queue that submitted, its index is its row in the trace
+	std::vector<Command> commands;
+	std::vector<Range> hostRanges;
+};
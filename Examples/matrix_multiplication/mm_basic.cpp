@@ -1,53 +1,70 @@
 #include <CL/sycl.hpp>
+#include "mm_kernels.hpp"
 using namespace sycl;
 
-void mm_basic_kernel(queue& deviceQueue, std::vector<double>& in1, std::vector<double>& in2, std::vector<double>& out, size_t N) {
-    std::cout << "Executing matrix multiplication basic kernel...\n\n";
+template <typename T, typename AccT>
+event mm_basic_kernel(queue& deviceQueue, const T* in1, const T* in2, AccT* out, const GemmShape& shape) {
+    check_shape(shape);
+    size_t M = shape.M;
+    size_t K = shape.K;
+    size_t N = shape.N;
+    size_t lda = shape.lda;
+    size_t ldb = shape.ldb;
+    size_t ldc = shape.ldc;
 
-    // create 2-D SYCL range item for the number of buffer items and work items
-    range<2> numItems{N,N};
+    // create 2-D SYCL range item for the number of work items, one per output element
+    range<2> numItems{M,N};
 
     // create buffers which are used to pass data between host and device
-    // input data is 1-D, but here I cast to 2-D buffers for easier indexing
-    buffer<double, 2> in1Buffer(in1.data(), numItems);
-    buffer<double, 2> in2Buffer(in2.data(), numItems);
-    buffer<double, 2> outBuffer(out.data(), numItems);
+    // the buffers are 1-D and only span the matrices, so rows are indexed with the leading dimension
+    // use_host_ptr makes the runtime work on the host memory itself (a vector or a memory-mapped file) instead of a copy of it
+    // and a sub-matrix of a larger matrix can be passed in place
+    buffer<T, 1> in1Buffer(in1, range<1>{ matrix_span(M, K, lda) }, { property::buffer::use_host_ptr() });
+    buffer<T, 1> in2Buffer(in2, range<1>{ matrix_span(K, N, ldb) }, { property::buffer::use_host_ptr() });
+    buffer<AccT, 1> outBuffer(out, range<1>{ matrix_span(M, N, ldc) }, { property::buffer::use_host_ptr() });
 
     // submit work to the queue and capture details in event
     auto queueEvent = deviceQueue.submit([&](handler& queueHandler) {
-    
+
         // create accessors for device to read/write data in buffers
-        auto in1Accessor = in1Buffer.get_access<access::mode::read>(queueHandler);
-        auto in2Accessor = in2Buffer.get_access<access::mode::read>(queueHandler);
-        auto outAccessor = outBuffer.get_access<access::mode::write>(queueHandler);
+        // the output is read as well because the kernel adds to it
+        auto in1Accessor = in1Buffer.template get_access<access::mode::read>(queueHandler);
+        auto in2Accessor = in2Buffer.template get_access<access::mode::read>(queueHandler);
+        auto outAccessor = outBuffer.template get_access<access::mode::read_write>(queueHandler);
 
         // perform operation using parallel_for with basic_kernel
         // basic kernel is useful for "embarassing parallelism"
         // 1st param: num work items, here we are using the range item created above
-        // 2nd param: kernel to specify what to do per work item, here we are 
-        // addressing the work items with the basic 2-D index 
+        // 2nd param: kernel to specify what to do per work item, here we are
+        // addressing the work items with the basic 2-D index
         queueHandler.parallel_for(numItems, [=](id<2> index) {
             // first, we get the row and column index for the current work item
             auto rowIndex = index[0];
             auto colIndex = index[1];
             // calculate work item data by iterating through in1's rows and in2's columns
-            for (int i = 0; i < N; i++) {
-                // since index is 2-D, we can also pass it directly into the slices
-                outAccessor[index] += in1Accessor[rowIndex][i] * in2Accessor[i][colIndex];
+            for (size_t i = 0; i < K; i++) {
+                outAccessor[rowIndex * ldc + colIndex] += static_cast<AccT>(in1Accessor[rowIndex * lda + i]) * static_cast<AccT>(in2Accessor[i * ldb + colIndex]);
             }
             });
     });
 
     // allow read access on output buffer
-    outBuffer.get_access<access::mode::read>();
+    outBuffer.template get_access<access::mode::read>();
 
-    // wait to get profile results until the queue is done executing on the kernel
+    // wait until the queue is done executing on the kernel
     deviceQueue.wait();
 
-    // get reported times from kernel event profile
-    auto kernel_end = queueEvent.get_profiling_info<info::event_profiling::command_end>();
-    auto kernel_start = queueEvent.get_profiling_info<info::event_profiling::command_start>();
-    auto kernel_duration = round((kernel_end - kernel_start) / 1.0e6);
+    // return the kernel event so the caller can read the profiling results
+    return queueEvent;
+}
+
+template <typename T, typename AccT>
+event mm_basic_kernel(queue& deviceQueue, std::vector<T>& in1, std::vector<T>& in2, std::vector<AccT>& out, size_t N) {
+    return mm_basic_kernel(deviceQueue, in1.data(), in2.data(), out.data(), make_shape(N, N, N));
+}
 
-    std::cout << "Kernel execution time : " << kernel_duration << " milliseconds\n";
-}
\ No newline at end of file
+// the template is defined in this file, so instantiate the element types used by the host program
+#define MM_INSTANTIATE_BASIC(T, AccT) \
+    template event mm_basic_kernel<T, AccT>(queue& deviceQueue, const T* in1, const T* in2, AccT* out, const GemmShape& shape); \
+    template event mm_basic_kernel<T, AccT>(queue& deviceQueue, std::vector<T>& in1, std::vector<T>& in2, std::vector<AccT>& out, size_t N);
+MM_FOR_EACH_TYPE(MM_INSTANTIATE_BASIC)
@@ -0,0 +1,131 @@
+#include <CL/sycl.hpp>
+#include "mm_kernels.hpp"
+using namespace sycl;
+
+// number of work items in a work group
+#define BATCHED_WORKGROUP_SIZE 128
+// number of work items in a sub-group when a single sub-group handles a whole matrix
+#define BATCHED_SUBGROUP_SIZE 16
+// matrices with at most this many elements (16x16) are handled by one sub-group instead of a whole work group
+#define BATCHED_SUBGROUP_ELEMENTS 256
+
+// multiply batchCount independent NxN matrices in a single kernel launch
+// in1Of, in2Of, and outOf map a matrix index to its device pointer, so the same kernel serves
+// strided batches (base + index * stride) and pointer-array batches (array[index])
+template <typename T, typename AccT, typename In1Of, typename In2Of, typename OutOf>
+static event mm_batched(queue& deviceQueue, In1Of in1Of, In2Of in2Of, OutOf outOf, size_t N, size_t batchCount, const std::vector<event>& dependencies) {
+    size_t elements = N * N;
+
+    if (elements <= BATCHED_SUBGROUP_ELEMENTS) {
+        // small matrices: one sub-group per matrix, so a work group handles several matrices at once
+        // and no work items sit idle in a work group that is much larger than the matrix
+        size_t matricesPerGroup = BATCHED_WORKGROUP_SIZE / BATCHED_SUBGROUP_SIZE;
+        size_t numGroups = (batchCount + matricesPerGroup - 1) / matricesPerGroup;
+
+        return deviceQueue.submit([&](handler& queueHandler) {
+            queueHandler.depends_on(dependencies);
+
+            queueHandler.parallel_for(nd_range<1>{ numGroups * BATCHED_WORKGROUP_SIZE, BATCHED_WORKGROUP_SIZE }, [=](nd_item<1> item) [[sycl::reqd_sub_group_size(BATCHED_SUBGROUP_SIZE)]] {
+                auto subGroup = item.get_sub_group();
+                size_t matrix = item.get_group(0) * matricesPerGroup + subGroup.get_group_linear_id();
+                // the last work group may have sub-groups without a matrix
+                if (matrix >= batchCount) {
+                    return;
+                }
+                const T* in1 = in1Of(matrix);
+                const T* in2 = in2Of(matrix);
+                AccT* out = outOf(matrix);
+
+                // lanes of the sub-group split the output elements of the matrix between them
+                for (size_t element = subGroup.get_local_linear_id(); element < elements; element += BATCHED_SUBGROUP_SIZE) {
+                    size_t rowIndex = element / N;
+                    size_t colIndex = element % N;
+                    AccT sum = 0;
+                    for (size_t i = 0; i < N; i++) {
+                        sum += static_cast<AccT>(in1[rowIndex * N + i]) * static_cast<AccT>(in2[i * N + colIndex]);
+                    }
+                    out[element] = sum;
+                }
+            });
+        });
+    }
+
+    // larger matrices: one work group per matrix
+    // when both inputs fit in (half of) local memory they are staged there first, otherwise they are read
+    // from global memory, where a matrix of at most 128x128 still fits comfortably in cache
+    size_t localMemory = deviceQueue.get_device().get_info<info::device::local_mem_size>();
+    bool stageLocal = 2 * elements * sizeof(T) <= localMemory / 2;
+
+    return deviceQueue.submit([&](handler& queueHandler) {
+        queueHandler.depends_on(dependencies);
+
+        // local memory for both inputs, a single placeholder element when the inputs are not staged
+        local_accessor<T, 1> localInputs(range<1>{ stageLocal ? 2 * elements : 1 }, queueHandler);
+
+        queueHandler.parallel_for(nd_range<1>{ batchCount * BATCHED_WORKGROUP_SIZE, BATCHED_WORKGROUP_SIZE }, [=](nd_item<1> item) {
+            size_t matrix = item.get_group(0);
+            const T* in1 = in1Of(matrix);
+            const T* in2 = in2Of(matrix);
+            AccT* out = outOf(matrix);
+            size_t localIndex = item.get_local_id(0);
+
+            if (stageLocal) {
+                // cooperatively copy both inputs into local memory
+                for (size_t element = localIndex; element < elements; element += BATCHED_WORKGROUP_SIZE) {
+                    localInputs[element] = in1[element];
+                    localInputs[elements + element] = in2[element];
+                }
+                group_barrier(item.get_group());
+
+                for (size_t element = localIndex; element < elements; element += BATCHED_WORKGROUP_SIZE) {
+                    size_t rowIndex = element / N;
+                    size_t colIndex = element % N;
+                    AccT sum = 0;
+                    for (size_t i = 0; i < N; i++) {
+                        sum += static_cast<AccT>(localInputs[rowIndex * N + i]) * static_cast<AccT>(localInputs[elements + i * N + colIndex]);
+                    }
+                    out[element] = sum;
+                }
+            }
+            else {
+                for (size_t element = localIndex; element < elements; element += BATCHED_WORKGROUP_SIZE) {
+                    size_t rowIndex = element / N;
+                    size_t colIndex = element % N;
+                    AccT sum = 0;
+                    for (size_t i = 0; i < N; i++) {
+                        sum += static_cast<AccT>(in1[rowIndex * N + i]) * static_cast<AccT>(in2[i * N + colIndex]);
+                    }
+                    out[element] = sum;
+                }
+            }
+        });
+    });
+}
+
+template <typename T, typename AccT>
+event mm_batched_strided_kernel(queue& deviceQueue, const T* in1, const T* in2, AccT* out, size_t N, size_t batchCount,
+                                size_t strideIn1, size_t strideIn2, size_t strideOut, const std::vector<event>& dependencies) {
+    return mm_batched<T, AccT>(deviceQueue,
+        [=](size_t matrix) { return in1 + matrix * strideIn1; },
+        [=](size_t matrix) { return in2 + matrix * strideIn2; },
+        [=](size_t matrix) { return out + matrix * strideOut; },
+        N, batchCount, dependencies);
+}
+
+template <typename T, typename AccT>
+event mm_batched_pointer_kernel(queue& deviceQueue, const T* const* in1, const T* const* in2, AccT* const* out, size_t N, size_t batchCount,
+                                const std::vector<event>& dependencies) {
+    return mm_batched<T, AccT>(deviceQueue,
+        [=](size_t matrix) { return in1[matrix]; },
+        [=](size_t matrix) { return in2[matrix]; },
+        [=](size_t matrix) { return out[matrix]; },
+        N, batchCount, dependencies);
+}
+
+// the template is defined in this file, so instantiate the element types used by the host program
+#define MM_INSTANTIATE_BATCHED(T, AccT) \
+    template event mm_batched_strided_kernel<T, AccT>(queue& deviceQueue, const T* in1, const T* in2, AccT* out, size_t N, size_t batchCount, \
+                                                      size_t strideIn1, size_t strideIn2, size_t strideOut, const std::vector<event>& dependencies); \
+    template event mm_batched_pointer_kernel<T, AccT>(queue& deviceQueue, const T* const* in1, const T* const* in2, AccT* const* out, size_t N, size_t batchCount, \
+                                                      const std::vector<event>& dependencies);
+MM_FOR_EACH_TYPE(MM_INSTANTIATE_BATCHED)
@@ -0,0 +1,322 @@
+#include <CL/sycl.hpp>
+#include <iostream>
+#include <chrono>
+#include "mm_bench.hpp"
+#include "mm_kernels.hpp"
+using namespace sycl;
+
+// default values, each one can be changed from the command line
+#define BATCH_COUNT 1000
+#define WARMUP_ITERATIONS 1
+#define TIMED_ITERATIONS 5
+
+// settings for a benchmark run, filled in from the command line
+struct Options {
+    std::vector<size_t> sizes{ 8, 16, 32, 64, 128 };
+    std::vector<std::string> devices{ "cpu", "gpu" };
+    std::vector<std::string> types{ "double" };
+    size_t batch = BATCH_COUNT;
+    size_t warmup = WARMUP_ITERATIONS;
+    size_t iterations = TIMED_ITERATIONS;
+    bool runLoop = true;
+    bool validateResult = false;
+    std::string csvFile;
+    std::string jsonFile;
+};
+
+static void print_usage(const char* program) {
+    std::cout << "Usage: " << program << " [options]\n"
+              << "  --sizes N[,N...]          matrix sizes (default 8,16,32,64,128)\n"
+              << "  --batch COUNT             number of matrices per batch (default " << BATCH_COUNT << ")\n"
+              << "  --devices D[,D...]        cpu, gpu, fpga_emu, fpga (default cpu,gpu)\n"
+              << "  --types T[,T...]          double, float, half, bfloat16, int8 (default double)\n"
+              << "  --warmup W                untimed iterations per configuration (default " << WARMUP_ITERATIONS << ")\n"
+              << "  --iterations I            timed iterations per configuration (default " << TIMED_ITERATIONS << ")\n"
+              << "  --no-loop                 skip the comparison with one mm_basic_kernel call per matrix\n"
+              << "  --validate                compare every result to the host reference\n"
+              << "  --csv FILE                write results as CSV\n"
+              << "  --json FILE               write results as JSON\n";
+}
+
+// run the batched kernels and the mm_basic_kernel loop for one element type
+template <typename T, typename AccT>
+static void run_type(const std::string& typeName, const Options& options, std::vector<std::pair<std::string, queue>>& deviceQueues,
+                     std::vector<BenchResult>& results, bool& validationFailed) {
+    for (size_t N : options.sizes) {
+        size_t elements = N * N;
+        size_t batch = options.batch;
+
+        std::cout << "Running batched matrix multiplication (" << typeName << ")\n"
+                  << "Matrix size = [ " << N << " x " << N << " ], batch = " << batch << "\n\n";
+
+        // all matrices of the batch are stored back-to-back on the host
+        std::vector<T> in1Host(batch * elements);
+        std::vector<T> in2Host(batch * elements);
+        std::vector<AccT> outHost(batch * elements);
+        std::vector<AccT> outVal;
+
+        // load vectors, small integers are exact in every element type
+        for (size_t i = 0; i < batch * elements; i++) {
+            in1Host[i] = static_cast<T>(static_cast<float>(rand() % 100));
+            in2Host[i] = static_cast<T>(static_cast<float>(rand() % 100));
+        }
+
+        // host computation for validation, one matrix at a time
+        if (options.validateResult) {
+            outVal.resize(batch * elements);
+            std::vector<T> in1Matrix(elements);
+            std::vector<T> in2Matrix(elements);
+            std::vector<AccT> outMatrix(elements);
+            for (size_t b = 0; b < batch; b++) {
+                std::copy_n(in1Host.begin() + b * elements, elements, in1Matrix.begin());
+                std::copy_n(in2Host.begin() + b * elements, elements, in2Matrix.begin());
+                mm_host_reference(in1Matrix, in2Matrix, outMatrix, N);
+                std::copy_n(outMatrix.begin(), elements, outVal.begin() + b * elements);
+            }
+        }
+
+        for (auto& [deviceName, deviceQueue] : deviceQueues) {
+
+            // allocate device memory for the whole batch once
+            T* in1Device = malloc_device<T>(batch * elements, deviceQueue);
+            T* in2Device = malloc_device<T>(batch * elements, deviceQueue);
+            AccT* outDevice = malloc_device<AccT>(batch * elements, deviceQueue);
+
+            // pointer arrays for the pointer-array variant, they point into the same allocations
+            std::vector<const T*> in1Pointers(batch);
+            std::vector<const T*> in2Pointers(batch);
+            std::vector<AccT*> outPointers(batch);
+            for (size_t b = 0; b < batch; b++) {
+                in1Pointers[b] = in1Device + b * elements;
+                in2Pointers[b] = in2Device + b * elements;
+                outPointers[b] = outDevice + b * elements;
+            }
+            const T** in1PointersDevice = malloc_device<const T*>(batch, deviceQueue);
+            const T** in2PointersDevice = malloc_device<const T*>(batch, deviceQueue);
+            AccT** outPointersDevice = malloc_device<AccT*>(batch, deviceQueue);
+            deviceQueue.memcpy(in1PointersDevice, in1Pointers.data(), batch * sizeof(const T*));
+            deviceQueue.memcpy(in2PointersDevice, in2Pointers.data(), batch * sizeof(const T*));
+            deviceQueue.memcpy(outPointersDevice, outPointers.data(), batch * sizeof(AccT*));
+            deviceQueue.wait();
+
+            //------------------------ BATCHED KERNELS ----------------------------------------------
+
+            for (std::string kernel : { "batched_strided", "batched_pointer" }) {
+                std::cout << "Executing " << kernel << " kernel on " << deviceName << "...\n";
+
+                std::vector<double> kernelTimes;
+                std::vector<double> totalTimes;
+                try {
+                    for (size_t iter = 0; iter < options.warmup + options.iterations; iter++) {
+                        // the total time includes copying the whole batch in and out, like the loop below does
+                        auto deviceStart = std::chrono::high_resolution_clock::now();
+
+                        auto in1Event = deviceQueue.memcpy(in1Device, in1Host.data(), batch * elements * sizeof(T));
+                        auto in2Event = deviceQueue.memcpy(in2Device, in2Host.data(), batch * elements * sizeof(T));
+                        event kernelEvent;
+                        if (kernel == "batched_strided") {
+                            kernelEvent = mm_batched_strided_kernel(deviceQueue, in1Device, in2Device, outDevice, N, batch,
+                                                                    elements, elements, elements, { in1Event, in2Event });
+                        }
+                        else {
+                            kernelEvent = mm_batched_pointer_kernel(deviceQueue, in1PointersDevice, in2PointersDevice, outPointersDevice, N, batch,
+                                                                    { in1Event, in2Event });
+                        }
+                        deviceQueue.memcpy(outHost.data(), outDevice, batch * elements * sizeof(AccT), kernelEvent);
+                        deviceQueue.wait();
+
+                        auto deviceStop = std::chrono::high_resolution_clock::now();
+                        if (iter < options.warmup) {
+                            continue;
+                        }
+
+                        // get reported times from kernel event profile
+                        auto kernel_end = kernelEvent.get_profiling_info<info::event_profiling::command_end>();
+                        auto kernel_start = kernelEvent.get_profiling_info<info::event_profiling::command_start>();
+                        kernelTimes.push_back((kernel_end - kernel_start) / 1.0e6);
+                        totalTimes.push_back(std::chrono::duration<double, std::milli>(deviceStop - deviceStart).count());
+                    }
+                }
+                catch (const std::exception& e) {
+                    std::cout << "Skipping " << kernel << " kernel: " << e.what() << "\n\n";
+                    continue;
+                }
+
+                BenchResult result;
+                result.device = deviceName;
+                result.kernel = kernel;
+                result.type = typeName;
+                result.M = N;
+                result.K = N;
+                result.N = N;
+                result.batch = batch;
+                result.iterations = options.iterations;
+                result.kernelTime = summarize(kernelTimes);
+                result.totalTime = summarize(totalTimes);
+                result.gflops = gemm_gflops(N, result.kernelTime.median, batch);
+                result.validation = "skipped";
+                if (options.validateResult) {
+                    bool passed = validate_result(outHost, outVal, N);
+                    result.validation = passed ? "passed" : "failed";
+                    validationFailed |= !passed;
+                }
+                results.push_back(result);
+            }
+
+            free(in1Device, deviceQueue);
+            free(in2Device, deviceQueue);
+            free(outDevice, deviceQueue);
+            free(in1PointersDevice, deviceQueue);
+            free(in2PointersDevice, deviceQueue);
+            free(outPointersDevice, deviceQueue);
+
+            //------------------------ LOOP OVER BASIC KERNEL ----------------------------------------------
+
+            if (!options.runLoop) {
+                continue;
+            }
+
+            std::cout << "Executing basic kernel once per matrix on " << deviceName << "...\n";
+
+            // split the batch into separate vectors up front so the copies are not timed
+            std::vector<std::vector<T>> in1Matrices(batch);
+            std::vector<std::vector<T>> in2Matrices(batch);
+            std::vector<std::vector<AccT>> outMatrices(batch, std::vector<AccT>(elements));
+            for (size_t b = 0; b < batch; b++) {
+                in1Matrices[b].assign(in1Host.begin() + b * elements, in1Host.begin() + (b + 1) * elements);
+                in2Matrices[b].assign(in2Host.begin() + b * elements, in2Host.begin() + (b + 1) * elements);
+            }
+
+            std::vector<double> kernelTimes;
+            std::vector<double> totalTimes;
+            for (size_t iter = 0; iter < options.warmup + options.iterations; iter++) {
+                // the basic kernel adds to its output
+                for (auto& outMatrix : outMatrices) {
+                    std::fill(outMatrix.begin(), outMatrix.end(), AccT(0));
+                }
+
+                // every matrix pays for its own submit, buffers, and blocking wait
+                double kernelTime = 0.0;
+                auto deviceStart = std::chrono::high_resolution_clock::now();
+                for (size_t b = 0; b < batch; b++) {
+                    event kernelEvent = mm_basic_kernel(deviceQueue, in1Matrices[b], in2Matrices[b], outMatrices[b], N);
+                    auto kernel_end = kernelEvent.get_profiling_info<info::event_profiling::command_end>();
+                    auto kernel_start = kernelEvent.get_profiling_info<info::event_profiling::command_start>();
+                    kernelTime += (kernel_end - kernel_start) / 1.0e6;
+                }
+                auto deviceStop = std::chrono::high_resolution_clock::now();
+
+                if (iter >= options.warmup) {
+                    kernelTimes.push_back(kernelTime);
+                    totalTimes.push_back(std::chrono::duration<double, std::milli>(deviceStop - deviceStart).count());
+                }
+            }
+
+            BenchResult result;
+            result.device = deviceName;
+            result.kernel = "basic_loop";
+            result.type = typeName;
+            result.M = N;
+            result.K = N;
+            result.N = N;
+            result.batch = batch;
+            result.iterations = options.iterations;
+            result.kernelTime = summarize(kernelTimes);
+            result.totalTime = summarize(totalTimes);
+            result.gflops = gemm_gflops(N, result.kernelTime.median, batch);
+            result.validation = "skipped";
+            if (options.validateResult) {
+                bool passed = true;
+                for (size_t b = 0; b < batch; b++) {
+                    std::vector<AccT> expected(outVal.begin() + b * elements, outVal.begin() + (b + 1) * elements);
+                    passed &= validate_result(outMatrices[b], expected, N);
+                }
+                result.validation = passed ? "passed" : "failed";
+                validationFailed |= !passed;
+            }
+            results.push_back(result);
+        }
+        std::cout << "\n";
+    }
+}
+
+int main(int argc, char* argv[]) {
+
+    Options options;
+
+    // parse command line options
+    try {
+        for (int i = 1; i < argc; i++) {
+            std::string arg = argv[i];
+            auto next_value = [&]() -> std::string {
+                if (i + 1 >= argc) {
+                    throw std::invalid_argument("missing value for " + arg);
+                }
+                return argv[++i];
+            };
+            if (arg == "--sizes") options.sizes = split_sizes(next_value());
+            else if (arg == "--batch") options.batch = std::stoul(next_value());
+            else if (arg == "--devices") options.devices = split_list(next_value());
+            else if (arg == "--types") options.types = split_list(next_value());
+            else if (arg == "--warmup") options.warmup = std::stoul(next_value());
+            else if (arg == "--iterations") options.iterations = std::stoul(next_value());
+            else if (arg == "--no-loop") options.runLoop = false;
+            else if (arg == "--validate") options.validateResult = true;
+            else if (arg == "--csv") options.csvFile = next_value();
+            else if (arg == "--json") options.jsonFile = next_value();
+            else if (arg == "--help" || arg == "-h") {
+                print_usage(argv[0]);
+                return 0;
+            }
+            else throw std::invalid_argument("unknown option " + arg);
+        }
+        if (options.iterations == 0 || options.batch == 0) {
+            throw std::invalid_argument("--iterations and --batch must be at least 1");
+        }
+        check_types(options.types);
+    }
+    catch (const std::exception& e) {
+        std::cout << "Error: " << e.what() << "\n";
+        print_usage(argv[0]);
+        return -1;
+    }
+
+    // create queues for the offload devices, skipping devices that are not available
+    std::vector<std::pair<std::string, queue>> deviceQueues;
+    for (auto& deviceName : options.devices) {
+        try {
+            queue deviceQueue = make_queue(deviceName);
+            std::cout << "Offload Device       : " << deviceQueue.get_device().get_info<info::device::name>() << " (" << deviceName << ")\n\n";
+            deviceQueues.emplace_back(deviceName, deviceQueue);
+        }
+        catch (const std::exception& e) {
+            std::cout << "Skipping device " << deviceName << ": " << e.what() << "\n\n";
+        }
+    }
+
+    std::vector<BenchResult> results;
+    bool validationFailed = false;
+
+    run_types(options.types, deviceQueues, [&](auto inputType, auto accumulatorType, const std::string& typeName,
+                                                std::vector<std::pair<std::string, queue>>& typeQueues, bool) {
+        using T = typename decltype(inputType)::type;
+        using AccT = typename decltype(accumulatorType)::type;
+        run_type<T, AccT>(typeName, options, typeQueues, results, validationFailed);
+    });
+
+    // report results
+    print_results(results);
+    if (!options.csvFile.empty()) {
+        write_csv(options.csvFile, results);
+        std::cout << "Results written to " << options.csvFile << "\n";
+    }
+    if (!options.jsonFile.empty()) {
+        write_json(options.jsonFile, results);
+        std::cout << "Results written to " << options.jsonFile << "\n";
+    }
+
+    if (options.validateResult) {
+        std::cout << (validationFailed ? "Validation failed\n" : "Validation passed\n");
+    }
+    return validationFailed ? -1 : 0;
+}
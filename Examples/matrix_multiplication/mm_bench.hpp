@@ -0,0 +1,286 @@
+#pragma once
+#include <CL/sycl.hpp>
+#include <sycl/ext/intel/fpga_extensions.hpp>
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include "mm_kernels.hpp"
+using namespace sycl;
+
+// split a comma separated command line value ("512,1024") into its parts
+inline std::vector<std::string> split_list(const std::string& value) {
+    std::vector<std::string> parts;
+    std::stringstream stream(value);
+    std::string part;
+    while (std::getline(stream, part, ',')) {
+        if (!part.empty()) {
+            parts.push_back(part);
+        }
+    }
+    return parts;
+}
+
+inline std::vector<size_t> split_sizes(const std::string& value) {
+    std::vector<size_t> sizes;
+    for (auto& part : split_list(value)) {
+        sizes.push_back(std::stoul(part));
+    }
+    return sizes;
+}
+
+// parse a list of matrix multiplication shapes given as MxKxN ("1000x300x77,64x64x64")
+inline std::vector<GemmShape> split_shapes(const std::string& value) {
+    std::vector<GemmShape> shapes;
+    for (auto& part : split_list(value)) {
+        size_t first = part.find('x');
+        size_t second = part.find('x', first + 1);
+        if (first == std::string::npos || second == std::string::npos) {
+            throw std::invalid_argument("shape " + part + " is not of the form MxKxN");
+        }
+        shapes.push_back(make_shape(std::stoul(part.substr(0, first)), std::stoul(part.substr(first + 1, second - first - 1)),
+                                    std::stoul(part.substr(second + 1))));
+    }
+    return shapes;
+}
+
+// create a profiling-enabled queue for a device name given on the command line
+inline queue make_queue(const std::string& deviceName) {
+    // define property list for queues-- enables timing analysis
+    auto propertyList = property::queue::enable_profiling();
+
+    // use default selectors for the offload devices-- can make custom ones with ranked choices based on HW available
+    if (deviceName == "cpu") {
+        return queue(cpu_selector_v, propertyList);
+    }
+    if (deviceName == "gpu") {
+        return queue(gpu_selector_v, propertyList);
+    }
+    if (deviceName == "fpga_emu") {
+        return queue(ext::intel::fpga_emulator_selector_v, propertyList);
+    }
+    if (deviceName == "fpga") {
+        return queue(ext::intel::fpga_selector_v, propertyList);
+    }
+    throw std::invalid_argument("unknown device " + deviceName);
+}
+
+// check whether a device can run kernels with the given element type
+// fp64 and fp16 are optional features, the other types are always available
+inline bool device_supports(const device& offloadDevice, const std::string& typeName) {
+    if (typeName == "double") {
+        return offloadDevice.has(aspect::fp64);
+    }
+    if (typeName == "half") {
+        return offloadDevice.has(aspect::fp16);
+    }
+    return true;
+}
+
+// make sure every type name given on the command line is known
+inline void check_types(const std::vector<std::string>& types) {
+    for (auto& typeName : types) {
+        if (typeName != "double" && typeName != "float" && typeName != "half" && typeName != "bfloat16" && typeName != "int8") {
+            throw std::invalid_argument("unknown type " + typeName);
+        }
+    }
+}
+
+// carries a type through a generic lambda parameter
+template <typename T>
+struct TypeTag {
+    using type = T;
+};
+
+// call runner(TypeTag<T>, TypeTag<AccT>) with the input and accumulator type for a type name
+template <typename Runner>
+void with_type(const std::string& typeName, Runner runner) {
+    if (typeName == "double") {
+        runner(TypeTag<double>{}, TypeTag<double>{});
+    }
+    else if (typeName == "float") {
+        runner(TypeTag<float>{}, TypeTag<float>{});
+    }
+    else if (typeName == "half") {
+        runner(TypeTag<half>{}, TypeTag<float>{});
+    }
+    else if (typeName == "bfloat16") {
+        runner(TypeTag<ext::oneapi::bfloat16>{}, TypeTag<float>{});
+    }
+    else if (typeName == "int8") {
+        runner(TypeTag<int8_t>{}, TypeTag<int32_t>{});
+    }
+}
+
+// type a device actually runs for a requested type name: devices without fp64 run double in float,
+// and an empty name means the device cannot run the type at all
+inline std::string device_type(const device& offloadDevice, const std::string& typeName) {
+    if (device_supports(offloadDevice, typeName)) {
+        return typeName;
+    }
+    return typeName == "double" ? "float" : "";
+}
+
+// call runner(TypeTag<T>, TypeTag<AccT>, typeName, queues, runHost) once for every requested element type
+// the queues are split into those that support the type natively and those that need a fallback:
+// devices without fp64 run the double benchmark in float instead, devices without fp16 skip half
+// runHost is false for the fallback run so host-only work is not repeated
+template <typename Runner>
+void run_types(const std::vector<std::string>& types, std::vector<std::pair<std::string, queue>>& deviceQueues, Runner runner) {
+    for (auto& typeName : types) {
+        std::vector<std::pair<std::string, queue>> supportedQueues;
+        std::vector<std::pair<std::string, queue>> fallbackQueues;
+        for (auto& deviceQueue : deviceQueues) {
+            std::string runType = device_type(deviceQueue.second.get_device(), typeName);
+            if (runType == typeName) {
+                supportedQueues.push_back(deviceQueue);
+            }
+            else if (!runType.empty()) {
+                std::cout << "Device " << deviceQueue.first << " does not support fp64, falling back to float\n\n";
+                fallbackQueues.push_back(deviceQueue);
+            }
+            else {
+                std::cout << "Device " << deviceQueue.first << " does not support " << typeName << ", skipping\n\n";
+            }
+        }
+
+        with_type(typeName, [&](auto inputType, auto accumulatorType) {
+            runner(inputType, accumulatorType, typeName, supportedQueues, true);
+        });
+        if (!fallbackQueues.empty()) {
+            with_type("float", [&](auto inputType, auto accumulatorType) {
+                runner(inputType, accumulatorType, typeName + "->float", fallbackQueues, false);
+            });
+        }
+    }
+}
+
+// compare a result to the host reference, N is the length of the dot products
+// integer results must match exactly, floating point results may differ by rounding in a different summation order
+template <typename AccT>
+bool validate_result(const AccT* out, const AccT* outVal, size_t count, size_t N) {
+    double tolerance = std::is_integral_v<AccT> ? 0.0 : std::numeric_limits<AccT>::epsilon() * N;
+    for (size_t i = 0; i < count; i++) {
+        double expected = static_cast<double>(outVal[i]);
+        if (std::abs(static_cast<double>(out[i]) - expected) > tolerance * (std::abs(expected) + 1.0)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+template <typename AccT>
+bool validate_result(const std::vector<AccT>& out, const std::vector<AccT>& outVal, size_t N) {
+    return validate_result(out.data(), outVal.data(), out.size(), N);
+}
+
+// summary of repeated timing samples, in milliseconds
+struct TimingStats {
+    double min = 0.0;
+    double median = 0.0;
+    double p95 = 0.0;
+};
+
+// one row of the benchmark report
+struct BenchResult {
+    std::string device;
+    std::string kernel;
+    std::string type;        // element type of the inputs
+    size_t M = 0;            // out (M x N) = in1 (M x K) * in2 (K x N)
+    size_t K = 0;
+    size_t N = 0;
+    size_t B = 0;
+    size_t batch = 1;        // number of matrices multiplied per iteration
+    size_t iterations = 0;
+    double firstTime = 0.0;  // total time of the very first launch, includes JIT compilation unless the kernel was prebuilt or compiled ahead of time
+    TimingStats kernelTime;  // from the kernel event profile (command_start to command_end)
+    TimingStats totalTime;   // measured on the host around the whole offload, including data movement
+    double gflops = 0.0;     // based on the median kernel time
+    std::string validation;  // "passed", "failed", or "skipped"
+};
+
+// compute min, median, and 95th percentile of the samples
+inline TimingStats summarize(std::vector<double> samples) {
+    TimingStats stats;
+    if (samples.empty()) {
+        return stats;
+    }
+    std::sort(samples.begin(), samples.end());
+    size_t count = samples.size();
+    stats.min = samples.front();
+    stats.median = (count % 2 == 1) ? samples[count / 2] : (samples[count / 2 - 1] + samples[count / 2]) / 2.0;
+    // nearest-rank percentile
+    size_t p95Rank = static_cast<size_t>(std::ceil(0.95 * count));
+    stats.p95 = samples[std::max<size_t>(p95Rank, 1) - 1];
+    return stats;
+}
+
+// matrix multiplication performs M*K*N multiplies and M*K*N adds per matrix
+inline double gemm_gflops(size_t M, size_t K, size_t N, double milliseconds) {
+    return milliseconds > 0.0 ? 2.0 * M * K * N / (milliseconds * 1.0e6) : 0.0;
+}
+
+// square NxN matrices, batch of them per timed iteration
+inline double gemm_gflops(size_t N, double milliseconds, size_t batch = 1) {
+    return gemm_gflops(N, N, N * batch, milliseconds);
+}
+
+// print the results as a table on the console
+inline void print_results(const std::vector<BenchResult>& results) {
+    std::cout << std::left << std::setw(10) << "device" << std::setw(14) << "kernel" << std::setw(15) << "type"
+              << std::right << std::setw(17) << "MxKxN" << std::setw(5) << "B" << std::setw(7) << "batch" << std::setw(12) << "first"
+              << std::setw(12) << "kern min" << std::setw(12) << "kern med" << std::setw(12) << "kern p95"
+              << std::setw(12) << "total min" << std::setw(12) << "total med" << std::setw(12) << "total p95"
+              << std::setw(10) << "GFLOP/s" << "  valid\n";
+    std::cout << std::fixed << std::setprecision(3);
+    for (auto& result : results) {
+        std::cout << std::left << std::setw(10) << result.device << std::setw(14) << result.kernel << std::setw(15) << result.type
+                  << std::right << std::setw(17) << (std::to_string(result.M) + "x" + std::to_string(result.K) + "x" + std::to_string(result.N)) << std::setw(5) << result.B << std::setw(7) << result.batch << std::setw(12) << result.firstTime
+                  << std::setw(12) << result.kernelTime.min << std::setw(12) << result.kernelTime.median << std::setw(12) << result.kernelTime.p95
+                  << std::setw(12) << result.totalTime.min << std::setw(12) << result.totalTime.median << std::setw(12) << result.totalTime.p95
+                  << std::setw(10) << std::setprecision(1) << result.gflops << std::setprecision(3)
+                  << "  " << result.validation << "\n";
+    }
+    std::cout << std::defaultfloat << "(times in milliseconds)\n\n";
+}
+
+// write the results as CSV, one row per configuration
+inline void write_csv(const std::string& fileName, const std::vector<BenchResult>& results) {
+    std::ofstream file(fileName);
+    file << "device,kernel,type,M,K,N,B,batch,iterations,first_ms,"
+         << "kernel_min_ms,kernel_median_ms,kernel_p95_ms,"
+         << "total_min_ms,total_median_ms,total_p95_ms,gflops,validation\n";
+    for (auto& result : results) {
+        file << result.device << "," << result.kernel << "," << result.type << "," << result.M << "," << result.K << "," << result.N << "," << result.B << "," << result.batch << "," << result.iterations << "," << result.firstTime << ","
+             << result.kernelTime.min << "," << result.kernelTime.median << "," << result.kernelTime.p95 << ","
+             << result.totalTime.min << "," << result.totalTime.median << "," << result.totalTime.p95 << ","
+             << result.gflops << "," << result.validation << "\n";
+    }
+}
+
+// write the results as a JSON array, one object per configuration
+inline void write_json(const std::string& fileName, const std::vector<BenchResult>& results) {
+    auto stats_json = [](const TimingStats& stats) {
+        return "{\"min\": " + std::to_string(stats.min) + ", \"median\": " + std::to_string(stats.median)
+               + ", \"p95\": " + std::to_string(stats.p95) + "}";
+    };
+    std::ofstream file(fileName);
+    file << "[\n";
+    for (size_t i = 0; i < results.size(); i++) {
+        auto& result = results[i];
+        file << "  {\"device\": \"" << result.device << "\", \"kernel\": \"" << result.kernel << "\""
+             << ", \"type\": \"" << result.type << "\""
+             << ", \"M\": " << result.M << ", \"K\": " << result.K << ", \"N\": " << result.N << ", \"B\": " << result.B << ", \"batch\": " << result.batch << ", \"iterations\": " << result.iterations << ", \"first_ms\": " << result.firstTime
+             << ", \"kernel_ms\": " << stats_json(result.kernelTime)
+             << ", \"total_ms\": " << stats_json(result.totalTime)
+             << ", \"gflops\": " << result.gflops << ", \"validation\": \"" << result.validation << "\"}"
+             << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+    file << "]\n";
+}
@@ -0,0 +1,73 @@
+#include "mm_context.hpp"
+
+template <typename T, typename AccT>
+GemmContext<T, AccT>::GemmContext(queue& deviceQueue, size_t N, size_t B)
+    : deviceQueue(deviceQueue), N(N), B(B) {
+    // allocate memory on the device once, it is reused by every call made through this context
+    in1Device = malloc_device<T>(N * N, deviceQueue);
+    in2Device = malloc_device<T>(N * N, deviceQueue);
+    outDevice = malloc_device<AccT>(N * N, deviceQueue);
+}
+
+template <typename T, typename AccT>
+GemmContext<T, AccT>::~GemmContext() {
+    // make sure nothing is still using the memory before it is freed
+    deviceQueue.wait();
+    free(in1Device, deviceQueue);
+    free(in2Device, deviceQueue);
+    free(outDevice, deviceQueue);
+}
+
+template <typename T, typename AccT>
+event GemmContext<T, AccT>::upload_in1(const T* in1) {
+    in1Event = deviceQueue.submit([&](handler& queueHandler) {
+        // the previous multiplication may still be reading in1, and on an out-of-order queue an earlier upload
+        // may still be writing it, so the newest data has to land last
+        queueHandler.depends_on({ multiplyEvent, in1Event });
+        queueHandler.memcpy(in1Device, in1, N * N * sizeof(T));
+    });
+    return in1Event;
+}
+
+template <typename T, typename AccT>
+event GemmContext<T, AccT>::upload_in2(const T* in2) {
+    in2Event = deviceQueue.submit([&](handler& queueHandler) {
+        // the previous multiplication may still be reading in2, and on an out-of-order queue an earlier upload
+        // may still be writing it, so the newest data has to land last
+        queueHandler.depends_on({ multiplyEvent, in2Event });
+        queueHandler.memcpy(in2Device, in2, N * N * sizeof(T));
+    });
+    return in2Event;
+}
+
+template <typename T, typename AccT>
+event GemmContext<T, AccT>::multiply(const std::vector<event>& dependencies) {
+    // wait for the inputs to arrive, for the previous multiplication to finish writing the output,
+    // for the last download to finish reading it, and for anything the caller passed in
+    std::vector<event> waitFor{ in1Event, in2Event, multiplyEvent, downloadEvent };
+    waitFor.insert(waitFor.end(), dependencies.begin(), dependencies.end());
+
+    // the same tiled kernel as mm_tiled_kernel, working directly on the device allocations
+    multiplyEvent = mm_tiled_usm_kernel(deviceQueue, static_cast<const T*>(in1Device), static_cast<const T*>(in2Device), outDevice,
+                                        make_shape(N, N, N), B, waitFor);
+    return multiplyEvent;
+}
+
+template <typename T, typename AccT>
+event GemmContext<T, AccT>::download(AccT* out) {
+    downloadEvent = deviceQueue.submit([&](handler& queueHandler) {
+        // state the dependency explicitly using event information
+        queueHandler.depends_on(multiplyEvent);
+        queueHandler.memcpy(out, outDevice, N * N * sizeof(AccT));
+    });
+    return downloadEvent;
+}
+
+template <typename T, typename AccT>
+void GemmContext<T, AccT>::wait() {
+    deviceQueue.wait();
+}
+
+// the template is defined in this file, so instantiate the element types used by the host program
+#define MM_INSTANTIATE_CONTEXT(T, AccT) template class GemmContext<T, AccT>;
+MM_FOR_EACH_TYPE(MM_INSTANTIATE_CONTEXT)
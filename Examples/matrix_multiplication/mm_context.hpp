@@ -0,0 +1,53 @@
+#pragma once
+#include <CL/sycl.hpp>
+#include "mm_kernels.hpp"
+using namespace sycl;
+
+// GemmContext keeps NxN input and output matrices resident on one device between calls
+// device memory is allocated once with malloc_device when the context is created and freed when it is destroyed
+// inputs are only copied when the caller uploads new data, and every operation returns an event
+// so many multiplications can be queued back-to-back without blocking the host
+// inputs have type T and the output has the accumulator type AccT (see MM_FOR_EACH_TYPE)
+template <typename T, typename AccT>
+class GemmContext {
+public:
+    GemmContext(queue& deviceQueue, size_t N, size_t B);
+    ~GemmContext();
+
+    // the context owns device memory, so it cannot be copied
+    GemmContext(const GemmContext&) = delete;
+    GemmContext& operator=(const GemmContext&) = delete;
+
+    // copy an input matrix from the host to the device
+    // only needed when the input has changed since the last upload
+    event upload_in1(const T* in1);
+    event upload_in2(const T* in2);
+
+    // queue a multiplication of the resident inputs into the resident output
+    // the kernel waits on the latest uploads and any extra events passed in, never on the host
+    event multiply(const std::vector<event>& dependencies = {});
+
+    // copy the output matrix from the device to the host once the latest multiplication is done
+    event download(AccT* out);
+
+    // block the host until all work queued through the context has finished
+    void wait();
+
+    size_t size() const { return N; }
+
+private:
+    queue deviceQueue;
+    size_t N;
+    size_t B;
+
+    // device allocations reused across calls
+    T* in1Device;
+    T* in2Device;
+    AccT* outDevice;
+
+    // last event that wrote or read each allocation, used to chain dependencies
+    event in1Event;
+    event in2Event;
+    event multiplyEvent;
+    event downloadEvent;
+};
@@ -2,202 +2,848 @@
 #include <iostream>
 #include <sycl/ext/intel/fpga_extensions.hpp>
 #include <chrono>
+#include <future>
+#include <map>
+#include <memory>
+#include "mm_bench.hpp"
+#include "mm_context.hpp"
+#include "mm_kernels.hpp"
+#include "mm_matrix_file.hpp"
+#include "mm_random.hpp"
+#include "mm_split.hpp"
+#include "mm_stream.hpp"
+#include "mm_tune.hpp"
+#include "../common/sycl_trace.hpp"
 using namespace sycl;
 
-// define kernels for offloading computations
-void mm_basic_kernel(queue& deviceQueue, std::vector<double>& in1, std::vector<double>& in2, std::vector<double>& out, size_t N);
-void mm_ndrange_kernel(queue& deviceQueue, std::vector<double>& in1, std::vector<double>& in2, std::vector<double>& out, size_t N, size_t B);
-
+// default values, each one can be changed from the command line
 #define MATRIX_SIZE 1024
 #define WORKGROUP_SIZE 16
-
-int main(int argc, char* argv[]) {
-
-    size_t N = MATRIX_SIZE;
-    size_t B = WORKGROUP_SIZE;
+#define WARMUP_ITERATIONS 1
+#define TIMED_ITERATIONS 5
+#define CHAIN_LENGTH 8
+
+// settings for a benchmark run, filled in from the command line
+struct Options {
+    // square sizes from --sizes and general shapes from --shapes end up in the same list
+    std::vector<GemmShape> shapes{ make_shape(MATRIX_SIZE, MATRIX_SIZE, MATRIX_SIZE) };
+    bool shapesGiven = false;
+    size_t padding = 0;
+    std::vector<size_t> workGroups{ WORKGROUP_SIZE };
+    std::vector<std::string> kernels{ "basic", "ndrange", "tiled", "subgroup", "context", "host" };
+    std::vector<std::string> devices{ "cpu", "gpu" };
+    std::vector<std::string> types{ "double" };
+    size_t warmup = WARMUP_ITERATIONS;
+    size_t iterations = TIMED_ITERATIONS;
+    size_t chainLength = CHAIN_LENGTH;
+    std::string tuneCache = TUNE_CACHE_FILE;
+    bool retune = false;
+    bool prebuild = false;
+    bool numa = false;
+    size_t streamMB = STREAM_BUDGET_MB;
     bool printResult = false;
-    bool compareResult = true;
     bool validateResult = false;
-
-    std::cout << "\nRunning matrix multiplication\n" 
-              << "Matrix size = [ " << N << " x " << N << " ]\n\n";
-
-    // define 1-D vectors with size to hold NxN matrices
-    std::vector<double> in1(N * N);
-    std::vector<double> in2(N * N);
-    std::vector<double> outCPU(N * N);
-    std::vector<double> outGPU(N * N);
-    std::vector<double> outFPGA(N * N);
-    std::vector<double> outVal(N * N);
-
-    // load vectors
-    for (int i = 0; i < N; i++) {
-        for (int j = 0; j < N; j++) {
-            in1[i * N + j]      = rand() % 100;
-            in2[i * N + j]      = rand() % 100;
-            outCPU[i * N + j]   = 0.0;
-            outGPU[i * N + j]   = 0.0;
-            outFPGA[i * N + j]  = 0.0;
-            outVal[i * N + j]   = 0.0;
+    size_t validateChunk = 0;
+    std::string init = "host";
+    uint64_t seed = 1;
+    std::string in1File;
+    std::string in2File;
+    std::string outFile;
+    std::string savePrefix;
+    std::string csvFile;
+    std::string jsonFile;
+    std::string traceFile;
+};
+
+static void print_usage(const char* program) {
+    std::cout << "Usage: " << program << " [options]\n"
+              << "  --sizes N[,N...]          square matrix sizes (default " << MATRIX_SIZE << ")\n"
+              << "  --shapes MxKxN[,...]      general shapes, out (M x N) = in1 (M x K) * in2 (K x N)\n"
+              << "  --pad P                   add P to every leading dimension, so the matrices are sub-matrices of wider ones\n"
+              << "  --workgroups B[,B...]     work group sizes (default " << WORKGROUP_SIZE << ")\n"
+              << "  --kernels K[,K...]        basic, ndrange, tiled, subgroup, subgroup2x2, subgroup8x4, context, chain, tuned, split, stream, host\n"
+              << "  --devices D[,D...]        cpu, gpu, fpga_emu, fpga (default cpu,gpu)\n"
+              << "  --types T[,T...]          double, float, half, bfloat16, int8 (default double)\n"
+              << "  --warmup W                untimed iterations per configuration (default " << WARMUP_ITERATIONS << ")\n"
+              << "  --iterations I            timed iterations per configuration (default " << TIMED_ITERATIONS << ")\n"
+              << "  --chain C                 multiplications the chain kernel queues back to back per iteration (default " << CHAIN_LENGTH << ")\n"
+              << "  --validate                compare every result to the host reference\n"
+              << "  --validate-chunk ROWS     recompute the host reference ROWS rows at a time for every check instead of keeping all of it\n"
+              << "  --init host|device        fill the inputs with rand() on the host (default) or with Philox on the first device\n"
+              << "  --seed S                  seed of the device initialization, the same seed gives the same inputs (default 1)\n"
+              << "  --in1 FILE --in2 FILE     map the inputs from matrix files, the shape and type come from the files\n"
+              << "  --out FILE                write the result of the last kernel to a matrix file, one per type and shape in a sweep\n"
+              << "  --save-inputs PREFIX      write the generated inputs to PREFIX.in1.mat and PREFIX.in2.mat\n"
+              << "  --tune-cache FILE         tuning cache used by the tuned kernel (default " << TUNE_CACHE_FILE << ")\n"
+              << "  --retune                  ignore cached tuning results and search again\n"
+              << "  --numa                    let the split kernel run on every NUMA node of the CPU as a separate sub-device\n"
+              << "  --stream-mb MB            device memory the stream kernel may use for its panels (default " << STREAM_BUDGET_MB << ")\n"
+              << "  --prebuild                build the selected kernels in the background at startup, before the first timed launch\n"
+              << "  --csv FILE                write results as CSV\n"
+              << "  --json FILE               write results as JSON\n"
+              << "  --trace FILE              write a Chrome/Perfetto trace of the kernel launches (all but split and stream) and print a summary\n"
+              << "  --print                   print the matrices (only when N < 10)\n";
+}
+
+// the context of the context and chain kernels, created on first use with the inputs uploaded once
+template <typename T, typename AccT>
+static GemmContext<T, AccT>& resident_context(queue& deviceQueue, std::unique_ptr<GemmContext<T, AccT>>& context,
+                                              HostMatrix<T>& in1, HostMatrix<T>& in2, const GemmShape& shape, size_t B) {
+    // the context keeps packed NxN matrices
+    size_t N = shape.N;
+    if (shape.M != N || shape.K != N || shape.lda != N || shape.ldb != N || shape.ldc != N) {
+        throw std::invalid_argument("the context kernels only support packed square matrices");
+    }
+    if (!context) {
+        context = std::make_unique<GemmContext<T, AccT>>(deviceQueue, N, B);
+        context->upload_in1(in1.data());
+        context->upload_in2(in2.data());
+    }
+    return *context;
+}
+
+// run one kernel variant a single time and return its kernel event
+// the USM context variant keeps device memory and inputs resident between calls, so only the result is copied
+template <typename T, typename AccT>
+static event run_kernel(const std::string& kernel, queue& deviceQueue, std::unique_ptr<GemmContext<T, AccT>>& context,
+                        HostMatrix<T>& in1, HostMatrix<T>& in2, HostMatrix<AccT>& out, const GemmShape& shape, size_t B) {
+    if (kernel == "basic") {
+        return mm_basic_kernel(deviceQueue, in1.data(), in2.data(), out.data(), shape);
+    }
+    if (kernel == "context") {
+        GemmContext<T, AccT>& resident = resident_context(deviceQueue, context, in1, in2, shape, B);
+        event multiplyEvent = resident.multiply();
+        resident.download(out.data());
+        resident.wait();
+        return multiplyEvent;
+    }
+    // the remaining variants are the ones the tuner chooses between
+    return run_gemm(deviceQueue, GemmConfig{ kernel, B }, in1.data(), in2.data(), out.data(), shape);
+}
+
+// queue chainLength multiplications on the resident context back to back, every one waits on the one before through
+// the events the context chains, not on the host, then download the last result and wait once
+// returns the last multiplication's event, firstEvent gets the first one's, together they span the whole chain
+template <typename T, typename AccT>
+static event run_chain(queue& deviceQueue, std::unique_ptr<GemmContext<T, AccT>>& context, HostMatrix<T>& in1, HostMatrix<T>& in2,
+                       HostMatrix<AccT>& out, const GemmShape& shape, size_t B, size_t chainLength, event& firstEvent) {
+    GemmContext<T, AccT>& resident = resident_context(deviceQueue, context, in1, in2, shape, B);
+    firstEvent = resident.multiply();
+    event lastEvent = firstEvent;
+    for (size_t i = 1; i < chainLength; i++) {
+        lastEvent = resident.multiply();
+    }
+    resident.download(out.data());
+    resident.wait();
+    return lastEvent;
+}
+
+// print a rows x cols matrix stored with leading dimension ld
+template <typename T>
+static void print_matrix(const char* name, HostMatrix<T>& matrix, size_t rows, size_t cols, size_t ld) {
+    std::cout << name << " =\n";
+    for (size_t i = 0; i < rows; i++) {
+        std::cout << "[ ";
+        for (size_t j = 0; j < cols; j++) {
+            std::cout << static_cast<double>(matrix[i * ld + j]) << " ";
         }
+        std::cout << "]\n";
     }
-    
-    // define property list for queues-- enables timing analysis
-    auto propertyList = property::queue::enable_profiling();
-    
-    // use default selectors for the offload devices-- can make custom ones with ranked choices based on HW available
-    cl::sycl::cpu_selector deviceSelectorCPU;
-    cl::sycl::gpu_selector deviceSelectorGPU;
-    //cl::sycl::ext::intel::fpga_selector deviceSelectorFPGA;
-    //cl::sycl::ext::intel::fpga_emulator_selector deviceSelectorFPGAemu;
-
-    // create queues for the offload devices
-    queue deviceQueueCPU(deviceSelectorCPU, propertyList);
-    queue deviceQueueGPU(deviceSelectorGPU, propertyList);
-
-    //------------------------ CPU BASIC ----------------------------------------------
-
-    // print CPU information
-    std::cout << "Offload Device       : " << deviceQueueCPU.get_device().get_info<info::device::name>() << "\n";
-    std::cout << "max_work_group_size  : " << deviceQueueCPU.get_device().get_info<info::device::max_work_group_size>() << "\n\n";
-
-    // capture timing for start of offload
-    auto deviceStartCPU = std::chrono::high_resolution_clock::now();
-
-    // run matrix multiplication basic kernel on CPU
-    mm_basic_kernel(deviceQueueCPU, in1, in2, outCPU, N);
-
-    // capture timing for end of offload
-    auto deviceStopCPU = std::chrono::high_resolution_clock::now();
-    auto deviceDurationCPU = std::chrono::duration_cast<std::chrono::milliseconds>(deviceStopCPU - deviceStartCPU);
-
-    std::cout << "Total offload time    : " << deviceDurationCPU.count() << " milliseconds\n\n";
-
-    //------------------------ CPU ND-RANGE ----------------------------------------------
-    
-    // capture timing for start of offload
-    deviceStartCPU = std::chrono::high_resolution_clock::now();
-
-    // run matrix multiplication basic kernel on CPU
-    mm_ndrange_kernel(deviceQueueCPU, in1, in2, outCPU, N, B);
+}
+
+template <typename T, typename AccT>
+static void print_matrices(HostMatrix<T>& in1, HostMatrix<T>& in2, HostMatrix<AccT>& out, const GemmShape& shape) {
+    std::cout << "\n";
+    print_matrix("in1", in1, shape.M, shape.K, shape.lda);
+    print_matrix("in2", in2, shape.K, shape.N, shape.ldb);
+    print_matrix("out", out, shape.M, shape.N, shape.ldc);
+    std::cout << "\n";
+}
+
+// launch every selected kernel once on a 1x1 problem so the JIT compiler builds it
+// the runtime keeps built programs per context, so later launches on any queue of the same context skip compilation
+// (with an ahead-of-time build there is nothing left to compile and this only loads the device binaries)
+template <typename T, typename AccT>
+static void prebuild_type(queue& deviceQueue, const Options& options) {
+    size_t B = options.workGroups.front();
+    HostMatrix<T> in1(B * B);
+    HostMatrix<T> in2(B * B);
+    HostMatrix<AccT> out(B * B);
+    GemmShape shape = make_shape(1, 1, 1);
+
+    for (auto& kernel : options.kernels) {
+        // failures are reported by the benchmark run itself
+        try {
+            // the split kernel runs the tiled USM kernel on its own queues, some of them sub-devices with their own context
+            if (kernel == "host" || kernel == "split") {
+                continue;
+            }
+            if (kernel == "tuned") {
+                // any of the variants may win the tuning
+                for (auto& candidate : tune_candidates<T>(deviceQueue.get_device())) {
+                    run_gemm(deviceQueue, candidate, in1.data(), in2.data(), out.data(), shape);
+                }
+                continue;
+            }
+            if (kernel == "context" || kernel == "chain") {
+                GemmContext<T, AccT> context(deviceQueue, B, B);
+                context.upload_in1(in1.data());
+                context.upload_in2(in2.data());
+                context.multiply();
+                context.wait();
+                continue;
+            }
+            if (kernel == "stream") {
+                StreamGemm<T, AccT> stream(deviceQueue, B, B, B, B);
+                stream.multiply(in1.data(), in2.data(), out.data(), shape);
+                continue;
+            }
+            std::unique_ptr<GemmContext<T, AccT>> context;
+            run_kernel(kernel, deviceQueue, context, in1, in2, out, shape, B);
+        }
+        catch (const std::exception&) {
+        }
+    }
+}
+
+// start building the selected kernels for every requested type on a background thread
+// the thread uses its own queue in the device's context, and the future returns the build time in milliseconds
+static std::future<double> start_prebuild(queue& deviceQueue, const Options& options) {
+    queue buildQueue(deviceQueue.get_context(), deviceQueue.get_device());
+    return std::async(std::launch::async, [buildQueue, &options]() mutable {
+        auto buildStart = std::chrono::high_resolution_clock::now();
+        for (auto& typeName : options.types) {
+            with_type(device_type(buildQueue.get_device(), typeName), [&](auto inputType, auto accumulatorType) {
+                using T = typename decltype(inputType)::type;
+                using AccT = typename decltype(accumulatorType)::type;
+                prebuild_type<T, AccT>(buildQueue, options);
+            });
+        }
+        auto buildStop = std::chrono::high_resolution_clock::now();
+        return std::chrono::duration<double, std::milli>(buildStop - buildStart).count();
+    });
+}
+
+// compare a result to the host reference
+// without --validate-chunk the reference is computed once per shape and kept in outVal, with it the reference is
+// recomputed a few rows at a time for every check, so only one chunk of it is ever held in memory
+template <typename T, typename AccT>
+static bool check_output(const Options& options, const HostMatrix<T>& in1, const HostMatrix<T>& in2, const HostMatrix<AccT>& out,
+                         const std::vector<AccT>& outVal, const GemmShape& shape) {
+    if (options.validateChunk == 0) {
+        return validate_result(out.data(), outVal.data(), out.size(), shape.K);
+    }
+    std::vector<AccT> expected(matrix_span(std::min(options.validateChunk, shape.M), shape.N, shape.ldc));
+    for (size_t row = 0; row < shape.M; row += options.validateChunk) {
+        GemmShape chunk = shape;
+        chunk.M = std::min(options.validateChunk, shape.M - row);
+        mm_host_reference(in1.data() + row * shape.lda, in2.data(), expected.data(), chunk);
+        if (!validate_result(out.data() + row * shape.ldc, expected.data(), matrix_span(chunk.M, shape.N, shape.ldc), shape.K)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// run one GEMM split by rows across all device queues at once, rebalancing the split between iterations
+// the kernel time is the longest kernel of any queue, since the queues run concurrently
+template <typename T, typename AccT>
+static void run_split(const std::string& typeName, const Options& options, std::vector<std::pair<std::string, queue>>& deviceQueues,
+                      HostMatrix<T>& in1, HostMatrix<T>& in2, HostMatrix<AccT>& out, std::vector<AccT>& outVal,
+                      const GemmShape& shape, std::vector<BenchResult>& results, bool& validationFailed) {
+    auto splitQueues = make_split_queues(deviceQueues, options.numa);
+    if (splitQueues.empty()) {
+        return;
+    }
+    std::string splitName = "split(";
+    std::vector<queue> queues;
+    for (auto& [deviceName, deviceQueue] : splitQueues) {
+        splitName += (queues.empty() ? "" : "+") + deviceName;
+        queues.push_back(deviceQueue);
+    }
+    splitName += ")";
+
+    for (size_t B : options.workGroups) {
+        std::cout << "Executing split kernel on " << splitName << " (" << shape.M << "x" << shape.K << "x" << shape.N << ", B = " << B << ")...\n";
+
+        std::vector<double> kernelTimes;
+        std::vector<double> totalTimes;
+        double firstTime = 0.0;
+        try {
+            SplitGemm<T, AccT> split(queues, B);
+            for (size_t iter = 0; iter < options.warmup + options.iterations; iter++) {
+                auto deviceStart = std::chrono::high_resolution_clock::now();
+                split.multiply(in1.data(), in2.data(), out.data(), shape);
+                auto deviceStop = std::chrono::high_resolution_clock::now();
+
+                // show how the rows moved between the queues
+                std::cout << "  iteration " << iter << ":";
+                for (size_t p = 0; p < queues.size(); p++) {
+                    std::cout << " " << splitQueues[p].first << " " << split.rows()[p] << " rows in " << split.part_times()[p] << " ms;";
+                }
+                std::cout << "\n";
 
-    // capture timing for end of offload
-    deviceStopCPU = std::chrono::high_resolution_clock::now();
-    deviceDurationCPU = std::chrono::duration_cast<std::chrono::milliseconds>(deviceStopCPU - deviceStartCPU);
+                if (iter == 0) {
+                    firstTime = std::chrono::duration<double, std::milli>(deviceStop - deviceStart).count();
+                }
+                if (iter < options.warmup) {
+                    continue;
+                }
+                kernelTimes.push_back(*std::max_element(split.kernel_times().begin(), split.kernel_times().end()));
+                totalTimes.push_back(std::chrono::duration<double, std::milli>(deviceStop - deviceStart).count());
+            }
+        }
+        catch (const std::exception& e) {
+            std::cout << "Skipping split kernel: " << e.what() << "\n\n";
+            continue;
+        }
 
-    std::cout << "Total offload time    : " << deviceDurationCPU.count() << " milliseconds\n\n";
+        BenchResult result;
+        result.device = splitName;
+        result.kernel = "split";
+        result.type = typeName;
+        result.M = shape.M;
+        result.K = shape.K;
+        result.N = shape.N;
+        result.B = B;
+        result.iterations = options.iterations;
+        result.firstTime = firstTime;
+        result.kernelTime = summarize(kernelTimes);
+        result.totalTime = summarize(totalTimes);
+        result.gflops = gemm_gflops(shape.M, shape.K, shape.N, result.kernelTime.median);
+        result.validation = "skipped";
+        if (options.validateResult) {
+            bool passed = check_output(options, in1, in2, out, outVal, shape);
+            result.validation = passed ? "passed" : "failed";
+            if (!passed) {
+                std::cout << "split kernel on " << splitName << " validation failed\n";
+                validationFailed = true;
+            }
+        }
+        results.push_back(result);
+    }
+}
+
+// run the out-of-core kernel on one device: the matrices stay on the host and pass through the device in panels
+// the kernel time is the sum of the panel kernels, the overlap of transfers and compute is printed for the last iteration
+template <typename T, typename AccT>
+static void run_stream(const std::string& typeName, const Options& options, const std::string& deviceName, queue& deviceQueue,
+                       HostMatrix<T>& in1, HostMatrix<T>& in2, HostMatrix<AccT>& out, std::vector<AccT>& outVal,
+                       const GemmShape& shape, std::vector<BenchResult>& results, bool& validationFailed) {
+    for (size_t B : options.workGroups) {
+        size_t panel = stream_panel_size<T, AccT>(options.streamMB * 1000000, B);
+        std::cout << "Executing stream kernel on " << deviceName << " (" << shape.M << "x" << shape.K << "x" << shape.N << ", B = " << B
+                  << ", " << panel << "x" << panel << " panels)...\n";
+
+        std::vector<double> kernelTimes;
+        std::vector<double> totalTimes;
+        double firstTime = 0.0;
+        try {
+            StreamGemm<T, AccT> stream(deviceQueue, panel, panel, panel, B);
+            for (size_t iter = 0; iter < options.warmup + options.iterations; iter++) {
+                auto deviceStart = std::chrono::high_resolution_clock::now();
+                stream.multiply(in1.data(), in2.data(), out.data(), shape);
+                auto deviceStop = std::chrono::high_resolution_clock::now();
+                if (iter == 0) {
+                    firstTime = std::chrono::duration<double, std::milli>(deviceStop - deviceStart).count();
+                }
+                if (iter < options.warmup) {
+                    continue;
+                }
+                kernelTimes.push_back(stream.stats().computeTime);
+                totalTimes.push_back(std::chrono::duration<double, std::milli>(deviceStop - deviceStart).count());
+            }
 
-    //------------------------ GPU BASIC ----------------------------------------------
+            const StreamStats& stats = stream.stats();
+            std::cout << "  " << stats.steps << " panel steps, " << stats.tiles << " tiles, " << stream.device_bytes() / 1.0e6 << " MB of device memory\n"
+                      << "  upload " << stats.uploadTime << " ms, compute " << stats.computeTime << " ms, download " << stats.downloadTime
+                      << " ms, device span " << stats.deviceTime << " ms, host packing " << stats.hostTime << " ms\n"
+                      << "  " << stats.hidden_percent() << "% of the transfer time overlapped with compute\n";
+        }
+        catch (const std::exception& e) {
+            std::cout << "Skipping stream kernel: " << e.what() << "\n\n";
+            continue;
+        }
 
-    // print GPU information
-    std::cout << "Offload Device      : " << deviceQueueGPU.get_device().get_info<info::device::name>() << "\n";
-    std::cout << "max_work_group_size : " << deviceQueueGPU.get_device().get_info<info::device::max_work_group_size>() << "\n\n";
+        BenchResult result;
+        result.device = deviceName;
+        result.kernel = "stream";
+        result.type = typeName;
+        result.M = shape.M;
+        result.K = shape.K;
+        result.N = shape.N;
+        result.B = B;
+        result.iterations = options.iterations;
+        result.firstTime = firstTime;
+        result.kernelTime = summarize(kernelTimes);
+        result.totalTime = summarize(totalTimes);
+        result.gflops = gemm_gflops(shape.M, shape.K, shape.N, result.kernelTime.median);
+        result.validation = "skipped";
+        if (options.validateResult) {
+            bool passed = check_output(options, in1, in2, out, outVal, shape);
+            result.validation = passed ? "passed" : "failed";
+            if (!passed) {
+                std::cout << "stream kernel on " << deviceName << " validation failed\n";
+                validationFailed = true;
+            }
+        }
+        results.push_back(result);
+    }
+}
+
+// the --out file of one shape and type, a sweep over several shapes or types (or a float fallback next to the
+// requested type) gets one file per configuration, with the type and shape inserted before the extension
+static std::string out_file_name(const Options& options, const std::string& typeName, const GemmShape& shape) {
+    bool single = options.shapes.size() == 1 && options.types.size() == 1 && typeName == options.types.front();
+    if (single) {
+        return options.outFile;
+    }
+    std::string suffix = "." + typeName + "." + std::to_string(shape.M) + "x" + std::to_string(shape.K) + "x" + std::to_string(shape.N);
+    // the fallback type name double->float is not a good file name
+    std::replace(suffix.begin(), suffix.end(), '>', '_');
+    size_t dot = options.outFile.find_last_of('.');
+    size_t slash = options.outFile.find_last_of('/');
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) {
+        return options.outFile + suffix;
+    }
+    return options.outFile.substr(0, dot) + suffix + options.outFile.substr(dot);
+}
+
+// run every shape, kernel, device, and work group combination for one element type
+// inputs have type T and results have the accumulator type AccT
+template <typename T, typename AccT>
+static void run_type(const std::string& typeName, const Options& options, std::vector<std::pair<std::string, queue>>& deviceQueues,
+                     bool runHost, TuneCache& tuneCache, std::map<std::string, std::future<double>>& prebuilds,
+                     std::vector<BenchResult>& results, bool& validationFailed, Tracer* tracer) {
+    // devices without fp64 run double in float, which cannot use a file of doubles in place
+    bool fromFiles = !options.in1File.empty();
+    if (fromFiles && MappedMatrix::open(options.in1File).header().dtype != matrix_dtype<T>()) {
+        std::cout << "Skipping " << typeName << ": the input files do not hold " << matrix_dtype_name(matrix_dtype<T>()) << " elements\n\n";
+        return;
+    }
 
-    // capture timing for start of GPU block
-    auto deviceStartGPU = std::chrono::high_resolution_clock::now();
+    for (GemmShape shape : options.shapes) {
+        // the leading dimensions of mapped inputs are fixed by the files
+        if (!fromFiles) {
+            shape.lda += options.padding;
+            shape.ldb += options.padding;
+        }
+        shape.ldc += options.padding;
+        size_t M = shape.M;
+        size_t K = shape.K;
+        size_t N = shape.N;
+
+        std::cout << "Running matrix multiplication (" << typeName << ")\n"
+                  << "Matrix size = [ " << M << " x " << K << " ] * [ " << K << " x " << N << " ]"
+                  << " (leading dimensions " << shape.lda << ", " << shape.ldb << ", " << shape.ldc << ")\n\n";
+
+        // define 1-D vectors with size to hold the matrices, including the padding between rows
+        // matrix files are mapped instead, the kernels then read the inputs from the page cache and write the result into the file
+        HostMatrix<T> in1 = fromFiles ? HostMatrix<T>(MappedMatrix::open(options.in1File)) : HostMatrix<T>(matrix_span(M, K, shape.lda));
+        HostMatrix<T> in2 = fromFiles ? HostMatrix<T>(MappedMatrix::open(options.in2File)) : HostMatrix<T>(matrix_span(K, N, shape.ldb));
+        std::string outFile = options.outFile.empty() ? std::string() : out_file_name(options, typeName, shape);
+        HostMatrix<AccT> out = outFile.empty()
+            ? HostMatrix<AccT>(matrix_span(M, N, shape.ldc))
+            : HostMatrix<AccT>(MappedMatrix::create(outFile, matrix_dtype<AccT>(), M, N, shape.ldc));
+        std::vector<AccT> outVal;
+
+        // load vectors, small integers are exact in every element type
+        // device initialization runs one work item per element instead of a serial loop, and is reproducible by seed
+        auto initStart = std::chrono::high_resolution_clock::now();
+        std::string initMethod = "rand() on host";
+        if (fromFiles) {
+            initMethod = "mapped from " + options.in1File + " and " + options.in2File;
+        }
+        else if (options.init == "device" && !deviceQueues.empty()) {
+            queue& initQueue = deviceQueues.front().second;
+            mm_random_fill(initQueue, in1.data(), M, K, shape.lda, options.seed, 0);
+            mm_random_fill(initQueue, in2.data(), K, N, shape.ldb, options.seed, 1);
+            initMethod = "Philox on " + deviceQueues.front().first;
+        }
+        else {
+            for (auto& value : in1) {
+                value = static_cast<T>(static_cast<float>(rand() % 100));
+            }
+            for (auto& value : in2) {
+                value = static_cast<T>(static_cast<float>(rand() % 100));
+            }
+        }
+        auto initStop = std::chrono::high_resolution_clock::now();
+        std::cout << "Input initialization : " << std::chrono::duration<double, std::milli>(initStop - initStart).count() << " ms ("
+                  << initMethod << ")\n\n";
+        if (!options.savePrefix.empty() && !fromFiles) {
+            write_matrix_file(options.savePrefix + ".in1.mat", in1.data(), M, K, shape.lda);
+            write_matrix_file(options.savePrefix + ".in2.mat", in2.data(), K, N, shape.ldb);
+            std::cout << "Inputs written to " << options.savePrefix << ".in1.mat and " << options.savePrefix << ".in2.mat\n\n";
+        }
 
-    // run matrix multiplication basic kernel on GPU
-    mm_basic_kernel(deviceQueueGPU, in1, in2, outGPU, N);
+        // host computation for validation, the padding of the output stays zero like the device output
+        // chunked validation computes the reference piece by piece when it checks a result instead
+        if (options.validateResult && options.validateChunk == 0) {
+            outVal.resize(out.size());
+            mm_host_reference(in1.data(), in2.data(), outVal.data(), shape);
+        }
 
-    // capture timing for end of SYCL block
-    auto deviceStopGPU = std::chrono::high_resolution_clock::now();
-    auto deviceDurationGPU = std::chrono::duration_cast<std::chrono::milliseconds>(deviceStopGPU - deviceStartGPU);
+        for (auto& kernel : options.kernels) {
 
-    std::cout << "Total offload time    : " << deviceDurationGPU.count() << " milliseconds\n\n";
+            //------------------------ HOST REFERENCE ----------------------------------------------
 
+            if (kernel == "host") {
+                if (!runHost) {
+                    continue;
+                }
+                // optimized non-SYCL host compute, timed the same way as the device kernels
+                std::vector<double> hostTimes;
+                double firstTime = 0.0;
+                for (size_t iter = 0; iter < options.warmup + options.iterations; iter++) {
+                    auto hostStart = std::chrono::high_resolution_clock::now();
+                    mm_host_reference(in1.data(), in2.data(), out.data(), shape);
+                    auto hostStop = std::chrono::high_resolution_clock::now();
+                    if (iter == 0) {
+                        firstTime = std::chrono::duration<double, std::milli>(hostStop - hostStart).count();
+                    }
+                    if (iter >= options.warmup) {
+                        hostTimes.push_back(std::chrono::duration<double, std::milli>(hostStop - hostStart).count());
+                    }
+                }
+                BenchResult result;
+                result.device = "host";
+                result.kernel = kernel;
+                result.type = typeName;
+                result.M = M;
+                result.K = K;
+                result.N = N;
+                result.iterations = options.iterations;
+                result.firstTime = firstTime;
+                result.kernelTime = summarize(hostTimes);
+                result.totalTime = result.kernelTime;
+                result.gflops = gemm_gflops(M, K, N, result.kernelTime.median);
+                result.validation = "skipped";
+                results.push_back(result);
+                continue;
+            }
 
-    //------------------------ GPU ND-RANGE ----------------------------------------------
+            //------------------------ SPLIT ACROSS DEVICES ----------------------------------------------
 
-    // capture timing for start of GPU block
-    deviceStartGPU = std::chrono::high_resolution_clock::now();
+            if (kernel == "split") {
+                run_split(typeName, options, deviceQueues, in1, in2, out, outVal, shape, results, validationFailed);
+                continue;
+            }
 
-    // run matrix multiplication basic kernel on GPU
-    mm_ndrange_kernel(deviceQueueGPU, in1, in2, outGPU, N, B);
+            //------------------------ DEVICE KERNELS ----------------------------------------------
+
+            for (auto& [deviceName, deviceQueue] : deviceQueues) {
+                // the host work above overlapped with the background build, wait for it before the first timed launch
+                auto prebuild = prebuilds.find(deviceName);
+                if (prebuild != prebuilds.end() && prebuild->second.valid()) {
+                    auto waitStart = std::chrono::high_resolution_clock::now();
+                    double buildTime = prebuild->second.get();
+                    auto waitStop = std::chrono::high_resolution_clock::now();
+                    std::cout << "Kernel build time on " << deviceName << ": " << buildTime << " ms (waited "
+                              << std::chrono::duration<double, std::milli>(waitStop - waitStart).count() << " ms for it)\n";
+                }
 
-    // capture timing for end of SYCL block
-    deviceStopGPU = std::chrono::high_resolution_clock::now();
-    deviceDurationGPU = std::chrono::duration_cast<std::chrono::milliseconds>(deviceStopGPU - deviceStartGPU);
+                if (kernel == "stream") {
+                    run_stream(typeName, options, deviceName, deviceQueue, in1, in2, out, outVal, shape, results, validationFailed);
+                    continue;
+                }
 
-    std::cout << "Total offload time    : " << deviceDurationGPU.count() << " milliseconds\n\n";
-    
-    
-    
-    
-    
-    
-    
-    
-    // can only validate if comparison exists
-    if (validateResult) {
-        compareResult = true;
-    }
+                for (size_t B : options.workGroups) {
+                    // the basic kernel does not use a work group size and the tuned kernel picks its own,
+                    // so they only run once per device
+                    if ((kernel == "basic" || kernel == "tuned") && B != options.workGroups.front()) {
+                        continue;
+                    }
 
-    // compare device time to host time
-    if (compareResult) {
-        // host computation for validation and timing comparision
-        auto vanillaStart = std::chrono::high_resolution_clock::now();
-        for (int i = 0; i < N; i++) {
-            for (int j = 0; j < N; j++) {
-                for (int k = 0; k < N; k++) {
-                    outVal[i * N + j] += in1[i * N + k] * in2[k * N + j];
-                }
-            }
-        }
-        auto vanillaStop = std::chrono::high_resolution_clock::now();
-        auto vanillaDuration = std::chrono::duration_cast<std::chrono::milliseconds>(vanillaStop - vanillaStart);
+                    // look up (or search for) the best variant and work group size for this device and shape
+                    std::string runKernel = kernel;
+                    if (kernel == "tuned") {
+                        try {
+                            auto tuneStart = std::chrono::high_resolution_clock::now();
+                            GemmConfig config = tuned_config<T, AccT>(deviceQueue, tuneCache, typeName, shape, options.retune);
+                            auto tuneStop = std::chrono::high_resolution_clock::now();
+                            std::cout << "Tuning lookup time   : " << std::chrono::duration<double, std::milli>(tuneStop - tuneStart).count() << " ms\n";
+                            runKernel = config.kernel;
+                            B = config.B;
+                        }
+                        catch (const std::exception& e) {
+                            std::cout << "Skipping tuned kernel: " << e.what() << "\n\n";
+                            continue;
+                        }
+                    }
 
-        std::cout << "Compare to non-SYCL sequential compute time:\n " << vanillaDuration.count() << " milliseconds\n";
+                    std::cout << "Executing " << runKernel << " kernel on " << deviceName << " (" << M << "x" << K << "x" << N << ", B = " << B << ")...\n";
+
+                    std::unique_ptr<GemmContext<T, AccT>> context;
+                    std::string traceName = runKernel + " " + typeName + " " + deviceName + " " + std::to_string(M) + "x" + std::to_string(K) + "x"
+                                            + std::to_string(N) + " B" + std::to_string(B);
+                    std::vector<double> kernelTimes;
+                    std::vector<double> totalTimes;
+                    double firstTime = 0.0;
+                    try {
+                        // warmup iterations absorb JIT compilation and first-touch costs
+                        // the first launch is reported separately, so the cost of compilation stays visible
+                        for (size_t iter = 0; iter < options.warmup + options.iterations; iter++) {
+                            // some kernels add to the output, so start every iteration from zero
+                            std::fill(out.begin(), out.end(), AccT(0));
+
+                            // capture timing for the whole offload
+                            auto deviceStart = std::chrono::high_resolution_clock::now();
+                            // the tracer keeps every event it records alive, so launches only go through it with --trace
+                            event firstEvent;
+                            auto launch = [&]() {
+                                if (runKernel == "chain") {
+                                    return run_chain(deviceQueue, context, in1, in2, out, shape, B, options.chainLength, firstEvent);
+                                }
+                                firstEvent = run_kernel(runKernel, deviceQueue, context, in1, in2, out, shape, B);
+                                return firstEvent;
+                            };
+                            event kernelEvent = tracer ? tracer->record(deviceQueue, traceName, launch) : launch();
+                            auto deviceStop = std::chrono::high_resolution_clock::now();
+
+                            if (iter == 0) {
+                                firstTime = std::chrono::duration<double, std::milli>(deviceStop - deviceStart).count();
+                            }
+                            if (iter < options.warmup) {
+                                continue;
+                            }
+
+                            // get reported times from kernel event profile
+                            // the chain kernel is timed from the start of its first multiplication to the end of its last,
+                            // and its times are per multiplication, so they compare directly with the context kernel
+                            auto kernel_end = kernelEvent.get_profiling_info<info::event_profiling::command_end>();
+                            auto kernel_start = firstEvent.get_profiling_info<info::event_profiling::command_start>();
+                            double multiplications = (runKernel == "chain") ? static_cast<double>(options.chainLength) : 1.0;
+                            kernelTimes.push_back((kernel_end - kernel_start) / 1.0e6 / multiplications);
+                            totalTimes.push_back(std::chrono::duration<double, std::milli>(deviceStop - deviceStart).count() / multiplications);
+                        }
+                    }
+                    catch (const std::exception& e) {
+                        std::cout << "Skipping " << kernel << " kernel: " << e.what() << "\n\n";
+                        continue;
+                    }
+                    context.reset();
+
+                    BenchResult result;
+                    result.device = deviceName;
+                    result.kernel = (kernel == "tuned") ? "tuned:" + runKernel : kernel;
+                    result.type = typeName;
+                    result.M = M;
+                    result.K = K;
+                    result.N = N;
+                    result.B = (kernel == "basic") ? 0 : B;
+                    result.iterations = options.iterations;
+                    result.firstTime = firstTime;
+                    result.kernelTime = summarize(kernelTimes);
+                    result.totalTime = summarize(totalTimes);
+                    result.gflops = gemm_gflops(M, K, N, result.kernelTime.median);
+                    result.validation = "skipped";
+
+                    // validate device results with host results
+                    if (options.validateResult) {
+                        bool passed = check_output(options, in1, in2, out, outVal, shape);
+                        result.validation = passed ? "passed" : "failed";
+                        if (!passed) {
+                            std::cout << kernel << " kernel on " << deviceName << " validation failed\n";
+                            validationFailed = true;
+                        }
+                    }
+                    results.push_back(result);
 
-        // validate device results with host results
-        if (validateResult) {
-            for (int i = 0; i < N; i++) {
-                for (int j = 0; j < N; j++) {
-                    if ((outCPU[i * N + j] - outVal[i * N + j]) > 1e-6) {
-                        std::cout << "CPU validation failed\n";
-                        return -1;
+                    // print
+                    if (options.printResult && (std::max({ M, K, N }) < 10)) {
+                        print_matrices(in1, in2, out, shape);
                     }
-                    if ((outGPU[i * N + j] - outVal[i * N + j]) > 1e-6) {
-                        std::cout << "GPU validation failed\n";
-                        return -1;
+                    else if (options.printResult) {
+                        std::cout << "Too big to print\n";
                     }
                 }
             }
-            std::cout << "Validation passed\n";
         }
+        // the result of the last kernel stays in the output file
+        if (!outFile.empty()) {
+            out.flush();
+            std::cout << "Result written to " << outFile << "\n";
+        }
+        std::cout << "\n";
+    }
+}
+
+// shape and element type of a GEMM on two matrix files, the leading dimensions are the ones stored in the files
+static GemmShape file_shape(const std::string& in1File, const std::string& in2File, std::string& typeName) {
+    MappedMatrix in1 = MappedMatrix::open(in1File);
+    MappedMatrix in2 = MappedMatrix::open(in2File);
+    const MatrixFileHeader& in1Header = in1.header();
+    const MatrixFileHeader& in2Header = in2.header();
+    if (in1Header.layout != MatrixLayout::row_major || in2Header.layout != MatrixLayout::row_major) {
+        throw std::invalid_argument("the kernels need row-major matrix files");
     }
+    if (in1Header.dtype != in2Header.dtype) {
+        throw std::invalid_argument("the input files hold different element types");
+    }
+    if (in1Header.cols != in2Header.rows) {
+        throw std::invalid_argument("in1 has " + std::to_string(in1Header.cols) + " columns but in2 has " + std::to_string(in2Header.rows) + " rows");
+    }
+    typeName = matrix_dtype_name(in1Header.dtype);
+    return GemmShape{ in1Header.rows, in1Header.cols, in2Header.cols, in1Header.ld, in2Header.ld, in2Header.cols };
+}
 
-    // print
-    if (printResult&&(N<10)) {
-        std::cout << "\n";
-        for (int i = 0; i < N; i++) {
-            std::cout << "[ ";
-            for (int j = 0; j < N; j++) {
-                std::cout << in1[i * N + j] << " ";
-            }
-            if (i == 0) {
-                std::cout << "] * [ ";
-            }
-            else {
-                std::cout << "]   [ ";
-            }
-            for (int j = 0; j < N; j++) {
-                std::cout << in2[i * N + j] << " ";
+int main(int argc, char* argv[]) {
+
+    Options options;
+
+    // parse command line options
+    try {
+        for (int i = 1; i < argc; i++) {
+            std::string arg = argv[i];
+            auto next_value = [&]() -> std::string {
+                if (i + 1 >= argc) {
+                    throw std::invalid_argument("missing value for " + arg);
+                }
+                return argv[++i];
+            };
+            if (arg == "--sizes" || arg == "--shapes") {
+                // the first --sizes or --shapes replaces the default size, later ones add to the list
+                std::vector<GemmShape> shapes;
+                if (arg == "--sizes") {
+                    for (size_t N : split_sizes(next_value())) {
+                        shapes.push_back(make_shape(N, N, N));
+                    }
+                }
+                else {
+                    shapes = split_shapes(next_value());
+                }
+                if (!options.shapesGiven) {
+                    options.shapes.clear();
+                    options.shapesGiven = true;
+                }
+                options.shapes.insert(options.shapes.end(), shapes.begin(), shapes.end());
             }
-            if (i == 0) {
-                std::cout << "] = [ ";
+            else if (arg == "--pad") options.padding = std::stoul(next_value());
+            else if (arg == "--workgroups") options.workGroups = split_sizes(next_value());
+            else if (arg == "--kernels") options.kernels = split_list(next_value());
+            else if (arg == "--devices") options.devices = split_list(next_value());
+            else if (arg == "--types") options.types = split_list(next_value());
+            else if (arg == "--warmup") options.warmup = std::stoul(next_value());
+            else if (arg == "--iterations") options.iterations = std::stoul(next_value());
+            else if (arg == "--chain") options.chainLength = std::stoul(next_value());
+            else if (arg == "--validate") options.validateResult = true;
+            else if (arg == "--validate-chunk") {
+                options.validateResult = true;
+                options.validateChunk = std::stoul(next_value());
             }
-            else {
-                std::cout << "]   [ ";
+            else if (arg == "--init") options.init = next_value();
+            else if (arg == "--seed") options.seed = std::stoull(next_value());
+            else if (arg == "--in1") options.in1File = next_value();
+            else if (arg == "--in2") options.in2File = next_value();
+            else if (arg == "--out") options.outFile = next_value();
+            else if (arg == "--save-inputs") options.savePrefix = next_value();
+            else if (arg == "--tune-cache") options.tuneCache = next_value();
+            else if (arg == "--retune") options.retune = true;
+            else if (arg == "--prebuild") options.prebuild = true;
+            else if (arg == "--numa") options.numa = true;
+            else if (arg == "--stream-mb") options.streamMB = std::stoul(next_value());
+            else if (arg == "--csv") options.csvFile = next_value();
+            else if (arg == "--json") options.jsonFile = next_value();
+            else if (arg == "--trace") options.traceFile = next_value();
+            else if (arg == "--print") options.printResult = true;
+            else if (arg == "--help" || arg == "-h") {
+                print_usage(argv[0]);
+                return 0;
             }
-            for (int j = 0; j < N; j++) {
-                std::cout << outCPU[i * N + j] << " ";
+            else throw std::invalid_argument("unknown option " + arg);
+        }
+        if (options.iterations == 0) {
+            throw std::invalid_argument("--iterations must be at least 1");
+        }
+        if (options.chainLength == 0) {
+            throw std::invalid_argument("--chain must be at least 1");
+        }
+        if (options.init != "host" && options.init != "device") {
+            throw std::invalid_argument("--init must be host or device");
+        }
+        if (options.in1File.empty() != options.in2File.empty()) {
+            throw std::invalid_argument("--in1 and --in2 have to be given together");
+        }
+        if (!options.in1File.empty()) {
+            // the files replace the generated inputs, so they decide the one shape and type that is run
+            std::string typeName;
+            options.shapes = { file_shape(options.in1File, options.in2File, typeName) };
+            options.types = { typeName };
+        }
+        for (auto& shape : options.shapes) {
+            check_shape(shape);
+        }
+        for (size_t B : options.workGroups) {
+            if (B == 0) {
+                throw std::invalid_argument("work group sizes must be at least 1");
             }
-            std::cout << "]\n";
         }
+        check_types(options.types);
     }
-    else if (printResult) {
-        std::cout << "Too big to print\n";
+    catch (const std::exception& e) {
+        std::cout << "Error: " << e.what() << "\n";
+        print_usage(argv[0]);
+        return -1;
     }
 
-    return 0;
-}
\ No newline at end of file
+    // create queues for the offload devices, skipping devices that are not available
+    std::vector<std::pair<std::string, queue>> deviceQueues;
+    for (auto& deviceName : options.devices) {
+        try {
+            queue deviceQueue = make_queue(deviceName);
+            std::cout << "Offload Device       : " << deviceQueue.get_device().get_info<info::device::name>() << " (" << deviceName << ")\n";
+            std::cout << "max_work_group_size  : " << deviceQueue.get_device().get_info<info::device::max_work_group_size>() << "\n";
+            std::cout << "fp64 / fp16 support  : " << deviceQueue.get_device().has(aspect::fp64) << " / " << deviceQueue.get_device().has(aspect::fp16) << "\n\n";
+            deviceQueues.emplace_back(deviceName, deviceQueue);
+        }
+        catch (const std::exception& e) {
+            std::cout << "Skipping device " << deviceName << ": " << e.what() << "\n\n";
+        }
+    }
+
+    std::vector<BenchResult> results;
+    bool validationFailed = false;
+    TuneCache tuneCache(options.tuneCache);
+    std::unique_ptr<Tracer> tracer;
+    if (!options.traceFile.empty()) {
+        tracer = std::make_unique<Tracer>();
+    }
+
+    // build the kernels for every device in the background while the host prepares inputs and reference results
+    std::map<std::string, std::future<double>> prebuilds;
+    if (options.prebuild) {
+        for (auto& [deviceName, deviceQueue] : deviceQueues) {
+            prebuilds[deviceName] = start_prebuild(deviceQueue, options);
+        }
+    }
+
+    // run every requested element type, with the fp64/fp16 fallbacks handled by run_types
+    run_types(options.types, deviceQueues, [&](auto inputType, auto accumulatorType, const std::string& typeName,
+                                                std::vector<std::pair<std::string, queue>>& typeQueues, bool runHost) {
+        using T = typename decltype(inputType)::type;
+        using AccT = typename decltype(accumulatorType)::type;
+        run_type<T, AccT>(typeName, options, typeQueues, runHost, tuneCache, prebuilds, results, validationFailed, tracer.get());
+    });
+
+    // report results
+    print_results(results);
+    if (!options.csvFile.empty()) {
+        write_csv(options.csvFile, results);
+        std::cout << "Results written to " << options.csvFile << "\n";
+    }
+    if (!options.jsonFile.empty()) {
+        write_json(options.jsonFile, results);
+        std::cout << "Results written to " << options.jsonFile << "\n";
+    }
+    if (tracer) {
+        std::cout << "\n";
+        tracer->print_summary();
+        std::cout << (tracer->write_chrome_trace(options.traceFile) ? "Trace written to " : "Could not write the trace to ") << options.traceFile << "\n";
+    }
+
+    if (options.validateResult) {
+        std::cout << (validationFailed ? "Validation failed\n" : "Validation passed\n");
+    }
+    return validationFailed ? -1 : 0;
+}
@@ -0,0 +1,100 @@
+#pragma once
+#include <CL/sycl.hpp>
+#include <sycl/ext/oneapi/bfloat16.hpp>
+#include <stdexcept>
+#include <vector>
+using namespace sycl;
+
+// element type combinations (input type, accumulator type) that the kernels are instantiated for
+// half and bfloat16 inputs accumulate in float, int8 inputs accumulate in int32
+#define MM_FOR_EACH_TYPE(MACRO)              \
+    MACRO(double, double)                    \
+    MACRO(float, float)                      \
+    MACRO(half, float)                       \
+    MACRO(ext::oneapi::bfloat16, float)      \
+    MACRO(int8_t, int32_t)
+
+// number of work items in a sub-group used by the sub-group kernel,
+// must be supported by the device (see info::device::sub_group_sizes)
+#define SUBGROUP_SIZE 16
+
+// shape of a general matrix multiplication out (M x N) = in1 (M x K) * in2 (K x N)
+// matrices are row-major and the leading dimension is the distance between the starts of two rows,
+// so a sub-matrix of a larger matrix can be used in place by passing a pointer to its first element
+// and the row length of the larger matrix as the leading dimension
+struct GemmShape {
+    size_t M = 0;
+    size_t K = 0;
+    size_t N = 0;
+    size_t lda = 0;  // leading dimension of in1, at least K
+    size_t ldb = 0;  // leading dimension of in2, at least N
+    size_t ldc = 0;  // leading dimension of out, at least N
+};
+
+// shape of densely packed matrices, the leading dimensions equal the row lengths
+inline GemmShape make_shape(size_t M, size_t K, size_t N) {
+    return { M, K, N, K, N, N };
+}
+
+// number of elements between the first and the last element of a rows x cols matrix, inclusive
+inline size_t matrix_span(size_t rows, size_t cols, size_t ld) {
+    return (rows - 1) * ld + cols;
+}
+
+// make sure the shape describes non-empty matrices whose rows do not overlap
+inline void check_shape(const GemmShape& shape) {
+    if (shape.M == 0 || shape.K == 0 || shape.N == 0) {
+        throw std::invalid_argument("matrix dimensions must be at least 1");
+    }
+    if (shape.lda < shape.K || shape.ldb < shape.N || shape.ldc < shape.N) {
+        throw std::invalid_argument("leading dimensions must be at least the row length");
+    }
+}
+
+// define kernels for offloading computations
+// every kernel multiplies the matrices in1 and in2 (type T) into out (type AccT) and returns the kernel event,
+// which has completed by the time the function returns and can be used for profiling
+// the pointer versions take host memory and any M x K x N shape, edge work items that fall outside
+// the matrices are masked, so the sizes do not have to be multiples of the work group size
+// the vector versions multiply packed NxN matrices
+// the basic and ND-range kernels add to out, so it must be zeroed before they are called
+template <typename T, typename AccT>
+event mm_basic_kernel(queue& deviceQueue, const T* in1, const T* in2, AccT* out, const GemmShape& shape);
+template <typename T, typename AccT>
+event mm_basic_kernel(queue& deviceQueue, std::vector<T>& in1, std::vector<T>& in2, std::vector<AccT>& out, size_t N);
+template <typename T, typename AccT>
+event mm_ndrange_kernel(queue& deviceQueue, const T* in1, const T* in2, AccT* out, const GemmShape& shape, size_t B);
+template <typename T, typename AccT>
+event mm_ndrange_kernel(queue& deviceQueue, std::vector<T>& in1, std::vector<T>& in2, std::vector<AccT>& out, size_t N, size_t B);
+template <typename T, typename AccT>
+event mm_tiled_kernel(queue& deviceQueue, const T* in1, const T* in2, AccT* out, const GemmShape& shape, size_t B);
+template <typename T, typename AccT>
+event mm_tiled_kernel(queue& deviceQueue, std::vector<T>& in1, std::vector<T>& in2, std::vector<AccT>& out, size_t N, size_t B);
+template <typename T, typename AccT, size_t TM, size_t TN>
+event mm_subgroup_kernel(queue& deviceQueue, const T* in1, const T* in2, AccT* out, const GemmShape& shape, size_t B);
+template <typename T, typename AccT, size_t TM, size_t TN>
+event mm_subgroup_kernel(queue& deviceQueue, std::vector<T>& in1, std::vector<T>& in2, std::vector<AccT>& out, size_t N, size_t B);
+
+// tiled kernel on USM device (or shared) memory, for callers that keep their data on the device
+// it writes out (or adds to it when accumulate is set), does not wait, and returns as soon as the kernel is queued
+template <typename T, typename AccT>
+event mm_tiled_usm_kernel(queue& deviceQueue, const T* in1, const T* in2, AccT* out, const GemmShape& shape, size_t B,
+                          const std::vector<event>& dependencies = {}, bool accumulate = false);
+
+// batched kernels multiply batchCount independent NxN matrices in one launch, for many small matrices
+// all pointers are USM device (or shared) pointers, the kernels do not wait and return immediately
+// strided: matrix b starts at in1 + b * strideIn1 (same for in2 and out)
+// pointer: matrix b starts at in1[b], the pointer arrays themselves must also be device accessible
+template <typename T, typename AccT>
+event mm_batched_strided_kernel(queue& deviceQueue, const T* in1, const T* in2, AccT* out, size_t N, size_t batchCount,
+                                size_t strideIn1, size_t strideIn2, size_t strideOut, const std::vector<event>& dependencies = {});
+template <typename T, typename AccT>
+event mm_batched_pointer_kernel(queue& deviceQueue, const T* const* in1, const T* const* in2, AccT* const* out, size_t N, size_t batchCount,
+                                const std::vector<event>& dependencies = {});
+
+// define host reference for validation and timing comparison
+// out is overwritten, elements between the rows of a strided output are left untouched
+template <typename T, typename AccT>
+void mm_host_reference(const T* in1, const T* in2, AccT* out, const GemmShape& shape);
+template <typename T, typename AccT>
+void mm_host_reference(std::vector<T>& in1, std::vector<T>& in2, std::vector<AccT>& out, size_t N);
@@ -0,0 +1,201 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+#include "mm_matrix_file.hpp"
+
+static const char MATRIX_FILE_MAGIC[8] = "SYCLMAT";
+
+std::string matrix_dtype_name(MatrixDtype dtype) {
+    switch (dtype) {
+    case MatrixDtype::float64: return "double";
+    case MatrixDtype::float32: return "float";
+    case MatrixDtype::float16: return "half";
+    case MatrixDtype::bfloat16: return "bfloat16";
+    case MatrixDtype::int8: return "int8";
+    case MatrixDtype::int32: return "int32";
+    }
+    return "unknown";
+}
+
+size_t matrix_dtype_size(MatrixDtype dtype) {
+    switch (dtype) {
+    case MatrixDtype::float64: return 8;
+    case MatrixDtype::float32: return 4;
+    case MatrixDtype::float16: return 2;
+    case MatrixDtype::bfloat16: return 2;
+    case MatrixDtype::int8: return 1;
+    case MatrixDtype::int32: return 4;
+    }
+    return 0;
+}
+
+// error message of a failed system call on a file
+static std::runtime_error file_error(const std::string& fileName, const std::string& what) {
+    return std::runtime_error("cannot " + what + " " + fileName + ": " + std::strerror(errno));
+}
+
+MappedMatrix MappedMatrix::open(const std::string& fileName) {
+    int fd = ::open(fileName.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw file_error(fileName, "open");
+    }
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) != 0) {
+        ::close(fd);
+        throw file_error(fileName, "stat");
+    }
+    size_t fileBytes = static_cast<size_t>(fileStat.st_size);
+    if (fileBytes < sizeof(MatrixFileHeader)) {
+        ::close(fd);
+        throw std::runtime_error(fileName + " is too short to be a matrix file");
+    }
+
+    // private and writable: kernels may take the data as a non-const pointer, but writes would only touch private copies
+    // of the pages, and the mapping stays valid after the file descriptor is closed
+    MappedMatrix matrix;
+    matrix.fileName = fileName;
+    matrix.mappingBytes = fileBytes;
+    matrix.mapping = mmap(nullptr, fileBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (matrix.mapping == MAP_FAILED) {
+        matrix.mapping = nullptr;
+        throw file_error(fileName, "map");
+    }
+
+    // check the header before anything is read through it
+    const MatrixFileHeader& header = matrix.header();
+    if (std::memcmp(header.magic, MATRIX_FILE_MAGIC, sizeof(header.magic)) != 0) {
+        throw std::runtime_error(fileName + " is not a matrix file");
+    }
+    if (header.version != MATRIX_FILE_VERSION) {
+        throw std::runtime_error(fileName + ": version " + std::to_string(header.version) + " is not supported");
+    }
+    if (matrix_dtype_size(header.dtype) == 0) {
+        throw std::runtime_error(fileName + ": unknown element type");
+    }
+    if (header.layout != MatrixLayout::row_major && header.layout != MatrixLayout::column_major) {
+        throw std::runtime_error(fileName + ": unknown layout");
+    }
+    size_t inner = header.layout == MatrixLayout::row_major ? header.cols : header.rows;
+    if (header.rows == 0 || header.cols == 0 || header.ld < inner) {
+        throw std::runtime_error(fileName + ": invalid dimensions");
+    }
+    if (header.dataOffset < sizeof(MatrixFileHeader) || header.alignment == 0 || header.dataOffset % header.alignment != 0) {
+        throw std::runtime_error(fileName + ": invalid data offset");
+    }
+    if (header.dataOffset + matrix.elements() * matrix_dtype_size(header.dtype) > fileBytes) {
+        throw std::runtime_error(fileName + " is shorter than its header says");
+    }
+
+    // the kernels read the matrix once from start to end, so let the kernel read ahead
+    madvise(matrix.mapping, fileBytes, MADV_SEQUENTIAL);
+    return matrix;
+}
+
+MappedMatrix MappedMatrix::create(const std::string& fileName, MatrixDtype dtype, size_t rows, size_t cols, size_t ld,
+                                  size_t alignment) {
+    if (rows == 0 || cols == 0 || ld < cols) {
+        throw std::invalid_argument("invalid matrix file dimensions");
+    }
+    if (alignment == 0 || alignment % alignof(MatrixFileHeader) != 0) {
+        throw std::invalid_argument("the matrix file alignment must be a multiple of " + std::to_string(alignof(MatrixFileHeader)));
+    }
+    size_t dataOffset = (sizeof(MatrixFileHeader) + alignment - 1) / alignment * alignment;
+    size_t fileBytes = dataOffset + matrix_span(rows, cols, ld) * matrix_dtype_size(dtype);
+
+    int fd = ::open(fileName.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        throw file_error(fileName, "create");
+    }
+    // the file is extended with zeros, so the padding between the rows reads as zero
+    if (ftruncate(fd, static_cast<off_t>(fileBytes)) != 0) {
+        ::close(fd);
+        throw file_error(fileName, "resize");
+    }
+    MappedMatrix matrix;
+    matrix.fileName = fileName;
+    matrix.mappingBytes = fileBytes;
+    matrix.shared = true;
+    matrix.mapping = mmap(nullptr, fileBytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (matrix.mapping == MAP_FAILED) {
+        matrix.mapping = nullptr;
+        throw file_error(fileName, "map");
+    }
+
+    MatrixFileHeader header{};
+    std::memcpy(header.magic, MATRIX_FILE_MAGIC, sizeof(header.magic));
+    header.version = MATRIX_FILE_VERSION;
+    header.dtype = dtype;
+    header.layout = MatrixLayout::row_major;
+    header.alignment = static_cast<uint32_t>(alignment);
+    header.rows = rows;
+    header.cols = cols;
+    header.ld = ld;
+    header.dataOffset = dataOffset;
+    std::memcpy(matrix.mapping, &header, sizeof(header));
+    return matrix;
+}
+
+MappedMatrix::MappedMatrix(MappedMatrix&& other) noexcept {
+    *this = std::move(other);
+}
+
+MappedMatrix& MappedMatrix::operator=(MappedMatrix&& other) noexcept {
+    if (this != &other) {
+        close();
+        fileName = std::move(other.fileName);
+        mapping = std::exchange(other.mapping, nullptr);
+        mappingBytes = std::exchange(other.mappingBytes, 0);
+        shared = other.shared;
+    }
+    return *this;
+}
+
+MappedMatrix::~MappedMatrix() {
+    close();
+}
+
+size_t MappedMatrix::elements() const {
+    const MatrixFileHeader& fileHeader = header();
+    if (fileHeader.layout == MatrixLayout::row_major) {
+        return matrix_span(fileHeader.rows, fileHeader.cols, fileHeader.ld);
+    }
+    return matrix_span(fileHeader.cols, fileHeader.rows, fileHeader.ld);
+}
+
+void MappedMatrix::flush() {
+    if (mapping && shared && msync(mapping, mappingBytes, MS_SYNC) != 0) {
+        throw file_error(fileName, "write");
+    }
+}
+
+void MappedMatrix::close() {
+    if (mapping) {
+        // munmap writes a shared mapping back on its own, errors on the way are only seen by flush
+        munmap(mapping, mappingBytes);
+        mapping = nullptr;
+    }
+}
+
+template <typename T>
+void write_matrix_file(const std::string& fileName, const T* matrix, size_t rows, size_t cols, size_t ld) {
+    MappedMatrix file = MappedMatrix::create(fileName, matrix_dtype<T>(), rows, cols, ld);
+    T* data = file.data<T>();
+    for (size_t i = 0; i < rows; i++) {
+        std::copy_n(matrix + i * ld, cols, data + i * ld);
+    }
+    file.flush();
+}
+
+// the template is defined in this file, so instantiate the element types used by the host program
+// (inputs and results, the int8 results are int32)
+#define MM_INSTANTIATE_MATRIX_FILE(T, AccT) \
+    template void write_matrix_file<T>(const std::string& fileName, const T* matrix, size_t rows, size_t cols, size_t ld);
+MM_FOR_EACH_TYPE(MM_INSTANTIATE_MATRIX_FILE)
+template void write_matrix_file<int32_t>(const std::string& fileName, const int32_t* matrix, size_t rows, size_t cols, size_t ld);
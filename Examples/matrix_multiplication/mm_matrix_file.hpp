@@ -0,0 +1,133 @@
+#pragma once
+#include <CL/sycl.hpp>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+#include "mm_kernels.hpp"
+using namespace sycl;
+
+// default alignment of the matrix data in a file in bytes, one page, so the mapped data starts on a page boundary
+#define MATRIX_FILE_ALIGNMENT 4096
+#define MATRIX_FILE_VERSION 1
+
+// element type of a matrix file, the names match the --types names of the harness (plus int32 for int8 results)
+enum class MatrixDtype : uint32_t { float64 = 1, float32 = 2, float16 = 3, bfloat16 = 4, int8 = 5, int32 = 6 };
+enum class MatrixLayout : uint32_t { row_major = 0, column_major = 1 };
+
+// header at the start of every matrix file, 64 bytes in host byte order
+// the elements follow at dataOffset, stored like the GEMM inputs: rows (or columns) ld elements apart
+struct MatrixFileHeader {
+    char magic[8];          // "SYCLMAT" and a zero byte
+    uint32_t version;       // MATRIX_FILE_VERSION
+    MatrixDtype dtype;
+    MatrixLayout layout;
+    uint32_t alignment;     // dataOffset is a multiple of it
+    uint64_t rows;
+    uint64_t cols;
+    uint64_t ld;            // leading dimension, elements between the starts of two rows (two columns if column-major)
+    uint64_t dataOffset;    // bytes from the start of the file to the first element
+    uint64_t reserved;
+};
+static_assert(sizeof(MatrixFileHeader) == 64, "the matrix file header must be 64 bytes");
+
+template <typename T> MatrixDtype matrix_dtype();
+template <> inline MatrixDtype matrix_dtype<double>() { return MatrixDtype::float64; }
+template <> inline MatrixDtype matrix_dtype<float>() { return MatrixDtype::float32; }
+template <> inline MatrixDtype matrix_dtype<half>() { return MatrixDtype::float16; }
+template <> inline MatrixDtype matrix_dtype<ext::oneapi::bfloat16>() { return MatrixDtype::bfloat16; }
+template <> inline MatrixDtype matrix_dtype<int8_t>() { return MatrixDtype::int8; }
+template <> inline MatrixDtype matrix_dtype<int32_t>() { return MatrixDtype::int32; }
+
+// type name of a dtype ("double", "float", ...) and its size in bytes
+std::string matrix_dtype_name(MatrixDtype dtype);
+size_t matrix_dtype_size(MatrixDtype dtype);
+
+// MappedMatrix maps a matrix file into memory with mmap, so the elements are read from the page cache on first touch
+// instead of being parsed into a copy
+// files opened for reading are mapped private: the data can be handed to kernels as a writable pointer,
+// but nothing is ever written back to the file
+// created files are mapped shared, stores go to the file and are flushed when the mapping is closed
+class MappedMatrix {
+public:
+    // map an existing file, throws std::runtime_error if it is not a valid matrix file
+    static MappedMatrix open(const std::string& fileName);
+    // create (or replace) a file for a row-major rows x cols matrix with leading dimension ld, filled with zeros
+    static MappedMatrix create(const std::string& fileName, MatrixDtype dtype, size_t rows, size_t cols, size_t ld,
+                               size_t alignment = MATRIX_FILE_ALIGNMENT);
+
+    MappedMatrix(MappedMatrix&& other) noexcept;
+    MappedMatrix& operator=(MappedMatrix&& other) noexcept;
+    ~MappedMatrix();
+
+    // the object owns the mapping, so it cannot be copied
+    MappedMatrix(const MappedMatrix&) = delete;
+    MappedMatrix& operator=(const MappedMatrix&) = delete;
+
+    const MatrixFileHeader& header() const { return *static_cast<const MatrixFileHeader*>(mapping); }
+
+    // first element, throws if the file does not hold elements of type T
+    template <typename T>
+    T* data() const {
+        if (header().dtype != matrix_dtype<T>()) {
+            throw std::runtime_error(fileName + " holds " + matrix_dtype_name(header().dtype) + " elements, not " +
+                                     matrix_dtype_name(matrix_dtype<T>()));
+        }
+        return reinterpret_cast<T*>(static_cast<char*>(mapping) + header().dataOffset);
+    }
+
+    // number of elements from the first to the last one, including the padding between rows
+    size_t elements() const;
+
+    // write the changes of a created file back to disk
+    void flush();
+
+    const std::string& name() const { return fileName; }
+
+private:
+    MappedMatrix() = default;
+    void close();
+
+    std::string fileName;
+    void* mapping = nullptr;
+    size_t mappingBytes = 0;
+    bool shared = false;
+};
+
+// write a row-major rows x cols matrix with leading dimension ld to a new file with the same leading dimension
+template <typename T>
+void write_matrix_file(const std::string& fileName, const T* matrix, size_t rows, size_t cols, size_t ld);
+
+// HostMatrix holds a matrix in host memory, either in its own vector or in a mapped matrix file,
+// so the harness hands kernels the file contents directly, with no copy into a vector first
+// kernels on host pointers wrap it in use_host_ptr buffers, and the USM kernels copy from it straight into device memory
+template <typename T>
+class HostMatrix {
+public:
+    // count zeroed elements in a vector
+    explicit HostMatrix(size_t count) : storage(count), pointer(storage.data()), count(count) {}
+    // the elements of a mapped file, which must hold elements of type T
+    explicit HostMatrix(MappedMatrix mappedFile)
+        : file(std::move(mappedFile)), pointer(file->template data<T>()), count(file->elements()) {}
+
+    T* data() { return pointer; }
+    const T* data() const { return pointer; }
+    size_t size() const { return count; }
+    T* begin() { return pointer; }
+    T* end() { return pointer + count; }
+    T& operator[](size_t i) { return pointer[i]; }
+    const T& operator[](size_t i) const { return pointer[i]; }
+
+    // write the contents back to disk if the matrix is a created file
+    void flush() {
+        if (file) {
+            file->flush();
+        }
+    }
+
+private:
+    std::vector<T> storage;
+    std::optional<MappedMatrix> file;
+    T* pointer;
+    size_t count;
+};
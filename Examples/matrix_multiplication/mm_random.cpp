@@ -0,0 +1,39 @@
+#include <CL/sycl.hpp>
+#include "mm_random.hpp"
+using namespace sycl;
+
+template <typename T>
+event mm_random_fill(queue& deviceQueue, T* matrix, size_t rows, size_t cols, size_t ld, uint64_t seed, uint32_t stream) {
+    // the buffer spans the matrix including the padding between rows, and writes it back to the host when destroyed
+    buffer<T, 1> matrixBuffer(matrix, range<1>{ matrix_span(rows, cols, ld) });
+
+    // submit work to the queue and capture details in event
+    auto queueEvent = deviceQueue.submit([&](handler& queueHandler) {
+
+    // write (not discard_write) keeps the host contents, so the padding between rows comes back unchanged
+    auto matrixAccessor = matrixBuffer.template get_access<access::mode::write>(queueHandler);
+
+    // one work item per element, each one computes its own random number from its index
+    queueHandler.parallel_for(range<2>{ rows, cols }, [=](id<2> index) {
+        size_t row = index[0];
+        size_t col = index[1];
+        uint32_t value = philox_uint32(seed, stream, row * cols + col) % 100;
+        // same conversion as the host initialization, small integers are exact in every element type
+        matrixAccessor[row * ld + col] = static_cast<T>(static_cast<float>(value));
+        });
+    });
+
+    // allow read access on the matrix buffer
+    matrixBuffer.template get_access<access::mode::read>();
+
+    // wait until the queue is done executing on the kernel
+    deviceQueue.wait();
+
+    // return the kernel event so the caller can read the profiling results
+    return queueEvent;
+}
+
+// the template is defined in this file, so instantiate the element types used by the host program
+#define MM_INSTANTIATE_RANDOM(T, AccT) \
+    template event mm_random_fill<T>(queue& deviceQueue, T* matrix, size_t rows, size_t cols, size_t ld, uint64_t seed, uint32_t stream);
+MM_FOR_EACH_TYPE(MM_INSTANTIATE_RANDOM)
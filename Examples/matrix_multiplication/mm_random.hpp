@@ -0,0 +1,36 @@
+#pragma once
+#include <CL/sycl.hpp>
+#include <cstdint>
+#include "mm_kernels.hpp"
+using namespace sycl;
+
+// Philox4x32-10 counter-based random number generator (Salmon et al., "Parallel random numbers: as easy as 1, 2, 3")
+// every value is a pure function of (seed, stream, index), so any work item can produce its element without
+// shared state, and the same seed gives the same matrices on every device and in every run
+// it only uses 32-bit integer multiplies, so it runs in device code as well as on the host
+inline uint32_t philox_uint32(uint64_t seed, uint32_t stream, uint64_t index) {
+    uint32_t counter[4] = { static_cast<uint32_t>(index), static_cast<uint32_t>(index >> 32), stream, 0 };
+    uint32_t key[2] = { static_cast<uint32_t>(seed), static_cast<uint32_t>(seed >> 32) };
+    for (int round = 0; round < 10; round++) {
+        uint64_t product0 = static_cast<uint64_t>(0xD2511F53u) * counter[0];
+        uint64_t product1 = static_cast<uint64_t>(0xCD9E8D57u) * counter[2];
+        uint32_t next[4] = {
+            static_cast<uint32_t>(product1 >> 32) ^ counter[1] ^ key[0],
+            static_cast<uint32_t>(product1),
+            static_cast<uint32_t>(product0 >> 32) ^ counter[3] ^ key[1],
+            static_cast<uint32_t>(product0),
+        };
+        for (int i = 0; i < 4; i++) {
+            counter[i] = next[i];
+        }
+        key[0] += 0x9E3779B9u;
+        key[1] += 0xBB67AE85u;
+    }
+    return counter[0];
+}
+
+// fill a rows x cols host matrix with leading dimension ld with the integers 0 to 99 on the device
+// element (i, j) gets philox_uint32(seed, stream, i * cols + j) % 100, so it does not depend on the padding
+// the elements between the rows are left untouched, the call waits until the matrix is back on the host
+template <typename T>
+event mm_random_fill(queue& deviceQueue, T* matrix, size_t rows, size_t cols, size_t ld, uint64_t seed, uint32_t stream);
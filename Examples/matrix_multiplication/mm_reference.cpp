@@ -0,0 +1,187 @@
+#include <algorithm>
+#include <thread>
+#include <vector>
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+#include "mm_kernels.hpp"
+
+// block sizes for the host reference
+// a BLOCK_K x BLOCK_N panel of in2 (1 MB of doubles) is reused from L2 by every row,
+// and a BLOCK_N segment of an output row (4 KB of doubles) stays in L1 while it is updated
+#define REFERENCE_BLOCK_K 256
+#define REFERENCE_BLOCK_N 512
+// number of output rows updated together, so every in2 load is reused ROWS times
+#define REFERENCE_ROWS 4
+
+// out[r][j] += a[r] * b[j] for every row r and j < count
+// this is the i-k-j inner loop, the generic version converts every element to the accumulator type
+// and is left to the compiler to vectorize
+template <size_t ROWS, typename T, typename AccT>
+static void mm_reference_axpy(const AccT* a, const T* b, AccT* const* out, size_t count) {
+    for (size_t j = 0; j < count; j++) {
+        AccT bValue = static_cast<AccT>(b[j]);
+        for (size_t r = 0; r < ROWS; r++) {
+            out[r][j] += a[r] * bValue;
+        }
+    }
+}
+
+// double version, vectorized explicitly with AVX-512 or AVX2 when the compiler targets them
+template <size_t ROWS>
+static void mm_reference_axpy(const double* a, const double* b, double* const* out, size_t count) {
+    size_t j = 0;
+
+#if defined(__AVX512F__)
+    __m512d a512[ROWS];
+    for (size_t r = 0; r < ROWS; r++) {
+        a512[r] = _mm512_set1_pd(a[r]);
+    }
+    for (; j + 8 <= count; j += 8) {
+        __m512d b512 = _mm512_loadu_pd(b + j);
+        for (size_t r = 0; r < ROWS; r++) {
+            _mm512_storeu_pd(out[r] + j, _mm512_fmadd_pd(a512[r], b512, _mm512_loadu_pd(out[r] + j)));
+        }
+    }
+#endif
+
+#if defined(__AVX2__) && defined(__FMA__)
+    __m256d a256[ROWS];
+    for (size_t r = 0; r < ROWS; r++) {
+        a256[r] = _mm256_set1_pd(a[r]);
+    }
+    for (; j + 4 <= count; j += 4) {
+        __m256d b256 = _mm256_loadu_pd(b + j);
+        for (size_t r = 0; r < ROWS; r++) {
+            _mm256_storeu_pd(out[r] + j, _mm256_fmadd_pd(a256[r], b256, _mm256_loadu_pd(out[r] + j)));
+        }
+    }
+#endif
+
+    // scalar tail (and the whole row when no vector instructions are available)
+    for (; j < count; j++) {
+        for (size_t r = 0; r < ROWS; r++) {
+            out[r][j] += a[r] * b[j];
+        }
+    }
+}
+
+// float version, same as the double version with twice as many lanes per register
+template <size_t ROWS>
+static void mm_reference_axpy(const float* a, const float* b, float* const* out, size_t count) {
+    size_t j = 0;
+
+#if defined(__AVX512F__)
+    __m512 a512[ROWS];
+    for (size_t r = 0; r < ROWS; r++) {
+        a512[r] = _mm512_set1_ps(a[r]);
+    }
+    for (; j + 16 <= count; j += 16) {
+        __m512 b512 = _mm512_loadu_ps(b + j);
+        for (size_t r = 0; r < ROWS; r++) {
+            _mm512_storeu_ps(out[r] + j, _mm512_fmadd_ps(a512[r], b512, _mm512_loadu_ps(out[r] + j)));
+        }
+    }
+#endif
+
+#if defined(__AVX2__) && defined(__FMA__)
+    __m256 a256[ROWS];
+    for (size_t r = 0; r < ROWS; r++) {
+        a256[r] = _mm256_set1_ps(a[r]);
+    }
+    for (; j + 8 <= count; j += 8) {
+        __m256 b256 = _mm256_loadu_ps(b + j);
+        for (size_t r = 0; r < ROWS; r++) {
+            _mm256_storeu_ps(out[r] + j, _mm256_fmadd_ps(a256[r], b256, _mm256_loadu_ps(out[r] + j)));
+        }
+    }
+#endif
+
+    for (; j < count; j++) {
+        for (size_t r = 0; r < ROWS; r++) {
+            out[r][j] += a[r] * b[j];
+        }
+    }
+}
+
+// compute rows [rowStart, rowEnd) of out = in1 * in2, run by one thread
+template <typename T, typename AccT>
+static void mm_reference_rows(const T* in1, const T* in2, AccT* out, GemmShape shape, size_t rowStart, size_t rowEnd) {
+    size_t K = shape.K;
+    size_t N = shape.N;
+    size_t lda = shape.lda;
+    size_t ldb = shape.ldb;
+    size_t ldc = shape.ldc;
+
+    // only the N elements of each output row are cleared, padding between rows is left alone
+    for (size_t i = rowStart; i < rowEnd; i++) {
+        std::fill(out + i * ldc, out + i * ldc + N, AccT(0));
+    }
+
+    for (size_t jBlock = 0; jBlock < N; jBlock += REFERENCE_BLOCK_N) {
+        size_t jCount = std::min<size_t>(REFERENCE_BLOCK_N, N - jBlock);
+
+        for (size_t kBlock = 0; kBlock < K; kBlock += REFERENCE_BLOCK_K) {
+            size_t kEnd = std::min<size_t>(kBlock + REFERENCE_BLOCK_K, K);
+
+            // update REFERENCE_ROWS output rows at a time
+            size_t i = rowStart;
+            for (; i + REFERENCE_ROWS <= rowEnd; i += REFERENCE_ROWS) {
+                AccT* outRows[REFERENCE_ROWS];
+                for (size_t r = 0; r < REFERENCE_ROWS; r++) {
+                    outRows[r] = out + (i + r) * ldc + jBlock;
+                }
+                for (size_t k = kBlock; k < kEnd; k++) {
+                    AccT a[REFERENCE_ROWS];
+                    for (size_t r = 0; r < REFERENCE_ROWS; r++) {
+                        a[r] = static_cast<AccT>(in1[(i + r) * lda + k]);
+                    }
+                    mm_reference_axpy<REFERENCE_ROWS>(a, in2 + k * ldb + jBlock, outRows, jCount);
+                }
+            }
+
+            // leftover rows are updated one at a time
+            for (; i < rowEnd; i++) {
+                AccT* outRow = out + i * ldc + jBlock;
+                for (size_t k = kBlock; k < kEnd; k++) {
+                    AccT a = static_cast<AccT>(in1[i * lda + k]);
+                    mm_reference_axpy<1>(&a, in2 + k * ldb + jBlock, &outRow, jCount);
+                }
+            }
+        }
+    }
+}
+
+// optimized host matrix multiplication without SYCL, used for validation and as a timing baseline
+// uses i-k-j loop order, cache blocking, explicit SIMD, and one std::thread per hardware thread
+template <typename T, typename AccT>
+void mm_host_reference(const T* in1, const T* in2, AccT* out, const GemmShape& shape) {
+    check_shape(shape);
+    size_t M = shape.M;
+
+    // split the output rows evenly between the threads, in multiples of REFERENCE_ROWS
+    size_t numThreads = std::min<size_t>(std::thread::hardware_concurrency(), (M + REFERENCE_ROWS - 1) / REFERENCE_ROWS);
+    numThreads = std::max<size_t>(numThreads, 1);
+    size_t rowsPerThread = (M + numThreads - 1) / numThreads;
+    rowsPerThread = (rowsPerThread + REFERENCE_ROWS - 1) / REFERENCE_ROWS * REFERENCE_ROWS;
+
+    std::vector<std::thread> threads;
+    for (size_t rowStart = 0; rowStart < M; rowStart += rowsPerThread) {
+        size_t rowEnd = std::min(rowStart + rowsPerThread, M);
+        threads.emplace_back(mm_reference_rows<T, AccT>, in1, in2, out, shape, rowStart, rowEnd);
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+template <typename T, typename AccT>
+void mm_host_reference(std::vector<T>& in1, std::vector<T>& in2, std::vector<AccT>& out, size_t N) {
+    mm_host_reference(in1.data(), in2.data(), out.data(), make_shape(N, N, N));
+}
+
+// the template is defined in this file, so instantiate the element types used by the host program
+#define MM_INSTANTIATE_REFERENCE(T, AccT) \
+    template void mm_host_reference<T, AccT>(const T* in1, const T* in2, AccT* out, const GemmShape& shape); \
+    template void mm_host_reference<T, AccT>(std::vector<T>& in1, std::vector<T>& in2, std::vector<AccT>& out, size_t N);
+MM_FOR_EACH_TYPE(MM_INSTANTIATE_REFERENCE)
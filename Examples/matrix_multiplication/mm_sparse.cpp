@@ -0,0 +1,303 @@
+#include <CL/sycl.hpp>
+#include "mm_sparse.hpp"
+using namespace sycl;
+
+// buffers cannot be empty, so a matrix without nonzeros gets a one element placeholder that is never read
+template <typename U>
+static buffer<U, 1> make_buffer(const std::vector<U>& data) {
+    return data.empty() ? buffer<U, 1>(range<1>{ 1 }) : buffer<U, 1>(data.data(), range<1>{ data.size() });
+}
+
+template <typename T>
+static void check_matrix(const CsrMatrix<T>& matrix) {
+    if (matrix.rows == 0 || matrix.cols == 0 || matrix.rowOffsets.size() != matrix.rows + 1) {
+        throw std::invalid_argument("sparse matrix is empty or its row offsets do not match its rows");
+    }
+}
+
+template <typename T>
+event spmv_csr_kernel(queue& deviceQueue, const CsrMatrix<T>& matrix, const T* x, T* y) {
+    check_matrix(matrix);
+    size_t rows = matrix.rows;
+
+    // create buffers which are used to pass data between host and device
+    buffer<uint32_t, 1> offsetBuffer = make_buffer(matrix.rowOffsets);
+    buffer<uint32_t, 1> columnBuffer = make_buffer(matrix.colIndices);
+    buffer<T, 1> valueBuffer = make_buffer(matrix.values);
+    buffer<T, 1> xBuffer(x, range<1>{ matrix.cols });
+    buffer<T, 1> yBuffer(y, range<1>{ rows });
+
+    // submit work to the queue and capture details in event
+    auto queueEvent = deviceQueue.submit([&](handler& queueHandler) {
+
+    // create accessors for device to read/write data in buffers
+    auto offsetAccessor = offsetBuffer.template get_access<access::mode::read>(queueHandler);
+    auto columnAccessor = columnBuffer.template get_access<access::mode::read>(queueHandler);
+    auto valueAccessor = valueBuffer.template get_access<access::mode::read>(queueHandler);
+    auto xAccessor = xBuffer.template get_access<access::mode::read>(queueHandler);
+    auto yAccessor = yBuffer.template get_access<access::mode::write>(queueHandler);
+
+    // one work item per row walks the nonzeros of its row
+    queueHandler.parallel_for(range<1>{ rows }, [=](id<1> index) {
+        size_t row = index[0];
+        T sum = 0;
+        for (size_t e = offsetAccessor[row]; e < offsetAccessor[row + 1]; e++) {
+            sum += valueAccessor[e] * xAccessor[columnAccessor[e]];
+        }
+        yAccessor[row] = sum;
+        });
+    });
+
+    // allow read access on output buffer
+    yBuffer.template get_access<access::mode::read>();
+
+    // wait until the queue is done executing on the kernel
+    deviceQueue.wait();
+
+    // return the kernel event so the caller can read the profiling results
+    return queueEvent;
+}
+
+template <typename T>
+event spmv_csr_subgroup_kernel(queue& deviceQueue, const CsrMatrix<T>& matrix, const T* x, T* y) {
+    check_matrix(matrix);
+    size_t rows = matrix.rows;
+
+    // one sub-group per row, SPARSE_ROWS_PER_GROUP sub-groups per work group
+    // the range is rounded up to whole work groups, sub-groups past the last row return at once
+    size_t groups = (rows + SPARSE_ROWS_PER_GROUP - 1) / SPARSE_ROWS_PER_GROUP;
+    range<1> numItems{ groups * SPARSE_ROWS_PER_GROUP * SUBGROUP_SIZE };
+    range<1> workGroup{ SPARSE_ROWS_PER_GROUP * SUBGROUP_SIZE };
+
+    // create buffers which are used to pass data between host and device
+    buffer<uint32_t, 1> offsetBuffer = make_buffer(matrix.rowOffsets);
+    buffer<uint32_t, 1> columnBuffer = make_buffer(matrix.colIndices);
+    buffer<T, 1> valueBuffer = make_buffer(matrix.values);
+    buffer<T, 1> xBuffer(x, range<1>{ matrix.cols });
+    buffer<T, 1> yBuffer(y, range<1>{ rows });
+
+    // submit work to the queue and capture details in event
+    auto queueEvent = deviceQueue.submit([&](handler& queueHandler) {
+
+    // create accessors for device to read/write data in buffers
+    auto offsetAccessor = offsetBuffer.template get_access<access::mode::read>(queueHandler);
+    auto columnAccessor = columnBuffer.template get_access<access::mode::read>(queueHandler);
+    auto valueAccessor = valueBuffer.template get_access<access::mode::read>(queueHandler);
+    auto xAccessor = xBuffer.template get_access<access::mode::read>(queueHandler);
+    auto yAccessor = yBuffer.template get_access<access::mode::write>(queueHandler);
+
+    // the required sub-group size makes the row of a sub-group follow from the work group and sub-group index
+    queueHandler.parallel_for(nd_range<1>{ numItems,workGroup }, [=](nd_item<1> item) [[sycl::reqd_sub_group_size(SUBGROUP_SIZE)]] {
+        auto subGroup = item.get_sub_group();
+        size_t lane = subGroup.get_local_linear_id();
+        size_t row = item.get_group(0) * SPARSE_ROWS_PER_GROUP + subGroup.get_group_linear_id();
+        // the whole sub-group has the same row, so returning here keeps the reduction below uniform
+        if (row >= rows) {
+            return;
+        }
+
+        // neighbouring lanes read neighbouring nonzeros, so a long row is split across the sub-group
+        T sum = 0;
+        for (size_t e = offsetAccessor[row] + lane; e < offsetAccessor[row + 1]; e += SUBGROUP_SIZE) {
+            sum += valueAccessor[e] * xAccessor[columnAccessor[e]];
+        }
+        sum = reduce_over_group(subGroup, sum, plus<T>());
+        if (lane == 0) {
+            yAccessor[row] = sum;
+        }
+        });
+    });
+
+    // allow read access on output buffer
+    yBuffer.template get_access<access::mode::read>();
+
+    // wait until the queue is done executing on the kernel
+    deviceQueue.wait();
+
+    // return the kernel event so the caller can read the profiling results
+    return queueEvent;
+}
+
+template <typename T>
+event spmv_sell_kernel(queue& deviceQueue, const SellMatrix<T>& matrix, const T* x, T* y) {
+    if (matrix.rows == 0 || matrix.cols == 0) {
+        throw std::invalid_argument("sparse matrix is empty");
+    }
+    size_t rows = matrix.rows;
+    size_t C = matrix.C;
+
+    // create buffers which are used to pass data between host and device
+    buffer<uint32_t, 1> sliceOffsetBuffer = make_buffer(matrix.sliceOffsets);
+    buffer<uint32_t, 1> sliceWidthBuffer = make_buffer(matrix.sliceWidths);
+    buffer<uint32_t, 1> rowOrderBuffer = make_buffer(matrix.rowOrder);
+    buffer<uint32_t, 1> columnBuffer = make_buffer(matrix.colIndices);
+    buffer<T, 1> valueBuffer = make_buffer(matrix.values);
+    buffer<T, 1> xBuffer(x, range<1>{ matrix.cols });
+    buffer<T, 1> yBuffer(y, range<1>{ rows });
+
+    // submit work to the queue and capture details in event
+    auto queueEvent = deviceQueue.submit([&](handler& queueHandler) {
+
+    // create accessors for device to read/write data in buffers
+    auto sliceOffsetAccessor = sliceOffsetBuffer.template get_access<access::mode::read>(queueHandler);
+    auto sliceWidthAccessor = sliceWidthBuffer.template get_access<access::mode::read>(queueHandler);
+    auto rowOrderAccessor = rowOrderBuffer.template get_access<access::mode::read>(queueHandler);
+    auto columnAccessor = columnBuffer.template get_access<access::mode::read>(queueHandler);
+    auto valueAccessor = valueBuffer.template get_access<access::mode::read>(queueHandler);
+    auto xAccessor = xBuffer.template get_access<access::mode::read>(queueHandler);
+    auto yAccessor = yBuffer.template get_access<access::mode::write>(queueHandler);
+
+    // one work item per sorted row, the slices are stored column by column so
+    // the C work items of a slice read C consecutive values in every step
+    queueHandler.parallel_for(range<1>{ matrix.rowOrder.size() }, [=](id<1> index) {
+        size_t sortedRow = index[0];
+        size_t slice = sortedRow / C;
+        size_t lane = sortedRow % C;
+        T sum = 0;
+        // padding entries hold zeros, so the short rows of a slice need no bounds check
+        for (size_t j = 0; j < sliceWidthAccessor[slice]; j++) {
+            size_t e = sliceOffsetAccessor[slice] + j * C + lane;
+            sum += valueAccessor[e] * xAccessor[columnAccessor[e]];
+        }
+        // rows were reordered by length, so the result goes back to the original row
+        if (sortedRow < rows) {
+            yAccessor[rowOrderAccessor[sortedRow]] = sum;
+        }
+        });
+    });
+
+    // allow read access on output buffer
+    yBuffer.template get_access<access::mode::read>();
+
+    // wait until the queue is done executing on the kernel
+    deviceQueue.wait();
+
+    // return the kernel event so the caller can read the profiling results
+    return queueEvent;
+}
+
+template <typename T>
+event spmm_csr_kernel(queue& deviceQueue, const CsrMatrix<T>& matrix, const T* in, T* out, size_t N) {
+    check_matrix(matrix);
+    size_t rows = matrix.rows;
+
+    // create buffers which are used to pass data between host and device
+    buffer<uint32_t, 1> offsetBuffer = make_buffer(matrix.rowOffsets);
+    buffer<uint32_t, 1> columnBuffer = make_buffer(matrix.colIndices);
+    buffer<T, 1> valueBuffer = make_buffer(matrix.values);
+    buffer<T, 1> inBuffer(in, range<1>{ matrix.cols * N });
+    buffer<T, 1> outBuffer(out, range<1>{ rows * N });
+
+    // submit work to the queue and capture details in event
+    auto queueEvent = deviceQueue.submit([&](handler& queueHandler) {
+
+    // create accessors for device to read/write data in buffers
+    auto offsetAccessor = offsetBuffer.template get_access<access::mode::read>(queueHandler);
+    auto columnAccessor = columnBuffer.template get_access<access::mode::read>(queueHandler);
+    auto valueAccessor = valueBuffer.template get_access<access::mode::read>(queueHandler);
+    auto inAccessor = inBuffer.template get_access<access::mode::read>(queueHandler);
+    auto outAccessor = outBuffer.template get_access<access::mode::write>(queueHandler);
+
+    // one work item per output element, neighbouring work items share the row and read neighbouring columns of the input
+    queueHandler.parallel_for(range<2>{ rows, N }, [=](id<2> index) {
+        size_t row = index[0];
+        size_t col = index[1];
+        T sum = 0;
+        for (size_t e = offsetAccessor[row]; e < offsetAccessor[row + 1]; e++) {
+            sum += valueAccessor[e] * inAccessor[columnAccessor[e] * N + col];
+        }
+        outAccessor[row * N + col] = sum;
+        });
+    });
+
+    // allow read access on output buffer
+    outBuffer.template get_access<access::mode::read>();
+
+    // wait until the queue is done executing on the kernel
+    deviceQueue.wait();
+
+    // return the kernel event so the caller can read the profiling results
+    return queueEvent;
+}
+
+template <typename T>
+event spmm_csr_subgroup_kernel(queue& deviceQueue, const CsrMatrix<T>& matrix, const T* in, T* out, size_t N) {
+    check_matrix(matrix);
+    size_t rows = matrix.rows;
+
+    // one sub-group per row like the SpMV kernel, the lanes split the output columns of the row
+    size_t groups = (rows + SPARSE_ROWS_PER_GROUP - 1) / SPARSE_ROWS_PER_GROUP;
+    range<1> numItems{ groups * SPARSE_ROWS_PER_GROUP * SUBGROUP_SIZE };
+    range<1> workGroup{ SPARSE_ROWS_PER_GROUP * SUBGROUP_SIZE };
+
+    // create buffers which are used to pass data between host and device
+    buffer<uint32_t, 1> offsetBuffer = make_buffer(matrix.rowOffsets);
+    buffer<uint32_t, 1> columnBuffer = make_buffer(matrix.colIndices);
+    buffer<T, 1> valueBuffer = make_buffer(matrix.values);
+    buffer<T, 1> inBuffer(in, range<1>{ matrix.cols * N });
+    buffer<T, 1> outBuffer(out, range<1>{ rows * N });
+
+    // submit work to the queue and capture details in event
+    auto queueEvent = deviceQueue.submit([&](handler& queueHandler) {
+
+    // create accessors for device to read/write data in buffers
+    auto offsetAccessor = offsetBuffer.template get_access<access::mode::read>(queueHandler);
+    auto columnAccessor = columnBuffer.template get_access<access::mode::read>(queueHandler);
+    auto valueAccessor = valueBuffer.template get_access<access::mode::read>(queueHandler);
+    auto inAccessor = inBuffer.template get_access<access::mode::read>(queueHandler);
+    auto outAccessor = outBuffer.template get_access<access::mode::write>(queueHandler);
+
+    queueHandler.parallel_for(nd_range<1>{ numItems,workGroup }, [=](nd_item<1> item) [[sycl::reqd_sub_group_size(SUBGROUP_SIZE)]] {
+        auto subGroup = item.get_sub_group();
+        size_t lane = subGroup.get_local_linear_id();
+        size_t row = item.get_group(0) * SPARSE_ROWS_PER_GROUP + subGroup.get_group_linear_id();
+        // the whole sub-group has the same row, so returning here keeps the broadcasts below uniform
+        if (row >= rows) {
+            return;
+        }
+        size_t start = offsetAccessor[row];
+        size_t end = offsetAccessor[row + 1];
+
+        // the column loop runs the same number of steps on every lane, lanes past the last column are masked
+        for (size_t colBase = 0; colBase < N; colBase += SUBGROUP_SIZE) {
+            size_t col = colBase + lane;
+            T sum = 0;
+            for (size_t e = start; e < end; e += SUBGROUP_SIZE) {
+                // each lane loads one nonzero of the next SUBGROUP_SIZE, then they are shared with group_broadcast
+                // instead of every lane loading every nonzero
+                size_t count = std::min<size_t>(SUBGROUP_SIZE, end - e);
+                uint32_t laneColumn = lane < count ? columnAccessor[e + lane] : 0;
+                T laneValue = lane < count ? valueAccessor[e + lane] : T(0);
+                for (size_t k = 0; k < count; k++) {
+                    uint32_t column = group_broadcast(subGroup, laneColumn, k);
+                    T value = group_broadcast(subGroup, laneValue, k);
+                    if (col < N) {
+                        sum += value * inAccessor[column * N + col];
+                    }
+                }
+            }
+            if (col < N) {
+                outAccessor[row * N + col] = sum;
+            }
+        }
+        });
+    });
+
+    // allow read access on output buffer
+    outBuffer.template get_access<access::mode::read>();
+
+    // wait until the queue is done executing on the kernel
+    deviceQueue.wait();
+
+    // return the kernel event so the caller can read the profiling results
+    return queueEvent;
+}
+
+// the templates are defined in this file, so instantiate the element types used by the host program
+#define MM_INSTANTIATE_SPARSE(T) \
+    template event spmv_csr_kernel<T>(queue& deviceQueue, const CsrMatrix<T>& matrix, const T* x, T* y); \
+    template event spmv_csr_subgroup_kernel<T>(queue& deviceQueue, const CsrMatrix<T>& matrix, const T* x, T* y); \
+    template event spmv_sell_kernel<T>(queue& deviceQueue, const SellMatrix<T>& matrix, const T* x, T* y); \
+    template event spmm_csr_kernel<T>(queue& deviceQueue, const CsrMatrix<T>& matrix, const T* in, T* out, size_t N); \
+    template event spmm_csr_subgroup_kernel<T>(queue& deviceQueue, const CsrMatrix<T>& matrix, const T* in, T* out, size_t N);
+MM_FOR_EACH_SPARSE_TYPE(MM_INSTANTIATE_SPARSE)
@@ -0,0 +1,99 @@
+#pragma once
+#include <CL/sycl.hpp>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "mm_kernels.hpp"
+using namespace sycl;
+
+// rows per slice of the SELL-C-sigma format, one work item per row so a slice is one sub-group
+#define SELL_SLICE_HEIGHT SUBGROUP_SIZE
+// rows sorted by length together before slicing, larger windows waste less padding but scatter the output more
+#define SELL_SORT_WINDOW 256
+// rows handled by one work group in the row-per-sub-group kernels
+#define SPARSE_ROWS_PER_GROUP 4
+
+// compressed sparse row matrix: the nonzeros of row i are values[rowOffsets[i]] to values[rowOffsets[i + 1] - 1],
+// with their columns in colIndices, sorted by column within a row
+// indices are 32-bit, which halves the index traffic compared to size_t and limits a matrix to 4G nonzeros
+template <typename T>
+struct CsrMatrix {
+    size_t rows = 0;
+    size_t cols = 0;
+    std::vector<uint32_t> rowOffsets;  // rows + 1 entries
+    std::vector<uint32_t> colIndices;  // one per nonzero
+    std::vector<T> values;             // one per nonzero
+
+    size_t nonzeros() const { return values.size(); }
+};
+
+// sliced ELLPACK (SELL-C-sigma): rows are sorted by length inside windows of sigma rows, then cut into
+// slices of C rows, and every slice is padded to its longest row and stored column by column
+// neighbouring work items then read neighbouring memory, and a slice of short rows does not pay for a long row elsewhere
+template <typename T>
+struct SellMatrix {
+    size_t rows = 0;
+    size_t cols = 0;
+    size_t C = SELL_SLICE_HEIGHT;
+    size_t sigma = SELL_SORT_WINDOW;
+    size_t nonzeros = 0;                 // without the padding
+    std::vector<uint32_t> sliceOffsets;  // start of every slice in colIndices and values, slices + 1 entries
+    std::vector<uint32_t> sliceWidths;   // length of the longest row of every slice
+    std::vector<uint32_t> rowOrder;      // original row of every sorted row, padded to a whole number of slices
+    std::vector<uint32_t> colIndices;    // padding entries point at column 0 with a value of 0
+    std::vector<T> values;
+
+    // fraction of the stored entries that are padding
+    double padding() const { return values.empty() ? 0.0 : 1.0 - static_cast<double>(nonzeros) / values.size(); }
+};
+
+// random sparse matrix with the given fraction of nonzeros
+// skew 0 gives every row about the same number of nonzeros, larger values follow a power law where
+// row i has about (i + 1)^-skew of the nonzeros of the first row, rows are shuffled afterwards
+// nonzero values are small integers, so results are exact in float and double
+template <typename T>
+CsrMatrix<T> generate_sparse(size_t rows, size_t cols, double density, double skew, unsigned seed = 1);
+
+// read a Matrix Market coordinate file (real, integer, or pattern; general or symmetric)
+template <typename T>
+CsrMatrix<T> load_matrix_market(const std::string& fileName);
+
+// convert between formats
+template <typename T>
+SellMatrix<T> csr_to_sell(const CsrMatrix<T>& matrix, size_t C = SELL_SLICE_HEIGHT, size_t sigma = SELL_SORT_WINDOW);
+template <typename T>
+std::vector<T> csr_to_dense(const CsrMatrix<T>& matrix);
+
+// y = A * x and Y = A * X on the host, X is cols x N and Y is rows x N, both row-major
+template <typename T>
+void spmv_host_reference(const CsrMatrix<T>& matrix, const T* x, T* y);
+template <typename T>
+void spmm_host_reference(const CsrMatrix<T>& matrix, const T* in, T* out, size_t N);
+
+// the kernels follow the dense ones: host pointers in, buffers inside, wait, return the kernel event
+// the output is overwritten, not accumulated
+
+// SpMV with one work item per row, long rows keep their sub-group busy while the other lanes idle
+template <typename T>
+event spmv_csr_kernel(queue& deviceQueue, const CsrMatrix<T>& matrix, const T* x, T* y);
+
+// SpMV with one sub-group per row, lanes read consecutive nonzeros and the partial sums are reduced across the sub-group
+template <typename T>
+event spmv_csr_subgroup_kernel(queue& deviceQueue, const CsrMatrix<T>& matrix, const T* x, T* y);
+
+// SpMV on SELL-C-sigma with one work item per row, each sub-group walks one slice column by column
+template <typename T>
+event spmv_sell_kernel(queue& deviceQueue, const SellMatrix<T>& matrix, const T* x, T* y);
+
+// SpMM with one work item per output element
+template <typename T>
+event spmm_csr_kernel(queue& deviceQueue, const CsrMatrix<T>& matrix, const T* in, T* out, size_t N);
+
+// SpMM with one sub-group per row, lanes take consecutive output columns so reads of the dense input are contiguous
+template <typename T>
+event spmm_csr_subgroup_kernel(queue& deviceQueue, const CsrMatrix<T>& matrix, const T* in, T* out, size_t N);
+
+// the sparse code is instantiated for the floating point types with a matching accumulator
+#define MM_FOR_EACH_SPARSE_TYPE(MACRO) \
+    MACRO(double) \
+    MACRO(float)
@@ -0,0 +1,282 @@
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <fstream>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include "mm_sparse.hpp"
+
+// the index arrays are 32-bit, larger matrices are rejected instead of silently wrapping around
+static void check_index_range(size_t count, const std::string& what) {
+    if (count > std::numeric_limits<uint32_t>::max()) {
+        throw std::invalid_argument(what + " does not fit the 32-bit indices of the sparse formats");
+    }
+}
+
+template <typename T>
+CsrMatrix<T> generate_sparse(size_t rows, size_t cols, double density, double skew, unsigned seed) {
+    if (density < 0.0 || density > 1.0) {
+        throw std::invalid_argument("density must be between 0 and 1");
+    }
+    check_index_range(rows, "row count");
+    check_index_range(cols, "column count");
+    std::mt19937 generator(seed);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+
+    // row lengths follow (i + 1)^-skew, scaled so the whole matrix gets density * rows * cols nonzeros
+    // no row can be longer than cols, so the scale is found by bisection and the capped rows' share goes to the others
+    std::vector<double> weights(rows);
+    for (size_t i = 0; i < rows; i++) {
+        weights[i] = std::pow(static_cast<double>(i + 1), -skew);
+    }
+    double target = density * rows * cols;
+    auto capped_total = [&](double scale) {
+        double total = 0.0;
+        for (double weight : weights) {
+            total += std::min(static_cast<double>(cols), weight * scale);
+        }
+        return total;
+    };
+    double low = 0.0;
+    double high = 1.0;
+    while (capped_total(high) < target && high < 1.0e300) {
+        high *= 2.0;
+    }
+    for (int step = 0; step < 100; step++) {
+        double middle = (low + high) / 2.0;
+        (capped_total(middle) < target ? low : high) = middle;
+    }
+
+    // fractional lengths are rounded up or down at random, so very sparse matrices keep the right density on average
+    std::vector<size_t> rowLengths(rows);
+    for (size_t i = 0; i < rows; i++) {
+        double length = std::min(static_cast<double>(cols), weights[i] * high);
+        size_t whole = static_cast<size_t>(length);
+        rowLengths[i] = std::min(cols, whole + (uniform(generator) < length - whole ? 1 : 0));
+    }
+    // the long rows are spread over the matrix instead of all sitting at the top
+    std::shuffle(rowLengths.begin(), rowLengths.end(), generator);
+
+    CsrMatrix<T> matrix;
+    matrix.rows = rows;
+    matrix.cols = cols;
+    matrix.rowOffsets.resize(rows + 1, 0);
+    for (size_t i = 0; i < rows; i++) {
+        matrix.rowOffsets[i + 1] = static_cast<uint32_t>(matrix.rowOffsets[i] + rowLengths[i]);
+        check_index_range(static_cast<size_t>(matrix.rowOffsets[i]) + rowLengths[i], "nonzero count");
+    }
+    matrix.colIndices.reserve(matrix.rowOffsets[rows]);
+    matrix.values.reserve(matrix.rowOffsets[rows]);
+
+    // distinct columns per row with Floyd's sampling, the marks are cleared row by row so a row costs O(length)
+    std::vector<char> used(cols, 0);
+    std::vector<uint32_t> rowColumns;
+    for (size_t i = 0; i < rows; i++) {
+        rowColumns.clear();
+        for (size_t j = cols - rowLengths[i]; j < cols; j++) {
+            size_t column = std::uniform_int_distribution<size_t>(0, j)(generator);
+            if (used[column]) {
+                column = j;
+            }
+            used[column] = 1;
+            rowColumns.push_back(static_cast<uint32_t>(column));
+        }
+        std::sort(rowColumns.begin(), rowColumns.end());
+        for (uint32_t column : rowColumns) {
+            used[column] = 0;
+            matrix.colIndices.push_back(column);
+            matrix.values.push_back(static_cast<T>(1 + generator() % 9));
+        }
+    }
+    return matrix;
+}
+
+template <typename T>
+CsrMatrix<T> load_matrix_market(const std::string& fileName) {
+    std::ifstream file(fileName);
+    if (!file) {
+        throw std::runtime_error("cannot open " + fileName);
+    }
+
+    // header: %%MatrixMarket matrix coordinate <field> <symmetry>
+    std::string line;
+    std::getline(file, line);
+    std::stringstream header(line);
+    std::string banner, object, format, field, symmetry;
+    header >> banner >> object >> format >> field >> symmetry;
+    for (auto* word : { &object, &format, &field, &symmetry }) {
+        std::transform(word->begin(), word->end(), word->begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    }
+    if (banner != "%%MatrixMarket" || object != "matrix" || format != "coordinate") {
+        throw std::runtime_error(fileName + " is not a Matrix Market coordinate file");
+    }
+    if (field != "real" && field != "integer" && field != "pattern") {
+        throw std::runtime_error(fileName + ": field " + field + " is not supported");
+    }
+    if (symmetry != "general" && symmetry != "symmetric" && symmetry != "skew-symmetric") {
+        throw std::runtime_error(fileName + ": symmetry " + symmetry + " is not supported");
+    }
+
+    // skip comments, then read the size line
+    while (std::getline(file, line) && (line.empty() || line[0] == '%')) {
+    }
+    size_t rows = 0;
+    size_t cols = 0;
+    size_t entries = 0;
+    std::stringstream sizeLine(line);
+    if (!(sizeLine >> rows >> cols >> entries)) {
+        throw std::runtime_error(fileName + ": missing size line");
+    }
+    check_index_range(rows, "row count");
+    check_index_range(cols, "column count");
+
+    // read the entries as coordinates (1-based in the file), mirroring the lower triangle of symmetric matrices
+    struct Entry {
+        uint32_t row;
+        uint32_t col;
+        T value;
+    };
+    std::vector<Entry> coordinates;
+    coordinates.reserve(symmetry == "general" ? entries : 2 * entries);
+    for (size_t e = 0; e < entries; e++) {
+        size_t row = 0;
+        size_t col = 0;
+        double value = 1.0;
+        if (!(file >> row >> col) || (field != "pattern" && !(file >> value))) {
+            throw std::runtime_error(fileName + ": expected " + std::to_string(entries) + " entries");
+        }
+        if (row == 0 || col == 0 || row > rows || col > cols) {
+            throw std::runtime_error(fileName + ": entry outside the matrix");
+        }
+        coordinates.push_back({ static_cast<uint32_t>(row - 1), static_cast<uint32_t>(col - 1), static_cast<T>(value) });
+        if (symmetry != "general" && row != col) {
+            T mirrored = static_cast<T>(symmetry == "skew-symmetric" ? -value : value);
+            coordinates.push_back({ static_cast<uint32_t>(col - 1), static_cast<uint32_t>(row - 1), mirrored });
+        }
+    }
+    check_index_range(coordinates.size(), "nonzero count");
+
+    // sort by row and column, then count the row lengths
+    std::sort(coordinates.begin(), coordinates.end(), [](const Entry& a, const Entry& b) {
+        return a.row != b.row ? a.row < b.row : a.col < b.col;
+    });
+    CsrMatrix<T> matrix;
+    matrix.rows = rows;
+    matrix.cols = cols;
+    matrix.rowOffsets.assign(rows + 1, 0);
+    matrix.colIndices.reserve(coordinates.size());
+    matrix.values.reserve(coordinates.size());
+    for (auto& entry : coordinates) {
+        matrix.rowOffsets[entry.row + 1]++;
+        matrix.colIndices.push_back(entry.col);
+        matrix.values.push_back(entry.value);
+    }
+    std::partial_sum(matrix.rowOffsets.begin(), matrix.rowOffsets.end(), matrix.rowOffsets.begin());
+    return matrix;
+}
+
+template <typename T>
+SellMatrix<T> csr_to_sell(const CsrMatrix<T>& matrix, size_t C, size_t sigma) {
+    if (C == 0 || sigma == 0) {
+        throw std::invalid_argument("SELL slice height and sort window must be at least 1");
+    }
+    SellMatrix<T> sell;
+    sell.rows = matrix.rows;
+    sell.cols = matrix.cols;
+    sell.C = C;
+    sell.sigma = sigma;
+    sell.nonzeros = matrix.nonzeros();
+
+    // sort the rows by decreasing length inside every window of sigma rows
+    // the padding rows at the end keep their place, so sorted position r < rows is always a real row
+    size_t slices = (matrix.rows + C - 1) / C;
+    sell.rowOrder.resize(slices * C);
+    std::iota(sell.rowOrder.begin(), sell.rowOrder.end(), 0);
+    auto rowLength = [&](uint32_t row) -> size_t {
+        return row < matrix.rows ? matrix.rowOffsets[row + 1] - matrix.rowOffsets[row] : 0;
+    };
+    for (size_t start = 0; start < matrix.rows; start += sigma) {
+        auto first = sell.rowOrder.begin() + start;
+        auto last = sell.rowOrder.begin() + std::min(start + sigma, matrix.rows);
+        std::stable_sort(first, last, [&](uint32_t a, uint32_t b) { return rowLength(a) > rowLength(b); });
+    }
+
+    // every slice is as wide as its longest row
+    sell.sliceOffsets.resize(slices + 1, 0);
+    sell.sliceWidths.resize(slices, 0);
+    for (size_t s = 0; s < slices; s++) {
+        for (size_t lane = 0; lane < C; lane++) {
+            sell.sliceWidths[s] = std::max<uint32_t>(sell.sliceWidths[s], static_cast<uint32_t>(rowLength(sell.rowOrder[s * C + lane])));
+        }
+        size_t end = static_cast<size_t>(sell.sliceOffsets[s]) + static_cast<size_t>(sell.sliceWidths[s]) * C;
+        check_index_range(end, "padded SELL size");
+        sell.sliceOffsets[s + 1] = static_cast<uint32_t>(end);
+    }
+
+    // store every slice column by column, entry j of lane l sits at sliceOffset + j * C + l
+    sell.colIndices.assign(sell.sliceOffsets[slices], 0);
+    sell.values.assign(sell.sliceOffsets[slices], T(0));
+    for (size_t s = 0; s < slices; s++) {
+        for (size_t lane = 0; lane < C; lane++) {
+            uint32_t row = sell.rowOrder[s * C + lane];
+            for (size_t j = 0; j < rowLength(row); j++) {
+                size_t source = matrix.rowOffsets[row] + j;
+                size_t target = sell.sliceOffsets[s] + j * C + lane;
+                sell.colIndices[target] = matrix.colIndices[source];
+                sell.values[target] = matrix.values[source];
+            }
+        }
+    }
+    return sell;
+}
+
+template <typename T>
+std::vector<T> csr_to_dense(const CsrMatrix<T>& matrix) {
+    std::vector<T> dense(matrix.rows * matrix.cols, T(0));
+    for (size_t i = 0; i < matrix.rows; i++) {
+        for (size_t e = matrix.rowOffsets[i]; e < matrix.rowOffsets[i + 1]; e++) {
+            dense[i * matrix.cols + matrix.colIndices[e]] = matrix.values[e];
+        }
+    }
+    return dense;
+}
+
+template <typename T>
+void spmv_host_reference(const CsrMatrix<T>& matrix, const T* x, T* y) {
+    for (size_t i = 0; i < matrix.rows; i++) {
+        T sum = 0;
+        for (size_t e = matrix.rowOffsets[i]; e < matrix.rowOffsets[i + 1]; e++) {
+            sum += matrix.values[e] * x[matrix.colIndices[e]];
+        }
+        y[i] = sum;
+    }
+}
+
+template <typename T>
+void spmm_host_reference(const CsrMatrix<T>& matrix, const T* in, T* out, size_t N) {
+    // row i of the output is a sum of scaled rows of the input, which keeps the inner loop contiguous
+    for (size_t i = 0; i < matrix.rows; i++) {
+        T* outRow = out + i * N;
+        std::fill(outRow, outRow + N, T(0));
+        for (size_t e = matrix.rowOffsets[i]; e < matrix.rowOffsets[i + 1]; e++) {
+            const T* inRow = in + static_cast<size_t>(matrix.colIndices[e]) * N;
+            T value = matrix.values[e];
+            for (size_t j = 0; j < N; j++) {
+                outRow[j] += value * inRow[j];
+            }
+        }
+    }
+}
+
+// the templates are defined in this file, so instantiate the element types used by the host program
+#define MM_INSTANTIATE_SPARSE_FORMAT(T) \
+    template CsrMatrix<T> generate_sparse<T>(size_t rows, size_t cols, double density, double skew, unsigned seed); \
+    template CsrMatrix<T> load_matrix_market<T>(const std::string& fileName); \
+    template SellMatrix<T> csr_to_sell<T>(const CsrMatrix<T>& matrix, size_t C, size_t sigma); \
+    template std::vector<T> csr_to_dense<T>(const CsrMatrix<T>& matrix); \
+    template void spmv_host_reference<T>(const CsrMatrix<T>& matrix, const T* x, T* y); \
+    template void spmm_host_reference<T>(const CsrMatrix<T>& matrix, const T* in, T* out, size_t N);
+MM_FOR_EACH_SPARSE_TYPE(MM_INSTANTIATE_SPARSE_FORMAT)
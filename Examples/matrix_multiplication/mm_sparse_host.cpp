@@ -0,0 +1,416 @@
+#include <CL/sycl.hpp>
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <chrono>
+#include <map>
+#include "mm_bench.hpp"
+#include "mm_kernels.hpp"
+#include "mm_sparse.hpp"
+#include "mm_tune.hpp"
+using namespace sycl;
+
+// default values, each one can be changed from the command line
+#define WORK_GROUP_SIZE 16
+#define WARMUP_ITERATIONS 1
+#define TIMED_ITERATIONS 5
+// the dense comparison is skipped when the dense copy of the matrix would be larger than this
+#define DENSE_LIMIT_MB 2048
+
+// settings for a benchmark run, filled in from the command line
+struct Options {
+    std::vector<size_t> sizes{ 4096 };
+    std::vector<double> densities{ 0.001, 0.01, 0.05, 0.1, 0.2 };
+    std::vector<double> skews{ 0.0, 1.0 };
+    std::vector<size_t> rhs{ 1, 32 };
+    std::string matrixFile;
+    std::string denseKernel = "tiled";
+    size_t workGroup = WORK_GROUP_SIZE;
+    size_t denseLimitMB = DENSE_LIMIT_MB;
+    std::vector<std::string> devices{ "cpu", "gpu" };
+    std::vector<std::string> types{ "double" };
+    size_t warmup = WARMUP_ITERATIONS;
+    size_t iterations = TIMED_ITERATIONS;
+    bool validateResult = false;
+    std::string csvFile;
+};
+
+// one row of the report
+struct SparseResult {
+    std::string device;
+    std::string type;
+    std::string matrix;     // "generated" or the Matrix Market file
+    size_t rows = 0;
+    size_t cols = 0;
+    size_t nonzeros = 0;
+    double density = 0.0;   // measured, not requested
+    double skew = 0.0;
+    size_t rhs = 0;         // number of dense right-hand side columns, 1 is SpMV
+    std::string kernel;
+    TimingStats kernelTime; // from the kernel event profile
+    TimingStats totalTime;  // measured on the host around the whole offload, including data movement
+    double gflops = 0.0;    // useful operations only: 2 * nonzeros * rhs, for the dense kernel as well
+    double speedup = 0.0;   // dense median kernel time / this median kernel time
+    std::string validation;
+};
+
+static void print_usage(const char* program) {
+    std::cout << "Usage: " << program << " [options]\n"
+              << "  --sizes N[,N...]          rows and columns of the generated matrices (default 4096)\n"
+              << "  --densities D[,D...]      fraction of nonzeros of the generated matrices (default 0.001,0.01,0.05,0.1,0.2)\n"
+              << "  --skews S[,S...]          row length skew, 0 is uniform, row i gets (i + 1)^-S of the longest row (default 0,1)\n"
+              << "  --matrix FILE             load a Matrix Market file instead of generating matrices\n"
+              << "  --rhs R[,R...]            dense columns multiplied with the sparse matrix, 1 is SpMV (default 1,32)\n"
+              << "  --dense-kernel K          ndrange, tiled, subgroup2x2, subgroup, subgroup8x4 (default tiled)\n"
+              << "  --workgroup B             work group size of the dense kernel (default " << WORK_GROUP_SIZE << ")\n"
+              << "  --dense-limit MB          skip the dense kernel for larger dense matrices (default " << DENSE_LIMIT_MB << ")\n"
+              << "  --devices D[,D...]        cpu, gpu, fpga_emu, fpga (default cpu,gpu)\n"
+              << "  --types T[,T...]          double, float (default double)\n"
+              << "  --warmup W                untimed iterations per configuration (default " << WARMUP_ITERATIONS << ")\n"
+              << "  --iterations I            timed iterations per configuration (default " << TIMED_ITERATIONS << ")\n"
+              << "  --validate                compare every result to the host reference\n"
+              << "  --csv FILE                write results as CSV\n";
+}
+
+// split a comma separated list of numbers with a fractional part
+static std::vector<double> split_doubles(const std::string& value) {
+    std::vector<double> numbers;
+    for (auto& item : split_list(value)) {
+        numbers.push_back(std::stod(item));
+    }
+    return numbers;
+}
+
+// time one kernel: run is called once per iteration and returns the kernel event
+template <typename Run>
+static void time_kernel(const Options& options, SparseResult& result, Run run) {
+    std::vector<double> kernelTimes;
+    std::vector<double> totalTimes;
+    for (size_t iter = 0; iter < options.warmup + options.iterations; iter++) {
+        auto deviceStart = std::chrono::high_resolution_clock::now();
+        event kernelEvent = run();
+        auto deviceStop = std::chrono::high_resolution_clock::now();
+        if (iter < options.warmup) {
+            continue;
+        }
+
+        // get reported times from kernel event profile
+        auto kernel_end = kernelEvent.get_profiling_info<info::event_profiling::command_end>();
+        auto kernel_start = kernelEvent.get_profiling_info<info::event_profiling::command_start>();
+        kernelTimes.push_back((kernel_end - kernel_start) / 1.0e6);
+        totalTimes.push_back(std::chrono::duration<double, std::milli>(deviceStop - deviceStart).count());
+    }
+    result.kernelTime = summarize(kernelTimes);
+    result.totalTime = summarize(totalTimes);
+    result.gflops = result.kernelTime.median > 0.0 ? 2.0 * result.nonzeros * result.rhs / (result.kernelTime.median * 1.0e6) : 0.0;
+}
+
+// run the sparse kernels and the dense kernel on one matrix for every rhs count
+template <typename T>
+static void run_matrix(const std::string& typeName, const Options& options, std::vector<std::pair<std::string, queue>>& deviceQueues,
+                       const CsrMatrix<T>& matrix, const std::string& matrixName, double skew, std::vector<SparseResult>& results) {
+    size_t rows = matrix.rows;
+    size_t cols = matrix.cols;
+    double density = static_cast<double>(matrix.nonzeros()) / (static_cast<double>(rows) * cols);
+    SellMatrix<T> sell = csr_to_sell(matrix);
+
+    std::cout << "Running sparse matrix multiplication (" << typeName << ")\n"
+              << "Matrix = [ " << rows << " x " << cols << " ], nonzeros = " << matrix.nonzeros() << ", density = " << density
+              << ", skew = " << skew << ", SELL padding = " << sell.padding() << "\n\n";
+
+    // the dense kernels only see the dense copy, which is built once for all rhs counts
+    bool runDense = rows * cols * sizeof(T) <= options.denseLimitMB * 1000000;
+    std::vector<T> dense;
+    if (runDense) {
+        dense = csr_to_dense(matrix);
+    }
+    else {
+        std::cout << "Dense copy would exceed " << options.denseLimitMB << " MB, skipping the dense kernel\n\n";
+    }
+
+    for (size_t rhs : options.rhs) {
+        // small integers keep every result exact, so the validation does not depend on the summation order
+        std::vector<T> inHost(cols * rhs);
+        std::vector<T> outHost(rows * rhs);
+        std::vector<T> outVal;
+        for (auto& value : inHost) {
+            value = static_cast<T>(rand() % 10);
+        }
+        if (options.validateResult) {
+            outVal.resize(rows * rhs);
+            spmm_host_reference(matrix, inHost.data(), outVal.data(), rhs);
+        }
+
+        // SpMV has its own kernels, SpMM with more than one column uses the row-per-sub-group SpMM kernels
+        std::vector<std::string> kernels;
+        if (rhs == 1) {
+            kernels = { "csr", "csr_subgroup", "sell" };
+        }
+        else {
+            kernels = { "spmm_csr", "spmm_csr_subgroup" };
+        }
+        if (runDense) {
+            kernels.insert(kernels.begin(), "dense:" + options.denseKernel);
+        }
+
+        for (auto& [deviceName, deviceQueue] : deviceQueues) {
+            double denseTime = 0.0;
+            for (auto& kernel : kernels) {
+                std::cout << "Executing " << kernel << " kernel with " << rhs << " column(s) on " << deviceName << "...\n";
+
+                SparseResult result;
+                result.device = deviceName;
+                result.type = typeName;
+                result.matrix = matrixName;
+                result.rows = rows;
+                result.cols = cols;
+                result.nonzeros = matrix.nonzeros();
+                result.density = density;
+                result.skew = skew;
+                result.rhs = rhs;
+                result.kernel = kernel;
+
+                try {
+                    time_kernel(options, result, [&]() -> event {
+                        if (kernel == "csr") {
+                            return spmv_csr_kernel(deviceQueue, matrix, inHost.data(), outHost.data());
+                        }
+                        if (kernel == "csr_subgroup") {
+                            return spmv_csr_subgroup_kernel(deviceQueue, matrix, inHost.data(), outHost.data());
+                        }
+                        if (kernel == "sell") {
+                            return spmv_sell_kernel(deviceQueue, sell, inHost.data(), outHost.data());
+                        }
+                        if (kernel == "spmm_csr") {
+                            return spmm_csr_kernel(deviceQueue, matrix, inHost.data(), outHost.data(), rhs);
+                        }
+                        if (kernel == "spmm_csr_subgroup") {
+                            return spmm_csr_subgroup_kernel(deviceQueue, matrix, inHost.data(), outHost.data(), rhs);
+                        }
+                        // some dense kernels add to their output
+                        std::fill(outHost.begin(), outHost.end(), T(0));
+                        GemmConfig config{ options.denseKernel, options.workGroup };
+                        return run_gemm(deviceQueue, config, dense.data(), inHost.data(), outHost.data(), make_shape(rows, cols, rhs));
+                    });
+                }
+                catch (const std::exception& e) {
+                    std::cout << "Skipping " << kernel << " kernel: " << e.what() << "\n\n";
+                    continue;
+                }
+
+                if (kernel.rfind("dense:", 0) == 0) {
+                    denseTime = result.kernelTime.median;
+                }
+                result.speedup = denseTime > 0.0 && result.kernelTime.median > 0.0 ? denseTime / result.kernelTime.median : 0.0;
+                result.validation = "skipped";
+                if (options.validateResult) {
+                    result.validation = validate_result(outHost, outVal, cols) ? "passed" : "failed";
+                }
+                results.push_back(result);
+            }
+        }
+        std::cout << "\n";
+    }
+}
+
+template <typename T>
+static void run_type(const std::string& typeName, const Options& options, std::vector<std::pair<std::string, queue>>& deviceQueues,
+                     std::vector<SparseResult>& results) {
+    if (!options.matrixFile.empty()) {
+        CsrMatrix<T> matrix = load_matrix_market<T>(options.matrixFile);
+        run_matrix(typeName, options, deviceQueues, matrix, options.matrixFile, 0.0, results);
+        return;
+    }
+    for (size_t N : options.sizes) {
+        for (double skew : options.skews) {
+            for (double density : options.densities) {
+                CsrMatrix<T> matrix = generate_sparse<T>(N, N, density, skew);
+                run_matrix(typeName, options, deviceQueues, matrix, "generated", skew, results);
+            }
+        }
+    }
+}
+
+// print the results as a table on the console
+static void print_sparse_results(const std::vector<SparseResult>& results) {
+    std::cout << std::left << std::setw(10) << "device" << std::setw(16) << "type" << std::right << std::setw(14) << "rows x cols"
+              << std::setw(12) << "nonzeros" << std::setw(10) << "density" << std::setw(6) << "skew" << std::setw(6) << "rhs" << "  "
+              << std::left << std::setw(20) << "kernel" << std::right << std::setw(12) << "median ms" << std::setw(12) << "total ms"
+              << std::setw(10) << "GFLOP/s" << std::setw(10) << "vs dense" << std::setw(12) << "validation" << "\n";
+    for (auto& result : results) {
+        std::cout << std::left << std::setw(10) << result.device << std::setw(16) << result.type << std::right
+                  << std::setw(14) << (std::to_string(result.rows) + "x" + std::to_string(result.cols))
+                  << std::setw(12) << result.nonzeros << std::setw(10) << std::setprecision(4) << result.density
+                  << std::setw(6) << result.skew << std::setw(6) << result.rhs << "  " << std::left << std::setw(20) << result.kernel << std::right
+                  << std::fixed << std::setprecision(3) << std::setw(12) << result.kernelTime.median << std::setw(12) << result.totalTime.median
+                  << std::setw(10) << result.gflops << std::setw(10) << result.speedup << std::defaultfloat
+                  << std::setw(12) << result.validation << "\n";
+    }
+    std::cout << "\n";
+}
+
+// for every device, type, matrix size, skew and rhs count, find the densities between which the fastest sparse
+// kernel stops beating the dense kernel
+static void print_break_even(const std::vector<SparseResult>& results) {
+    // best sparse and dense median kernel time per density
+    struct Times {
+        double sparse = 0.0;
+        double dense = 0.0;
+    };
+    std::map<std::string, std::map<double, Times>> series;
+    for (auto& result : results) {
+        std::string key = result.device + " " + result.type + " " + std::to_string(result.rows) + "x" + std::to_string(result.cols)
+                          + " skew " + std::to_string(result.skew).substr(0, 4) + " rhs " + std::to_string(result.rhs);
+        Times& times = series[key][result.density];
+        double& slot = result.kernel.rfind("dense:", 0) == 0 ? times.dense : times.sparse;
+        if (slot == 0.0 || result.kernelTime.median < slot) {
+            slot = result.kernelTime.median;
+        }
+    }
+
+    std::cout << "Break-even density (fastest sparse kernel against the dense kernel):\n";
+    for (auto& [key, densities] : series) {
+        double lastSparseWin = -1.0;
+        double firstDenseWin = -1.0;
+        for (auto& [density, times] : densities) {
+            if (times.dense == 0.0 || times.sparse == 0.0) {
+                continue;
+            }
+            if (times.sparse < times.dense) {
+                lastSparseWin = density;
+            }
+            else if (firstDenseWin < 0.0) {
+                firstDenseWin = density;
+            }
+        }
+        std::cout << "  " << key << ": ";
+        if (lastSparseWin < 0.0 && firstDenseWin < 0.0) {
+            std::cout << "no dense comparison\n";
+        }
+        else if (firstDenseWin < 0.0) {
+            std::cout << "sparse is faster at every density up to " << lastSparseWin << "\n";
+        }
+        else if (lastSparseWin < 0.0) {
+            std::cout << "dense is faster at every density from " << firstDenseWin << "\n";
+        }
+        else {
+            std::cout << "sparse is faster up to " << lastSparseWin << ", dense from " << firstDenseWin << "\n";
+        }
+    }
+    std::cout << "\n";
+}
+
+// write the results as CSV, one row per kernel run
+static void write_sparse_csv(const std::string& fileName, const std::vector<SparseResult>& results) {
+    std::ofstream file(fileName);
+    file << "device,type,matrix,rows,cols,nonzeros,density,skew,rhs,kernel,kernel_min_ms,kernel_median_ms,kernel_p95_ms,"
+         << "total_median_ms,gflops,speedup_vs_dense,validation\n";
+    for (auto& result : results) {
+        file << result.device << "," << result.type << "," << result.matrix << "," << result.rows << "," << result.cols << ","
+             << result.nonzeros << "," << result.density << "," << result.skew << "," << result.rhs << "," << result.kernel << ","
+             << result.kernelTime.min << "," << result.kernelTime.median << "," << result.kernelTime.p95 << ","
+             << result.totalTime.median << "," << result.gflops << "," << result.speedup << "," << result.validation << "\n";
+    }
+}
+
+int main(int argc, char* argv[]) {
+
+    Options options;
+
+    // parse command line options
+    try {
+        for (int i = 1; i < argc; i++) {
+            std::string arg = argv[i];
+            auto next_value = [&]() -> std::string {
+                if (i + 1 >= argc) {
+                    throw std::invalid_argument("missing value for " + arg);
+                }
+                return argv[++i];
+            };
+            if (arg == "--sizes") options.sizes = split_sizes(next_value());
+            else if (arg == "--densities") options.densities = split_doubles(next_value());
+            else if (arg == "--skews") options.skews = split_doubles(next_value());
+            else if (arg == "--matrix") options.matrixFile = next_value();
+            else if (arg == "--rhs") options.rhs = split_sizes(next_value());
+            else if (arg == "--dense-kernel") options.denseKernel = next_value();
+            else if (arg == "--workgroup") options.workGroup = std::stoul(next_value());
+            else if (arg == "--dense-limit") options.denseLimitMB = std::stoul(next_value());
+            else if (arg == "--devices") options.devices = split_list(next_value());
+            else if (arg == "--types") options.types = split_list(next_value());
+            else if (arg == "--warmup") options.warmup = std::stoul(next_value());
+            else if (arg == "--iterations") options.iterations = std::stoul(next_value());
+            else if (arg == "--validate") options.validateResult = true;
+            else if (arg == "--csv") options.csvFile = next_value();
+            else if (arg == "--help" || arg == "-h") {
+                print_usage(argv[0]);
+                return 0;
+            }
+            else throw std::invalid_argument("unknown option " + arg);
+        }
+        if (options.iterations == 0 || options.workGroup == 0) {
+            throw std::invalid_argument("--iterations and --workgroup must be at least 1");
+        }
+        for (size_t rhs : options.rhs) {
+            if (rhs == 0) {
+                throw std::invalid_argument("--rhs values must be at least 1");
+            }
+        }
+        for (auto& typeName : options.types) {
+            if (typeName != "double" && typeName != "float") {
+                throw std::invalid_argument("the sparse kernels are only built for double and float, not " + typeName);
+            }
+        }
+    }
+    catch (const std::exception& e) {
+        std::cout << "Error: " << e.what() << "\n";
+        print_usage(argv[0]);
+        return -1;
+    }
+
+    // create queues for the offload devices, skipping devices that are not available
+    std::vector<std::pair<std::string, queue>> deviceQueues;
+    for (auto& deviceName : options.devices) {
+        try {
+            queue deviceQueue = make_queue(deviceName);
+            std::cout << "Offload Device       : " << deviceQueue.get_device().get_info<info::device::name>() << " (" << deviceName << ")\n\n";
+            deviceQueues.emplace_back(deviceName, deviceQueue);
+        }
+        catch (const std::exception& e) {
+            std::cout << "Skipping device " << deviceName << ": " << e.what() << "\n\n";
+        }
+    }
+
+    std::vector<SparseResult> results;
+
+    // double and float are the only types accepted above, and both have AccT == T
+    try {
+        run_types(options.types, deviceQueues, [&](auto inputType, auto, const std::string& typeName,
+                                                    std::vector<std::pair<std::string, queue>>& typeQueues, bool) {
+            using T = typename decltype(inputType)::type;
+            if constexpr (std::is_same_v<T, double> || std::is_same_v<T, float>) {
+                run_type<T>(typeName, options, typeQueues, results);
+            }
+        });
+    }
+    catch (const std::exception& e) {
+        std::cout << "Error: " << e.what() << "\n";
+        return -1;
+    }
+
+    // report results
+    print_sparse_results(results);
+    print_break_even(results);
+    if (!options.csvFile.empty()) {
+        write_sparse_csv(options.csvFile, results);
+        std::cout << "Results written to " << options.csvFile << "\n";
+    }
+
+    bool validationFailed = false;
+    for (auto& result : results) {
+        validationFailed |= result.validation == "failed";
+    }
+    if (options.validateResult) {
+        std::cout << (validationFailed ? "Validation failed\n" : "Validation passed\n");
+    }
+    return validationFailed ? -1 : 0;
+}
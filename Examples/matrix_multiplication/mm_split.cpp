@@ -0,0 +1,198 @@
+#include <algorithm>
+#include <iostream>
+#include "mm_split.hpp"
+
+template <typename T, typename AccT>
+SplitGemm<T, AccT>::SplitGemm(const std::vector<queue>& queues, size_t B) : B(B) {
+    if (queues.empty() || B == 0) {
+        throw std::invalid_argument("a split GEMM needs at least one queue and a work group size of at least 1");
+    }
+    for (auto& deviceQueue : queues) {
+        Part part;
+        part.deviceQueue = deviceQueue;
+        parts.push_back(part);
+    }
+    // nothing has been measured yet, so every queue starts with the same share
+    partShares.assign(parts.size(), 1.0 / parts.size());
+    partRows.assign(parts.size(), 0);
+    partKernelTimes.assign(parts.size(), 0.0);
+    partTimes.assign(parts.size(), 0.0);
+}
+
+template <typename T, typename AccT>
+SplitGemm<T, AccT>::~SplitGemm() {
+    for (auto& part : parts) {
+        part.deviceQueue.wait();
+        free(part.in1Device, part.deviceQueue);
+        free(part.in2Device, part.deviceQueue);
+        free(part.outDevice, part.deviceQueue);
+    }
+}
+
+// grow a device allocation to at least count elements, the old contents are not kept
+template <typename U>
+static void reserve_device(queue& deviceQueue, U*& data, size_t& capacity, size_t count) {
+    if (count <= capacity) {
+        return;
+    }
+    free(data, deviceQueue);
+    data = malloc_device<U>(count, deviceQueue);
+    capacity = count;
+}
+
+template <typename T, typename AccT>
+void SplitGemm<T, AccT>::multiply(const T* in1, const T* in2, AccT* out, const GemmShape& shape) {
+    check_shape(shape);
+    size_t M = shape.M;
+    size_t K = shape.K;
+    size_t N = shape.N;
+
+    // turn the shares into whole blocks of B rows, the last rows go to the queue with the largest share
+    // every queue keeps at least one block when there are enough rows, so its speed is still measured on the next call
+    size_t minimum = M >= B * parts.size() ? B : 0;
+    size_t assigned = 0;
+    for (size_t p = 0; p < parts.size(); p++) {
+        partRows[p] = std::max(minimum, static_cast<size_t>(M * partShares[p]) / B * B);
+        assigned += partRows[p];
+    }
+    size_t largest = std::max_element(partShares.begin(), partShares.end()) - partShares.begin();
+    if (assigned <= M) {
+        partRows[largest] += M - assigned;
+    }
+    else {
+        // the minimum blocks took more rows than there are, take them back from the queues with the most rows
+        size_t excess = assigned - M;
+        while (excess > 0) {
+            size_t most = std::max_element(partRows.begin(), partRows.end()) - partRows.begin();
+            size_t take = std::min(excess, partRows[most] - minimum);
+            partRows[most] -= take;
+            excess -= take;
+        }
+    }
+
+    // queue the uploads, the kernel, and the download on every queue before waiting on any of them,
+    // so all devices work at the same time
+    std::vector<event> firstEvents(parts.size());
+    std::vector<event> kernelEvents(parts.size());
+    std::vector<std::vector<event>> downloadEvents(parts.size());
+    size_t rowStart = 0;
+    for (size_t p = 0; p < parts.size(); p++) {
+        Part& part = parts[p];
+        size_t rows = partRows[p];
+        if (rows == 0) {
+            continue;
+        }
+
+        // in1 rows keep their leading dimension so they are one contiguous copy, the output rows are packed
+        size_t in1Span = matrix_span(rows, K, shape.lda);
+        size_t in2Span = matrix_span(K, N, shape.ldb);
+        reserve_device(part.deviceQueue, part.in1Device, part.in1Capacity, in1Span);
+        reserve_device(part.deviceQueue, part.in2Device, part.in2Capacity, in2Span);
+        reserve_device(part.deviceQueue, part.outDevice, part.outCapacity, rows * N);
+
+        firstEvents[p] = part.deviceQueue.memcpy(part.in1Device, in1 + rowStart * shape.lda, in1Span * sizeof(T));
+        event in2Event = part.deviceQueue.memcpy(part.in2Device, in2, in2Span * sizeof(T));
+        GemmShape partShape{ rows, K, N, shape.lda, shape.ldb, N };
+        kernelEvents[p] = mm_tiled_usm_kernel(part.deviceQueue, part.in1Device, part.in2Device, part.outDevice, partShape, B,
+                                              { firstEvents[p], in2Event });
+
+        // a packed output comes back in one copy, a padded one row by row so the padding on the host is not overwritten
+        AccT* outRows = out + rowStart * shape.ldc;
+        if (shape.ldc == N) {
+            downloadEvents[p].push_back(part.deviceQueue.memcpy(outRows, part.outDevice, rows * N * sizeof(AccT), kernelEvents[p]));
+        }
+        else {
+            for (size_t row = 0; row < rows; row++) {
+                downloadEvents[p].push_back(part.deviceQueue.memcpy(outRows + row * shape.ldc, part.outDevice + row * N, N * sizeof(AccT),
+                                                                    kernelEvents[p]));
+            }
+        }
+        rowStart += rows;
+    }
+    for (auto& part : parts) {
+        part.deviceQueue.wait();
+    }
+
+    // every time is measured on the queue's own device clock, from its first upload to its last download
+    for (size_t p = 0; p < parts.size(); p++) {
+        partKernelTimes[p] = 0.0;
+        partTimes[p] = 0.0;
+        if (partRows[p] == 0) {
+            continue;
+        }
+        auto kernel_end = kernelEvents[p].get_profiling_info<info::event_profiling::command_end>();
+        auto kernel_start = kernelEvents[p].get_profiling_info<info::event_profiling::command_start>();
+        partKernelTimes[p] = (kernel_end - kernel_start) / 1.0e6;
+        auto part_start = firstEvents[p].get_profiling_info<info::event_profiling::command_start>();
+        auto part_end = part_start;
+        for (auto& downloadEvent : downloadEvents[p]) {
+            part_end = std::max(part_end, downloadEvent.get_profiling_info<info::event_profiling::command_end>());
+        }
+        partTimes[p] = (part_end - part_start) / 1.0e6;
+    }
+    rebalance();
+}
+
+template <typename T, typename AccT>
+void SplitGemm<T, AccT>::rebalance() {
+    // rows per millisecond of every queue that ran in the last call
+    std::vector<double> rates(parts.size(), 0.0);
+    double rateSum = 0.0;
+    double measuredShare = 0.0;
+    for (size_t p = 0; p < parts.size(); p++) {
+        if (partRows[p] > 0 && partTimes[p] > 0.0) {
+            rates[p] = partRows[p] / partTimes[p];
+            rateSum += rates[p];
+            measuredShare += partShares[p];
+        }
+    }
+    if (rateSum == 0.0) {
+        return;
+    }
+
+    // queues that were measured split their combined share by speed, the others keep theirs,
+    // and the result is blended with the old split
+    for (size_t p = 0; p < parts.size(); p++) {
+        if (rates[p] > 0.0) {
+            double measured = measuredShare * rates[p] / rateSum;
+            partShares[p] = SPLIT_SMOOTHING * partShares[p] + (1.0 - SPLIT_SMOOTHING) * measured;
+        }
+    }
+    double shareSum = 0.0;
+    for (double share : partShares) {
+        shareSum += share;
+    }
+    for (double& share : partShares) {
+        share /= shareSum;
+    }
+}
+
+std::vector<std::pair<std::string, queue>> make_split_queues(const std::vector<std::pair<std::string, queue>>& deviceQueues, bool numa) {
+    std::vector<std::pair<std::string, queue>> splitQueues;
+    for (auto& [deviceName, deviceQueue] : deviceQueues) {
+        device offloadDevice = deviceQueue.get_device();
+        if (numa && offloadDevice.is_cpu()) {
+            try {
+                auto subDevices = offloadDevice.create_sub_devices<info::partition_property::partition_by_affinity_domain>(
+                    info::partition_affinity_domain::numa);
+                // a single NUMA node is the same as the whole CPU
+                if (subDevices.size() > 1) {
+                    for (size_t i = 0; i < subDevices.size(); i++) {
+                        splitQueues.emplace_back(deviceName + ".numa" + std::to_string(i), queue(subDevices[i], property::queue::enable_profiling()));
+                    }
+                    continue;
+                }
+            }
+            catch (const std::exception& e) {
+                std::cout << "Cannot partition " << deviceName << " by NUMA node, using it whole: " << e.what() << "\n";
+            }
+        }
+        splitQueues.emplace_back(deviceName, deviceQueue);
+    }
+    return splitQueues;
+}
+
+// the template is defined in this file, so instantiate the element types used by the host program
+#define MM_INSTANTIATE_SPLIT(T, AccT) \
+    template class SplitGemm<T, AccT>;
+MM_FOR_EACH_TYPE(MM_INSTANTIATE_SPLIT)
@@ -0,0 +1,64 @@
+#pragma once
+#include <CL/sycl.hpp>
+#include <string>
+#include <utility>
+#include <vector>
+#include "mm_kernels.hpp"
+using namespace sycl;
+
+// weight of the previous split when the shares are rebalanced, the rest comes from the latest measurement
+// smoothing keeps one noisy iteration from moving all the rows to another device
+#define SPLIT_SMOOTHING 0.5
+
+// SplitGemm multiplies one GEMM on several queues at the same time by giving every queue a block of output rows
+// each queue gets its rows of in1, all of in2, and its rows of out in its own USM device memory, so the queues
+// can be different devices, sub-devices of one device, or a mix
+// the split starts out even and is rebalanced after every call from the measured rows per millisecond of each queue,
+// so faster devices get more rows on the next call
+template <typename T, typename AccT>
+class SplitGemm {
+public:
+    SplitGemm(const std::vector<queue>& queues, size_t B);
+    ~SplitGemm();
+
+    // the object owns device memory, so it cannot be copied
+    SplitGemm(const SplitGemm&) = delete;
+    SplitGemm& operator=(const SplitGemm&) = delete;
+
+    // out = in1 * in2 for host matrices, blocks until every queue has copied its rows back, then rebalances
+    void multiply(const T* in1, const T* in2, AccT* out, const GemmShape& shape);
+
+    // rows given to each queue by the last call
+    const std::vector<size_t>& rows() const { return partRows; }
+    // fraction of the rows each queue will get on the next call
+    const std::vector<double>& shares() const { return partShares; }
+    // kernel time and time from the first upload to the last download of each queue in the last call, in milliseconds
+    const std::vector<double>& kernel_times() const { return partKernelTimes; }
+    const std::vector<double>& part_times() const { return partTimes; }
+
+private:
+    // one queue with its device allocations, which grow when the queue is given more rows
+    struct Part {
+        queue deviceQueue;
+        T* in1Device = nullptr;
+        T* in2Device = nullptr;
+        AccT* outDevice = nullptr;
+        size_t in1Capacity = 0;
+        size_t in2Capacity = 0;
+        size_t outCapacity = 0;
+    };
+
+    void rebalance();
+
+    size_t B;
+    std::vector<Part> parts;
+    std::vector<size_t> partRows;
+    std::vector<double> partShares;
+    std::vector<double> partKernelTimes;
+    std::vector<double> partTimes;
+};
+
+// queues for a split run, one per device queue given
+// with numa set, a CPU queue is replaced by one queue per NUMA node of the CPU (create_sub_devices by affinity domain),
+// named like cpu.numa0, and CPUs that cannot be partitioned are used whole
+std::vector<std::pair<std::string, queue>> make_split_queues(const std::vector<std::pair<std::string, queue>>& deviceQueues, bool numa);
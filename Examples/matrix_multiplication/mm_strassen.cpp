@@ -0,0 +1,178 @@
+#include <algorithm>
+#include "mm_strassen.hpp"
+
+// quadrant (row, col) of a view with even dimensions, the quadrant stays inside the original memory
+template <typename View>
+static View quadrant(const View& view, size_t row, size_t col) {
+    size_t rows = view.rows / 2;
+    size_t cols = view.cols / 2;
+    return View{ view.data + row * rows * view.ld + col * cols, rows, cols, view.ld };
+}
+
+// out = a + sign * b, element by element
+template <typename T, typename OutView, typename InView>
+static event add_views(queue& deviceQueue, OutView out, InView a, InView b, T sign, event dependency) {
+    return deviceQueue.submit([&](handler& queueHandler) {
+        queueHandler.depends_on(dependency);
+        queueHandler.parallel_for(range<2>{ out.rows, out.cols }, [=](id<2> index) {
+            size_t row = index[0];
+            size_t col = index[1];
+            out.data[row * out.ld + col] = a.data[row * a.ld + col] + sign * b.data[row * b.ld + col];
+        });
+    });
+}
+
+// out = sign * product, or out += sign * product when accumulate is set
+template <typename T, typename OutView, typename InView>
+static event update_view(queue& deviceQueue, OutView out, InView product, T sign, bool accumulate, event dependency) {
+    return deviceQueue.submit([&](handler& queueHandler) {
+        queueHandler.depends_on(dependency);
+        queueHandler.parallel_for(range<2>{ out.rows, out.cols }, [=](id<2> index) {
+            size_t row = index[0];
+            size_t col = index[1];
+            T value = sign * product.data[row * product.ld + col];
+            out.data[row * out.ld + col] = accumulate ? out.data[row * out.ld + col] + value : value;
+        });
+    });
+}
+
+template <typename T>
+StrassenGemm<T>::StrassenGemm(queue& deviceQueue, size_t M, size_t K, size_t N, size_t B, size_t cutoff)
+    : deviceQueue(deviceQueue), M(M), K(K), N(N), B(B) {
+    // allocate the temporaries of every level up front, each level needs half the size of the one above
+    size_t levelM = M;
+    size_t levelK = K;
+    size_t levelN = N;
+    while (std::min({ levelM, levelK, levelN }) > cutoff && levelM % 2 == 0 && levelK % 2 == 0 && levelN % 2 == 0) {
+        levelM /= 2;
+        levelK /= 2;
+        levelN /= 2;
+        Level level;
+        level.in1Sum = malloc_device<T>(levelM * levelK, deviceQueue);
+        level.in2Sum = malloc_device<T>(levelK * levelN, deviceQueue);
+        level.product = malloc_device<T>(levelM * levelN, deviceQueue);
+        level.M = levelM;
+        level.K = levelK;
+        level.N = levelN;
+        workspace.push_back(level);
+    }
+}
+
+template <typename T>
+StrassenGemm<T>::~StrassenGemm() {
+    // make sure nothing is still using the memory before it is freed
+    deviceQueue.wait();
+    for (auto& level : workspace) {
+        free(level.in1Sum, deviceQueue);
+        free(level.in2Sum, deviceQueue);
+        free(level.product, deviceQueue);
+    }
+}
+
+template <typename T>
+size_t StrassenGemm<T>::workspace_bytes() const {
+    size_t elements = 0;
+    for (auto& level : workspace) {
+        elements += level.M * level.K + level.K * level.N + level.M * level.N;
+    }
+    return elements * sizeof(T);
+}
+
+template <typename T>
+event StrassenGemm<T>::multiply(const T* in1, const T* in2, T* out, const GemmShape& shape, const std::vector<event>& dependencies) {
+    check_shape(shape);
+    if (shape.M != M || shape.K != K || shape.N != N) {
+        throw std::invalid_argument("shape does not match the shape the Strassen workspace was created for");
+    }
+    // collect the caller's dependencies in a single event, every later step depends on the one before it
+    event start = deviceQueue.submit([&](handler& queueHandler) {
+        queueHandler.depends_on(dependencies);
+        queueHandler.single_task([=]() {});
+    });
+    return multiply_level(View<const T>{ in1, M, K, shape.lda }, View<const T>{ in2, K, N, shape.ldb }, View<T>{ out, M, N, shape.ldc }, 0, start);
+}
+
+template <typename T>
+event StrassenGemm<T>::multiply_level(View<const T> in1, View<const T> in2, View<T> out, size_t level, event dependency) {
+    // below the cutoff the classical tiled kernel is faster than more additions
+    if (level == workspace.size()) {
+        GemmShape shape{ in1.rows, in1.cols, in2.cols, in1.ld, in2.ld, out.ld };
+        return mm_tiled_usm_kernel(deviceQueue, in1.data, in2.data, out.data, shape, B, { dependency });
+    }
+
+    // temporaries of this level
+    Level& temp = workspace[level];
+    View<T> in1Sum{ temp.in1Sum, temp.M, temp.K, temp.K };
+    View<T> in2Sum{ temp.in2Sum, temp.K, temp.N, temp.N };
+    View<T> product{ temp.product, temp.M, temp.N, temp.N };
+    View<const T> in1SumRead{ temp.in1Sum, temp.M, temp.K, temp.K };
+    View<const T> in2SumRead{ temp.in2Sum, temp.K, temp.N, temp.N };
+    View<const T> productRead{ temp.product, temp.M, temp.N, temp.N };
+
+    // quadrants of the inputs and the output
+    auto a11 = quadrant(in1, 0, 0);
+    auto a12 = quadrant(in1, 0, 1);
+    auto a21 = quadrant(in1, 1, 0);
+    auto a22 = quadrant(in1, 1, 1);
+    auto b11 = quadrant(in2, 0, 0);
+    auto b12 = quadrant(in2, 0, 1);
+    auto b21 = quadrant(in2, 1, 0);
+    auto b22 = quadrant(in2, 1, 1);
+    auto c11 = quadrant(out, 0, 0);
+    auto c12 = quadrant(out, 0, 1);
+    auto c21 = quadrant(out, 1, 0);
+    auto c22 = quadrant(out, 1, 1);
+
+    // the seven products share one product buffer, so they run one after another
+    // each output quadrant is assigned by its first product and accumulated by the later ones
+    event step = dependency;
+
+    // M1 = (A11 + A22)(B11 + B22), C11 = M1, C22 = M1
+    step = add_views(deviceQueue, in1Sum, a11, a22, T(1), step);
+    step = add_views(deviceQueue, in2Sum, b11, b22, T(1), step);
+    step = multiply_level(in1SumRead, in2SumRead, product, level + 1, step);
+    step = update_view(deviceQueue, c11, productRead, T(1), false, step);
+    step = update_view(deviceQueue, c22, productRead, T(1), false, step);
+
+    // M2 = (A21 + A22) B11, C21 = M2, C22 -= M2
+    step = add_views(deviceQueue, in1Sum, a21, a22, T(1), step);
+    step = multiply_level(in1SumRead, b11, product, level + 1, step);
+    step = update_view(deviceQueue, c21, productRead, T(1), false, step);
+    step = update_view(deviceQueue, c22, productRead, T(-1), true, step);
+
+    // M3 = A11 (B12 - B22), C12 = M3, C22 += M3
+    step = add_views(deviceQueue, in2Sum, b12, b22, T(-1), step);
+    step = multiply_level(a11, in2SumRead, product, level + 1, step);
+    step = update_view(deviceQueue, c12, productRead, T(1), false, step);
+    step = update_view(deviceQueue, c22, productRead, T(1), true, step);
+
+    // M4 = A22 (B21 - B11), C11 += M4, C21 += M4
+    step = add_views(deviceQueue, in2Sum, b21, b11, T(-1), step);
+    step = multiply_level(a22, in2SumRead, product, level + 1, step);
+    step = update_view(deviceQueue, c11, productRead, T(1), true, step);
+    step = update_view(deviceQueue, c21, productRead, T(1), true, step);
+
+    // M5 = (A11 + A12) B22, C11 -= M5, C12 += M5
+    step = add_views(deviceQueue, in1Sum, a11, a12, T(1), step);
+    step = multiply_level(in1SumRead, b22, product, level + 1, step);
+    step = update_view(deviceQueue, c11, productRead, T(-1), true, step);
+    step = update_view(deviceQueue, c12, productRead, T(1), true, step);
+
+    // M6 = (A21 - A11)(B11 + B12), C22 += M6
+    step = add_views(deviceQueue, in1Sum, a21, a11, T(-1), step);
+    step = add_views(deviceQueue, in2Sum, b11, b12, T(1), step);
+    step = multiply_level(in1SumRead, in2SumRead, product, level + 1, step);
+    step = update_view(deviceQueue, c22, productRead, T(1), true, step);
+
+    // M7 = (A12 - A22)(B21 + B22), C11 += M7
+    step = add_views(deviceQueue, in1Sum, a12, a22, T(-1), step);
+    step = add_views(deviceQueue, in2Sum, b21, b22, T(1), step);
+    step = multiply_level(in1SumRead, in2SumRead, product, level + 1, step);
+    step = update_view(deviceQueue, c11, productRead, T(1), true, step);
+
+    return step;
+}
+
+// the template is defined in this file, so instantiate the element types used by the host program
+template class StrassenGemm<double>;
+template class StrassenGemm<float>;
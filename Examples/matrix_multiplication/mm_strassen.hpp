@@ -0,0 +1,63 @@
+#pragma once
+#include <CL/sycl.hpp>
+#include <vector>
+#include "mm_kernels.hpp"
+using namespace sycl;
+
+// StrassenGemm multiplies matrices in USM device memory with Strassen's algorithm
+// every recursion level splits the matrices into quadrants and replaces the 8 quadrant products of the
+// classical algorithm with 7, at the cost of 18 quadrant additions and a larger rounding error
+// the recursion stops when a dimension is at or below the cutoff (or odd), and the remaining products
+// run on the tiled USM kernel
+// the temporaries of every level are allocated once when the object is created and reused by every call,
+// so the recursion itself never allocates
+// only floating point types where the input and accumulator type are the same are instantiated (double, float)
+template <typename T>
+class StrassenGemm {
+public:
+    StrassenGemm(queue& deviceQueue, size_t M, size_t K, size_t N, size_t B, size_t cutoff);
+    ~StrassenGemm();
+
+    // the object owns device memory, so it cannot be copied
+    StrassenGemm(const StrassenGemm&) = delete;
+    StrassenGemm& operator=(const StrassenGemm&) = delete;
+
+    // queue out = in1 * in2 for device pointers with the M, K, N given to the constructor
+    // (leading dimensions may differ), returns the event of the last kernel without waiting
+    event multiply(const T* in1, const T* in2, T* out, const GemmShape& shape, const std::vector<event>& dependencies = {});
+
+    // number of Strassen levels before the tiled kernel takes over
+    size_t levels() const { return workspace.size(); }
+
+    // size of the pooled temporaries in bytes
+    size_t workspace_bytes() const;
+
+private:
+    // a rows x cols matrix inside device memory with leading dimension ld
+    template <typename U>
+    struct View {
+        U* data;
+        size_t rows;
+        size_t cols;
+        size_t ld;
+    };
+
+    // temporaries for one recursion level: the two quadrant sums and the quadrant product
+    struct Level {
+        T* in1Sum;
+        T* in2Sum;
+        T* product;
+        size_t M;
+        size_t K;
+        size_t N;
+    };
+
+    event multiply_level(View<const T> in1, View<const T> in2, View<T> out, size_t level, event dependency);
+
+    queue deviceQueue;
+    size_t M;
+    size_t K;
+    size_t N;
+    size_t B;
+    std::vector<Level> workspace;
+};
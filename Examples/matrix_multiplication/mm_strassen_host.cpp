@@ -0,0 +1,256 @@
+#include <CL/sycl.hpp>
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <chrono>
+#include "mm_bench.hpp"
+#include "mm_kernels.hpp"
+#include "mm_strassen.hpp"
+using namespace sycl;
+
+// default values, each one can be changed from the command line
+#define WORK_GROUP_SIZE 16
+#define WARMUP_ITERATIONS 1
+#define TIMED_ITERATIONS 3
+
+// settings for a benchmark run, filled in from the command line
+struct Options {
+    std::vector<size_t> sizes{ 1024, 2048, 4096 };
+    std::vector<size_t> cutoffs{ 256, 512, 1024 };
+    size_t workGroup = WORK_GROUP_SIZE;
+    std::vector<std::string> devices{ "cpu", "gpu" };
+    std::vector<std::string> types{ "double", "float" };
+    size_t warmup = WARMUP_ITERATIONS;
+    size_t iterations = TIMED_ITERATIONS;
+    std::string csvFile;
+};
+
+// one row of the report: a cutoff of 0 is the classical tiled kernel without any Strassen level
+struct StrassenResult {
+    std::string device;
+    std::string type;
+    size_t N = 0;
+    size_t cutoff = 0;
+    size_t levels = 0;
+    double workspaceMB = 0.0;
+    TimingStats time;      // measured on the host around multiply and wait, data stays on the device
+    double gflops = 0.0;   // effective rate, counting the 2*N^3 operations of the classical algorithm
+    double speedup = 0.0;  // classical median time / this median time
+    double error = 0.0;    // max |out - reference| / max |reference|
+};
+
+static void print_usage(const char* program) {
+    std::cout << "Usage: " << program << " [options]\n"
+              << "  --sizes N[,N...]          matrix sizes (default 1024,2048,4096)\n"
+              << "  --cutoffs C[,C...]        sizes at which the recursion switches to the tiled kernel (default 256,512,1024)\n"
+              << "  --workgroup B             work group size of the tiled kernel (default " << WORK_GROUP_SIZE << ")\n"
+              << "  --devices D[,D...]        cpu, gpu, fpga_emu, fpga (default cpu,gpu)\n"
+              << "  --types T[,T...]          double, float (default double,float)\n"
+              << "  --warmup W                untimed iterations per configuration (default " << WARMUP_ITERATIONS << ")\n"
+              << "  --iterations I            timed iterations per configuration (default " << TIMED_ITERATIONS << ")\n"
+              << "  --csv FILE                write results as CSV\n";
+}
+
+// normwise relative error of a result, which is what Strassen's error bound is stated in
+template <typename T>
+static double relative_error(const std::vector<T>& out, const std::vector<T>& outVal) {
+    double maxDifference = 0.0;
+    double maxReference = 0.0;
+    for (size_t i = 0; i < out.size(); i++) {
+        maxDifference = std::max(maxDifference, std::abs(static_cast<double>(out[i]) - static_cast<double>(outVal[i])));
+        maxReference = std::max(maxReference, std::abs(static_cast<double>(outVal[i])));
+    }
+    return maxReference > 0.0 ? maxDifference / maxReference : maxDifference;
+}
+
+// run the classical baseline and every cutoff for one element type
+template <typename T>
+static void run_type(const std::string& typeName, const Options& options, std::vector<std::pair<std::string, queue>>& deviceQueues,
+                     std::vector<StrassenResult>& results) {
+    for (size_t N : options.sizes) {
+        GemmShape shape = make_shape(N, N, N);
+
+        std::cout << "Running Strassen matrix multiplication (" << typeName << ")\n"
+                  << "Matrix size = [ " << N << " x " << N << " ]\n\n";
+
+        // uniform inputs in [-1, 1), so the error is not hidden by exactly representable products
+        std::vector<T> in1Host(N * N);
+        std::vector<T> in2Host(N * N);
+        std::vector<T> outHost(N * N);
+        std::vector<T> outVal(N * N);
+        for (size_t i = 0; i < N * N; i++) {
+            in1Host[i] = static_cast<T>(rand() / (RAND_MAX + 1.0) * 2.0 - 1.0);
+            in2Host[i] = static_cast<T>(rand() / (RAND_MAX + 1.0) * 2.0 - 1.0);
+        }
+
+        // host computation for the error
+        std::cout << "Computing host reference...\n";
+        mm_host_reference(in1Host.data(), in2Host.data(), outVal.data(), shape);
+
+        for (auto& [deviceName, deviceQueue] : deviceQueues) {
+
+            // the inputs are copied to the device once, every configuration reads the same memory
+            T* in1Device = malloc_device<T>(N * N, deviceQueue);
+            T* in2Device = malloc_device<T>(N * N, deviceQueue);
+            T* outDevice = malloc_device<T>(N * N, deviceQueue);
+            deviceQueue.memcpy(in1Device, in1Host.data(), N * N * sizeof(T));
+            deviceQueue.memcpy(in2Device, in2Host.data(), N * N * sizeof(T));
+            deviceQueue.wait();
+
+            // the classical run comes first so the speedup of every cutoff can be computed against it
+            double classicalTime = 0.0;
+            std::vector<size_t> cutoffs{ 0 };
+            cutoffs.insert(cutoffs.end(), options.cutoffs.begin(), options.cutoffs.end());
+
+            for (size_t cutoff : cutoffs) {
+                std::string label = cutoff == 0 ? "classical" : "cutoff " + std::to_string(cutoff);
+                std::cout << "Executing " << label << " on " << deviceName << "...\n";
+
+                std::vector<double> times;
+                StrassenResult result;
+                try {
+                    // a cutoff of N or more never recurses, so the same driver runs the classical kernel
+                    StrassenGemm<T> strassen(deviceQueue, N, N, N, options.workGroup, cutoff == 0 ? N : cutoff);
+                    result.levels = strassen.levels();
+                    result.workspaceMB = strassen.workspace_bytes() / 1.0e6;
+
+                    for (size_t iter = 0; iter < options.warmup + options.iterations; iter++) {
+                        auto deviceStart = std::chrono::high_resolution_clock::now();
+                        strassen.multiply(in1Device, in2Device, outDevice, shape);
+                        deviceQueue.wait();
+                        auto deviceStop = std::chrono::high_resolution_clock::now();
+                        if (iter >= options.warmup) {
+                            times.push_back(std::chrono::duration<double, std::milli>(deviceStop - deviceStart).count());
+                        }
+                    }
+                    deviceQueue.memcpy(outHost.data(), outDevice, N * N * sizeof(T));
+                    deviceQueue.wait();
+                }
+                catch (const std::exception& e) {
+                    std::cout << "Skipping " << label << ": " << e.what() << "\n\n";
+                    continue;
+                }
+
+                result.device = deviceName;
+                result.type = typeName;
+                result.N = N;
+                result.cutoff = cutoff;
+                result.time = summarize(times);
+                result.gflops = gemm_gflops(N, result.time.median);
+                if (cutoff == 0) {
+                    classicalTime = result.time.median;
+                }
+                result.speedup = result.time.median > 0.0 ? classicalTime / result.time.median : 0.0;
+                result.error = relative_error(outHost, outVal);
+                results.push_back(result);
+            }
+
+            free(in1Device, deviceQueue);
+            free(in2Device, deviceQueue);
+            free(outDevice, deviceQueue);
+        }
+        std::cout << "\n";
+    }
+}
+
+// print the results as a table on the console
+static void print_strassen_results(const std::vector<StrassenResult>& results) {
+    std::cout << std::left << std::setw(10) << "device" << std::setw(16) << "type" << std::right << std::setw(7) << "N"
+              << std::setw(8) << "cutoff" << std::setw(8) << "levels" << std::setw(14) << "median ms" << std::setw(12) << "GFLOP/s"
+              << std::setw(10) << "speedup" << std::setw(14) << "rel. error" << std::setw(14) << "workspace MB" << "\n";
+    for (auto& result : results) {
+        std::cout << std::left << std::setw(10) << result.device << std::setw(16) << result.type << std::right << std::setw(7) << result.N
+                  << std::setw(8) << (result.cutoff == 0 ? std::string("-") : std::to_string(result.cutoff)) << std::setw(8) << result.levels
+                  << std::fixed << std::setprecision(3) << std::setw(14) << result.time.median << std::setw(12) << result.gflops
+                  << std::setw(10) << result.speedup << std::scientific << std::setprecision(2) << std::setw(14) << result.error
+                  << std::fixed << std::setw(14) << result.workspaceMB << std::defaultfloat << "\n";
+    }
+    std::cout << "\n";
+}
+
+// write the results as CSV, one row per configuration
+static void write_strassen_csv(const std::string& fileName, const std::vector<StrassenResult>& results) {
+    std::ofstream file(fileName);
+    file << "device,type,N,cutoff,levels,min_ms,median_ms,p95_ms,gflops,speedup,relative_error,workspace_mb\n";
+    for (auto& result : results) {
+        file << result.device << "," << result.type << "," << result.N << "," << result.cutoff << "," << result.levels << ","
+             << result.time.min << "," << result.time.median << "," << result.time.p95 << "," << result.gflops << ","
+             << result.speedup << "," << result.error << "," << result.workspaceMB << "\n";
+    }
+}
+
+int main(int argc, char* argv[]) {
+
+    Options options;
+
+    // parse command line options
+    try {
+        for (int i = 1; i < argc; i++) {
+            std::string arg = argv[i];
+            auto next_value = [&]() -> std::string {
+                if (i + 1 >= argc) {
+                    throw std::invalid_argument("missing value for " + arg);
+                }
+                return argv[++i];
+            };
+            if (arg == "--sizes") options.sizes = split_sizes(next_value());
+            else if (arg == "--cutoffs") options.cutoffs = split_sizes(next_value());
+            else if (arg == "--workgroup") options.workGroup = std::stoul(next_value());
+            else if (arg == "--devices") options.devices = split_list(next_value());
+            else if (arg == "--types") options.types = split_list(next_value());
+            else if (arg == "--warmup") options.warmup = std::stoul(next_value());
+            else if (arg == "--iterations") options.iterations = std::stoul(next_value());
+            else if (arg == "--csv") options.csvFile = next_value();
+            else if (arg == "--help" || arg == "-h") {
+                print_usage(argv[0]);
+                return 0;
+            }
+            else throw std::invalid_argument("unknown option " + arg);
+        }
+        if (options.iterations == 0 || options.workGroup == 0) {
+            throw std::invalid_argument("--iterations and --workgroup must be at least 1");
+        }
+        for (auto& typeName : options.types) {
+            if (typeName != "double" && typeName != "float") {
+                throw std::invalid_argument("Strassen is only built for double and float, not " + typeName);
+            }
+        }
+    }
+    catch (const std::exception& e) {
+        std::cout << "Error: " << e.what() << "\n";
+        print_usage(argv[0]);
+        return -1;
+    }
+
+    // create queues for the offload devices, skipping devices that are not available
+    std::vector<std::pair<std::string, queue>> deviceQueues;
+    for (auto& deviceName : options.devices) {
+        try {
+            queue deviceQueue = make_queue(deviceName);
+            std::cout << "Offload Device       : " << deviceQueue.get_device().get_info<info::device::name>() << " (" << deviceName << ")\n\n";
+            deviceQueues.emplace_back(deviceName, deviceQueue);
+        }
+        catch (const std::exception& e) {
+            std::cout << "Skipping device " << deviceName << ": " << e.what() << "\n\n";
+        }
+    }
+
+    std::vector<StrassenResult> results;
+
+    // double and float are the only types accepted above, and both have AccT == T
+    run_types(options.types, deviceQueues, [&](auto inputType, auto, const std::string& typeName,
+                                                std::vector<std::pair<std::string, queue>>& typeQueues, bool) {
+        using T = typename decltype(inputType)::type;
+        if constexpr (std::is_same_v<T, double> || std::is_same_v<T, float>) {
+            run_type<T>(typeName, options, typeQueues, results);
+        }
+    });
+
+    // report results
+    print_strassen_results(results);
+    if (!options.csvFile.empty()) {
+        write_strassen_csv(options.csvFile, results);
+        std::cout << "Results written to " << options.csvFile << "\n";
+    }
+    return 0;
+}
@@ -0,0 +1,166 @@
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include "mm_stream.hpp"
+
+template <typename T, typename AccT>
+StreamGemm<T, AccT>::StreamGemm(queue& deviceQueue, size_t panelM, size_t panelK, size_t panelN, size_t B)
+    : deviceQueue(deviceQueue), panelM(panelM), panelK(panelK), panelN(panelN), B(B) {
+    if (panelM == 0 || panelK == 0 || panelN == 0 || B == 0) {
+        throw std::invalid_argument("panel sizes and the work group size must be at least 1");
+    }
+    // panels and tiles are allocated once for the largest size, edge panels use part of them
+    for (size_t slot = 0; slot < 2; slot++) {
+        in1Panels[slot] = malloc_device<T>(panelM * panelK, deviceQueue);
+        in2Panels[slot] = malloc_device<T>(panelK * panelN, deviceQueue);
+        outTiles[slot] = malloc_device<AccT>(panelM * panelN, deviceQueue);
+        in1Stages[slot] = malloc_host<T>(panelM * panelK, deviceQueue);
+        in2Stages[slot] = malloc_host<T>(panelK * panelN, deviceQueue);
+        outStages[slot] = malloc_host<AccT>(panelM * panelN, deviceQueue);
+    }
+}
+
+template <typename T, typename AccT>
+StreamGemm<T, AccT>::~StreamGemm() {
+    // make sure nothing is still using the memory before it is freed
+    deviceQueue.wait();
+    for (size_t slot = 0; slot < 2; slot++) {
+        free(in1Panels[slot], deviceQueue);
+        free(in2Panels[slot], deviceQueue);
+        free(outTiles[slot], deviceQueue);
+        free(in1Stages[slot], deviceQueue);
+        free(in2Stages[slot], deviceQueue);
+        free(outStages[slot], deviceQueue);
+    }
+}
+
+template <typename T, typename AccT>
+size_t StreamGemm<T, AccT>::device_bytes() const {
+    return 2 * ((panelM * panelK + panelK * panelN) * sizeof(T) + panelM * panelN * sizeof(AccT));
+}
+
+// copy a rows x cols block with leading dimension ld into packed memory, or back
+template <typename U>
+static void pack_block(const U* source, size_t sourceLd, U* target, size_t targetLd, size_t rows, size_t cols) {
+    for (size_t i = 0; i < rows; i++) {
+        std::copy_n(source + i * sourceLd, cols, target + i * targetLd);
+    }
+}
+
+template <typename T, typename AccT>
+void StreamGemm<T, AccT>::finish_tile(size_t slot, AccT* out, size_t ldc) {
+    PendingTile& tile = pendingTiles[slot];
+    if (tile.rows == 0) {
+        return;
+    }
+    tile.download.wait();
+    auto hostStart = std::chrono::high_resolution_clock::now();
+    pack_block(outStages[slot], tile.cols, out + tile.row * ldc + tile.col, ldc, tile.rows, tile.cols);
+    auto hostStop = std::chrono::high_resolution_clock::now();
+    lastStats.hostTime += std::chrono::duration<double, std::milli>(hostStop - hostStart).count();
+    tile.rows = 0;
+}
+
+template <typename T, typename AccT>
+void StreamGemm<T, AccT>::multiply(const T* in1, const T* in2, AccT* out, const GemmShape& shape) {
+    check_shape(shape);
+    size_t M = shape.M;
+    size_t K = shape.K;
+    size_t N = shape.N;
+    lastStats = StreamStats();
+
+    // events of the last use of every slot, so a slot is only overwritten once the previous user is done
+    event uploadEvents[2][2];     // [slot][in1 / in2], read by the host before it packs into the staging slot again
+    event kernelEvents[2];        // last kernel that read the device panel slot
+    std::vector<event> uploads;
+    std::vector<event> kernels;
+    std::vector<event> downloads;
+
+    size_t step = 0;
+    size_t tile = 0;
+    for (size_t row = 0; row < M; row += panelM) {
+        for (size_t col = 0; col < N; col += panelN) {
+            size_t rows = std::min(panelM, M - row);
+            size_t cols = std::min(panelN, N - col);
+            size_t tileSlot = tile % 2;
+            // the tile that used this output slot two tiles ago has to be unpacked before its staging memory is reused
+            finish_tile(tileSlot, out, shape.ldc);
+
+            event tileEvent;
+            for (size_t depth = 0; depth < K; depth += panelK) {
+                size_t depthCount = std::min(panelK, K - depth);
+                size_t slot = step % 2;
+
+                // pack the next panels while the device still works on the previous step
+                uploadEvents[slot][0].wait();
+                uploadEvents[slot][1].wait();
+                auto hostStart = std::chrono::high_resolution_clock::now();
+                pack_block(in1 + row * shape.lda + depth, shape.lda, in1Stages[slot], depthCount, rows, depthCount);
+                pack_block(in2 + depth * shape.ldb + col, shape.ldb, in2Stages[slot], cols, depthCount, cols);
+                auto hostStop = std::chrono::high_resolution_clock::now();
+                lastStats.hostTime += std::chrono::duration<double, std::milli>(hostStop - hostStart).count();
+
+                // the device panel slot is free once the kernel two steps back has read it
+                uploadEvents[slot][0] = deviceQueue.memcpy(in1Panels[slot], in1Stages[slot], rows * depthCount * sizeof(T), kernelEvents[slot]);
+                uploadEvents[slot][1] = deviceQueue.memcpy(in2Panels[slot], in2Stages[slot], depthCount * cols * sizeof(T), kernelEvents[slot]);
+                uploads.push_back(uploadEvents[slot][0]);
+                uploads.push_back(uploadEvents[slot][1]);
+
+                // the first panel of a tile overwrites the slot once its last download is done, the others add to it in order
+                std::vector<event> dependencies{ uploadEvents[slot][0], uploadEvents[slot][1] };
+                dependencies.push_back(depth == 0 ? pendingTiles[tileSlot].download : tileEvent);
+                GemmShape panelShape{ rows, depthCount, cols, depthCount, cols, cols };
+                tileEvent = mm_tiled_usm_kernel(deviceQueue, in1Panels[slot], in2Panels[slot], outTiles[tileSlot], panelShape, B,
+                                                dependencies, depth > 0);
+                kernelEvents[slot] = tileEvent;
+                kernels.push_back(tileEvent);
+                step++;
+            }
+
+            // copy the finished tile back without waiting, it is unpacked when the slot comes around again
+            PendingTile& pending = pendingTiles[tileSlot];
+            pending.row = row;
+            pending.col = col;
+            pending.rows = rows;
+            pending.cols = cols;
+            pending.download = deviceQueue.memcpy(outStages[tileSlot], outTiles[tileSlot], rows * cols * sizeof(AccT), tileEvent);
+            downloads.push_back(pending.download);
+            tile++;
+        }
+    }
+    finish_tile(0, out, shape.ldc);
+    finish_tile(1, out, shape.ldc);
+    deviceQueue.wait();
+
+    // add up the device time of every command, and the span from the first to the last one
+    uint64_t first = std::numeric_limits<uint64_t>::max();
+    uint64_t last = 0;
+    auto add_times = [&](std::vector<event>& events, double& total) {
+        for (auto& queueEvent : events) {
+            auto end = queueEvent.get_profiling_info<info::event_profiling::command_end>();
+            auto start = queueEvent.get_profiling_info<info::event_profiling::command_start>();
+            total += (end - start) / 1.0e6;
+            first = std::min<uint64_t>(first, start);
+            last = std::max<uint64_t>(last, end);
+        }
+    };
+    add_times(uploads, lastStats.uploadTime);
+    add_times(kernels, lastStats.computeTime);
+    add_times(downloads, lastStats.downloadTime);
+    lastStats.deviceTime = last > first ? (last - first) / 1.0e6 : 0.0;
+    lastStats.steps = step;
+    lastStats.tiles = tile;
+}
+
+template <typename T, typename AccT>
+size_t stream_panel_size(size_t budgetBytes, size_t B) {
+    // two slots of two square input panels and one square output tile: P * P * (4 * sizeof(T) + 2 * sizeof(AccT))
+    size_t panel = static_cast<size_t>(std::sqrt(static_cast<double>(budgetBytes) / (4 * sizeof(T) + 2 * sizeof(AccT))));
+    return std::max(B, panel / B * B);
+}
+
+// the templates are defined in this file, so instantiate the element types used by the host program
+#define MM_INSTANTIATE_STREAM(T, AccT) \
+    template class StreamGemm<T, AccT>; \
+    template size_t stream_panel_size<T, AccT>(size_t budgetBytes, size_t B);
+MM_FOR_EACH_TYPE(MM_INSTANTIATE_STREAM)
@@ -0,0 +1,88 @@
+#pragma once
+#include <CL/sycl.hpp>
+#include <algorithm>
+#include <vector>
+#include "mm_kernels.hpp"
+using namespace sycl;
+
+// default device memory budget of the streaming GEMM in MB, panels are sized to fit in it
+#define STREAM_BUDGET_MB 256
+
+// where the time of one streamed multiplication went, all in milliseconds
+// the device times come from the event profile, so they are measured on the device clock
+struct StreamStats {
+    size_t steps = 0;          // panel pairs uploaded and multiplied
+    size_t tiles = 0;          // output tiles written back
+    double uploadTime = 0.0;   // sum of the panel uploads
+    double computeTime = 0.0;  // sum of the panel kernels
+    double downloadTime = 0.0; // sum of the output tile downloads
+    double deviceTime = 0.0;   // from the start of the first upload to the end of the last download
+    double hostTime = 0.0;     // spent on the host packing panels and unpacking tiles
+
+    // share of the transfer time that ran while the device was computing, in percent
+    double hidden_percent() const {
+        double transfer = uploadTime + downloadTime;
+        double hidden = uploadTime + computeTime + downloadTime - deviceTime;
+        return transfer > 0.0 ? 100.0 * std::min(std::max(hidden / transfer, 0.0), 1.0) : 0.0;
+    }
+};
+
+// StreamGemm multiplies host matrices of any size with a fixed amount of device memory
+// the output is cut into panelM x panelN tiles and every tile is summed over panelK wide panels of in1 and tall panels of in2
+// there are two device slots for the input panels: while the kernel multiplies the panels in one slot, the host packs the
+// next panels into pinned staging memory and uploads them into the other slot
+// output tiles also have two slots, so a finished tile is copied back while the next tile is computed
+// only the panels and tiles live in device and pinned host memory, the full matrices stay in pageable host memory
+template <typename T, typename AccT>
+class StreamGemm {
+public:
+    StreamGemm(queue& deviceQueue, size_t panelM, size_t panelK, size_t panelN, size_t B);
+    ~StreamGemm();
+
+    // the object owns device and pinned host memory, so it cannot be copied
+    StreamGemm(const StreamGemm&) = delete;
+    StreamGemm& operator=(const StreamGemm&) = delete;
+
+    // out = in1 * in2 for host matrices, blocks until the whole output has been written back
+    void multiply(const T* in1, const T* in2, AccT* out, const GemmShape& shape);
+
+    // timing of the last call
+    const StreamStats& stats() const { return lastStats; }
+
+    // device memory used by the panel and tile slots in bytes
+    size_t device_bytes() const;
+
+private:
+    // unpack output slot tile into out once its download has finished
+    void finish_tile(size_t slot, AccT* out, size_t ldc);
+
+    queue deviceQueue;
+    size_t panelM;
+    size_t panelK;
+    size_t panelN;
+    size_t B;
+
+    // two slots of each, on the device and as pinned host staging memory
+    T* in1Panels[2];
+    T* in2Panels[2];
+    AccT* outTiles[2];
+    T* in1Stages[2];
+    T* in2Stages[2];
+    AccT* outStages[2];
+
+    // position of the tile waiting in each output slot, rows == 0 when the slot is empty
+    struct PendingTile {
+        size_t row = 0;
+        size_t col = 0;
+        size_t rows = 0;
+        size_t cols = 0;
+        event download;
+    };
+    PendingTile pendingTiles[2];
+
+    StreamStats lastStats;
+};
+
+// largest square panel, a multiple of B, whose slots fit in budgetBytes of device memory
+template <typename T, typename AccT>
+size_t stream_panel_size(size_t budgetBytes, size_t B);
@@ -0,0 +1,135 @@
+#include <CL/sycl.hpp>
+#include "mm_kernels.hpp"
+using namespace sycl;
+
+// TM and TN set the size of the micro-tile computed by each work item, so one work item
+// computes TM x TN output elements held in private registers instead of a single element
+template <typename T, typename AccT, size_t TM, size_t TN>
+event mm_subgroup_kernel(queue& deviceQueue, const T* in1, const T* in2, AccT* out, const GemmShape& shape, size_t B) {
+    check_shape(shape);
+    size_t M = shape.M;
+    size_t K = shape.K;
+    size_t N = shape.N;
+    size_t lda = shape.lda;
+    size_t ldb = shape.ldb;
+    size_t ldc = shape.ldc;
+
+    // each sub-group covers TM rows and SUBGROUP_SIZE * TN columns of the output
+    // a work group stacks several sub-groups on top of each other to cover a B row block
+    size_t groupRows = std::max<size_t>(B / TM, 1);
+
+    // create 2-D SYCL range item for the number of work items and work group items
+    // there is one work item per micro-tile, not one per output element
+    // the range is rounded up to whole work groups, micro-tiles on the edge are masked element by element
+    size_t tileRows = (M + TM - 1) / TM;
+    size_t tileCols = (N + TN * SUBGROUP_SIZE - 1) / (TN * SUBGROUP_SIZE) * SUBGROUP_SIZE;
+    range<2> numItems{ (tileRows + groupRows - 1) / groupRows * groupRows, tileCols };
+    range<2> workGroup{ groupRows, SUBGROUP_SIZE };
+
+    // create buffers which are used to pass data between host and device
+    // the buffers are 1-D and only span the matrices, so rows are indexed with the leading dimension
+    // use_host_ptr makes the runtime work on the host memory itself (a vector or a memory-mapped file) instead of a copy of it
+    buffer<T, 1> in1Buffer(in1, range<1>{ matrix_span(M, K, lda) }, { property::buffer::use_host_ptr() });
+    buffer<T, 1> in2Buffer(in2, range<1>{ matrix_span(K, N, ldb) }, { property::buffer::use_host_ptr() });
+    buffer<AccT, 1> outBuffer(out, range<1>{ matrix_span(M, N, ldc) }, { property::buffer::use_host_ptr() });
+
+    // submit work to the queue and capture details in event
+    auto queueEvent = deviceQueue.submit([&](handler& queueHandler) {
+
+    // create accessors for device to read/write data in buffers
+    auto in1Accessor = in1Buffer.template get_access<access::mode::read>(queueHandler);
+    auto in2Accessor = in2Buffer.template get_access<access::mode::read>(queueHandler);
+    auto outAccessor = outBuffer.template get_access<access::mode::write>(queueHandler);
+
+    // perform operation using parallel_for with nd_range kernel
+    // the required sub-group size guarantees that every row of the work group is exactly one sub-group
+    queueHandler.parallel_for(nd_range{ numItems,workGroup }, [=](nd_item<2> item) [[sycl::reqd_sub_group_size(SUBGROUP_SIZE)]] {
+        // get the sub-group and this work item's position (lane) inside it
+        auto subGroup = item.get_sub_group();
+        size_t lane = subGroup.get_local_linear_id();
+
+        // first row of the micro-tile, shared by all lanes of the sub-group
+        size_t rowBase = item.get_global_id(0) * TM;
+        // first column of the micro-tile, lanes are interleaved so neighbouring lanes read neighbouring columns
+        size_t colBase = (item.get_global_id(1) - lane) * TN + lane;
+
+        // accumulate the micro-tile in private registers
+        AccT sum[TM][TN] = {};
+
+        // edge work items keep running with zeros instead of returning early,
+        // because every lane of the sub-group has to take part in the broadcasts
+        for (size_t k = 0; k < K; k += SUBGROUP_SIZE) {
+            // the last step along K may be shorter than a sub-group, the count is the same for all lanes
+            size_t kCount = std::min<size_t>(SUBGROUP_SIZE, K - k);
+
+            // each lane loads one column of the TM x SUBGROUP_SIZE fragment of in1
+            // values are converted to the accumulator type once, when they are loaded
+            AccT in1Fragment[TM];
+#pragma unroll
+            for (size_t m = 0; m < TM; m++) {
+                in1Fragment[m] = (rowBase + m < M && lane < kCount) ? static_cast<AccT>(in1Accessor[(rowBase + m) * lda + k + lane]) : AccT(0);
+            }
+
+            for (size_t kk = 0; kk < kCount; kk++) {
+                // each lane loads its own TN values from the current row of in2
+                // in2 needs no broadcast: the columns of the lanes are disjoint, so every in2 value the sub-group needs is
+                // loaded by exactly one lane (coalesced, neighbouring lanes read neighbouring columns) and reused TM times
+                // from registers, a broadcast could only hand a lane values it never multiplies
+                AccT in2Fragment[TN];
+#pragma unroll
+                for (size_t n = 0; n < TN; n++) {
+                    size_t colIndex = colBase + n * SUBGROUP_SIZE;
+                    in2Fragment[n] = (colIndex < N) ? static_cast<AccT>(in2Accessor[(k + kk) * ldb + colIndex]) : AccT(0);
+                }
+
+                // share the in1 values held by lane kk with the whole sub-group through registers,
+                // so in1 is only read from global memory once per sub-group
+#pragma unroll
+                for (size_t m = 0; m < TM; m++) {
+                    AccT in1Value = group_broadcast(subGroup, in1Fragment[m], kk);
+#pragma unroll
+                    for (size_t n = 0; n < TN; n++) {
+                        sum[m][n] += in1Value * in2Fragment[n];
+                    }
+                }
+            }
+        }
+
+        // write the micro-tile back to global memory
+#pragma unroll
+        for (size_t m = 0; m < TM; m++) {
+#pragma unroll
+            for (size_t n = 0; n < TN; n++) {
+                size_t colIndex = colBase + n * SUBGROUP_SIZE;
+                if (rowBase + m < M && colIndex < N) {
+                    outAccessor[(rowBase + m) * ldc + colIndex] = sum[m][n];
+                }
+            }
+        }
+        });
+    });
+
+    // allow read access on output buffer
+    outBuffer.template get_access<access::mode::read>();
+
+    // wait until the queue is done executing on the kernel
+    deviceQueue.wait();
+
+    // return the kernel event so the caller can read the profiling results
+    return queueEvent;
+}
+
+template <typename T, typename AccT, size_t TM, size_t TN>
+event mm_subgroup_kernel(queue& deviceQueue, std::vector<T>& in1, std::vector<T>& in2, std::vector<AccT>& out, size_t N, size_t B) {
+    return mm_subgroup_kernel<T, AccT, TM, TN>(deviceQueue, in1.data(), in2.data(), out.data(), make_shape(N, N, N), B);
+}
+
+// the template is defined in this file, so instantiate the element types and micro-tile shapes used by the host program
+#define MM_INSTANTIATE_SUBGROUP_TILE(T, AccT, TM, TN) \
+    template event mm_subgroup_kernel<T, AccT, TM, TN>(queue& deviceQueue, const T* in1, const T* in2, AccT* out, const GemmShape& shape, size_t B); \
+    template event mm_subgroup_kernel<T, AccT, TM, TN>(queue& deviceQueue, std::vector<T>& in1, std::vector<T>& in2, std::vector<AccT>& out, size_t N, size_t B);
+#define MM_INSTANTIATE_SUBGROUP(T, AccT) \
+    MM_INSTANTIATE_SUBGROUP_TILE(T, AccT, 2, 2) \
+    MM_INSTANTIATE_SUBGROUP_TILE(T, AccT, 4, 4) \
+    MM_INSTANTIATE_SUBGROUP_TILE(T, AccT, 8, 4)
+MM_FOR_EACH_TYPE(MM_INSTANTIATE_SUBGROUP)
@@ -0,0 +1,146 @@
+#include <CL/sycl.hpp>
+#include "mm_kernels.hpp"
+using namespace sycl;
+
+template <typename T, typename AccT>
+event mm_tiled_kernel(queue& deviceQueue, const T* in1, const T* in2, AccT* out, const GemmShape& shape, size_t B) {
+    check_shape(shape);
+    size_t M = shape.M;
+    size_t K = shape.K;
+    size_t N = shape.N;
+    size_t lda = shape.lda;
+    size_t ldb = shape.ldb;
+    size_t ldc = shape.ldc;
+
+    // create 2-D SYCL range item for the number of buffer items and work group items
+    // the work group size also sets the size of the BxB tiles held in local memory
+    // the nd_range is rounded up to whole tiles, edge work items are masked in the kernel
+    range<2> numItems{ (M + B - 1) / B * B, (N + B - 1) / B * B };
+    range<2> workGroup{ B,B };
+
+    // create buffers which are used to pass data between host and device
+    // the buffers are 1-D and only span the matrices, so rows are indexed with the leading dimension
+    // use_host_ptr makes the runtime work on the host memory itself (a vector or a memory-mapped file) instead of a copy of it
+    buffer<T, 1> in1Buffer(in1, range<1>{ matrix_span(M, K, lda) }, { property::buffer::use_host_ptr() });
+    buffer<T, 1> in2Buffer(in2, range<1>{ matrix_span(K, N, ldb) }, { property::buffer::use_host_ptr() });
+    buffer<AccT, 1> outBuffer(out, range<1>{ matrix_span(M, N, ldc) }, { property::buffer::use_host_ptr() });
+
+    // submit work to the queue and capture details in event
+    auto queueEvent = deviceQueue.submit([&](handler& queueHandler) {
+
+    // create accessors for device to read/write data in buffers
+    auto in1Accessor = in1Buffer.template get_access<access::mode::read>(queueHandler);
+    auto in2Accessor = in2Buffer.template get_access<access::mode::read>(queueHandler);
+    auto outAccessor = outBuffer.template get_access<access::mode::write>(queueHandler);
+
+    // create local accessors for one BxB tile of each input
+    // local memory is shared by all work items in a work group and is much faster than global memory
+    local_accessor<T, 2> in1Tile(workGroup, queueHandler);
+    local_accessor<T, 2> in2Tile(workGroup, queueHandler);
+
+    // perform operation using parallel_for with nd_range kernel
+    // each work group walks across a row of tiles in in1 and down a column of tiles in in2
+    // every work item loads one element of each tile, so each global value is read once per work group
+    // instead of once per work item
+    queueHandler.parallel_for(nd_range{ numItems,workGroup }, [=](nd_item<2> item) {
+        // get the global row and column index for the output element
+        auto rowIndex = item.get_global_id(0);
+        auto colIndex = item.get_global_id(1);
+        // get the local row and column index inside the tile
+        auto localRow = item.get_local_id(0);
+        auto localCol = item.get_local_id(1);
+
+        // accumulate in a private register and only write to global memory once at the end
+        AccT sum = 0;
+        for (size_t tileIndex = 0; tileIndex < K; tileIndex += B) {
+            // cooperatively copy the current tiles from global to local memory
+            // elements past the edge of the inputs are loaded as zero, so they add nothing to the sum
+            // (edge work items must not return early, the whole work group has to reach the barriers)
+            in1Tile[localRow][localCol] = (rowIndex < M && tileIndex + localCol < K) ? in1Accessor[rowIndex * lda + tileIndex + localCol] : T(0);
+            in2Tile[localRow][localCol] = (tileIndex + localRow < K && colIndex < N) ? in2Accessor[(tileIndex + localRow) * ldb + colIndex] : T(0);
+
+            // wait until the whole work group has finished loading the tiles
+            group_barrier(item.get_group());
+
+            // calculate the partial product from the tiles in local memory
+            for (size_t i = 0; i < B; i++) {
+                sum += static_cast<AccT>(in1Tile[localRow][i]) * static_cast<AccT>(in2Tile[i][localCol]);
+            }
+
+            // wait until the whole work group is done with the tiles before they are overwritten
+            group_barrier(item.get_group());
+        }
+        if (rowIndex < M && colIndex < N) {
+            outAccessor[rowIndex * ldc + colIndex] = sum;
+        }
+        });
+    });
+
+    // allow read access on output buffer
+    outBuffer.template get_access<access::mode::read>();
+
+    // wait until the queue is done executing on the kernel
+    deviceQueue.wait();
+
+    // return the kernel event so the caller can read the profiling results
+    return queueEvent;
+}
+
+template <typename T, typename AccT>
+event mm_tiled_kernel(queue& deviceQueue, std::vector<T>& in1, std::vector<T>& in2, std::vector<AccT>& out, size_t N, size_t B) {
+    return mm_tiled_kernel(deviceQueue, in1.data(), in2.data(), out.data(), make_shape(N, N, N), B);
+}
+
+template <typename T, typename AccT>
+event mm_tiled_usm_kernel(queue& deviceQueue, const T* in1, const T* in2, AccT* out, const GemmShape& shape, size_t B,
+                          const std::vector<event>& dependencies, bool accumulate) {
+    check_shape(shape);
+    size_t M = shape.M;
+    size_t K = shape.K;
+    size_t N = shape.N;
+    size_t lda = shape.lda;
+    size_t ldb = shape.ldb;
+    size_t ldc = shape.ldc;
+
+    // same tiling and edge masking as the buffer version above
+    range<2> numItems{ (M + B - 1) / B * B, (N + B - 1) / B * B };
+    range<2> workGroup{ B,B };
+
+    return deviceQueue.submit([&](handler& queueHandler) {
+        queueHandler.depends_on(dependencies);
+
+        local_accessor<T, 2> in1Tile(workGroup, queueHandler);
+        local_accessor<T, 2> in2Tile(workGroup, queueHandler);
+
+        queueHandler.parallel_for(nd_range{ numItems,workGroup }, [=](nd_item<2> item) {
+            auto rowIndex = item.get_global_id(0);
+            auto colIndex = item.get_global_id(1);
+            auto localRow = item.get_local_id(0);
+            auto localCol = item.get_local_id(1);
+
+            AccT sum = 0;
+            for (size_t tileIndex = 0; tileIndex < K; tileIndex += B) {
+                // USM pointers are 1-D, so the row and column are flattened by hand
+                in1Tile[localRow][localCol] = (rowIndex < M && tileIndex + localCol < K) ? in1[rowIndex * lda + tileIndex + localCol] : T(0);
+                in2Tile[localRow][localCol] = (tileIndex + localRow < K && colIndex < N) ? in2[(tileIndex + localRow) * ldb + colIndex] : T(0);
+                group_barrier(item.get_group());
+
+                for (size_t i = 0; i < B; i++) {
+                    sum += static_cast<AccT>(in1Tile[localRow][i]) * static_cast<AccT>(in2Tile[i][localCol]);
+                }
+                group_barrier(item.get_group());
+            }
+            if (rowIndex < M && colIndex < N) {
+                out[rowIndex * ldc + colIndex] = accumulate ? out[rowIndex * ldc + colIndex] + sum : sum;
+            }
+        });
+    });
+}
+
+// the template is defined in this file, so instantiate the element types used by the host program
+#define MM_INSTANTIATE_TILED(T, AccT) \
+    template event mm_tiled_kernel<T, AccT>(queue& deviceQueue, const T* in1, const T* in2, AccT* out, const GemmShape& shape, size_t B); \
+    template event mm_tiled_kernel<T, AccT>(queue& deviceQueue, std::vector<T>& in1, std::vector<T>& in2, std::vector<AccT>& out, size_t N, size_t B); \
+    template event mm_tiled_usm_kernel<T, AccT>(queue& deviceQueue, const T* in1, const T* in2, AccT* out, const GemmShape& shape, size_t B, \
+                                                const std::vector<event>& dependencies, bool accumulate);
+MM_FOR_EACH_TYPE(MM_INSTANTIATE_TILED)
@@ -0,0 +1,181 @@
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include "mm_tune.hpp"
+
+TuneCache::TuneCache(const std::string& fileName) : fileName(fileName) {
+    std::ifstream file(fileName);
+    std::string line;
+    // each line is: key <tab> kernel <tab> B <tab> GFLOP/s
+    while (std::getline(file, line)) {
+        std::stringstream stream(line);
+        std::string key;
+        std::string kernel;
+        std::string B;
+        std::string gflops;
+        if (std::getline(stream, key, '\t') && std::getline(stream, kernel, '\t') && std::getline(stream, B, '\t')
+            && std::getline(stream, gflops)) {
+            GemmConfig config;
+            config.kernel = kernel;
+            config.B = std::stoul(B);
+            config.gflops = std::stod(gflops);
+            entries[key] = config;
+        }
+    }
+}
+
+bool TuneCache::lookup(const std::string& key, GemmConfig& config) const {
+    auto entry = entries.find(key);
+    if (entry == entries.end()) {
+        return false;
+    }
+    config = entry->second;
+    return true;
+}
+
+void TuneCache::store(const std::string& key, const GemmConfig& config) {
+    entries[key] = config;
+    std::ofstream file(fileName);
+    for (auto& [entryKey, entryConfig] : entries) {
+        file << entryKey << "\t" << entryConfig.kernel << "\t" << entryConfig.B << "\t" << entryConfig.gflops << "\n";
+    }
+}
+
+// round up to the next power of two
+static size_t shape_bucket(size_t size) {
+    size_t bucket = 1;
+    while (bucket < size) {
+        bucket *= 2;
+    }
+    return bucket;
+}
+
+std::string tune_key(const device& offloadDevice, const std::string& typeName, const GemmShape& shape) {
+    return offloadDevice.get_info<info::device::name>() + " | " + offloadDevice.get_info<info::device::driver_version>() + " | "
+           + typeName + " | " + std::to_string(shape_bucket(shape.M)) + "x" + std::to_string(shape_bucket(shape.K)) + "x"
+           + std::to_string(shape_bucket(shape.N));
+}
+
+template <typename T>
+std::vector<GemmConfig> tune_candidates(const device& offloadDevice) {
+    size_t maxWorkGroup = offloadDevice.get_info<info::device::max_work_group_size>();
+    size_t localMemory = offloadDevice.get_info<info::device::local_mem_size>();
+    auto subGroupSizes = offloadDevice.get_info<info::device::sub_group_sizes>();
+    bool hasSubGroupSize = std::find(subGroupSizes.begin(), subGroupSizes.end(), SUBGROUP_SIZE) != subGroupSizes.end();
+
+    std::vector<GemmConfig> candidates;
+    for (size_t B : { 4, 8, 16, 32 }) {
+        // ND-range and tiled kernels use BxB work groups
+        if (B * B <= maxWorkGroup) {
+            candidates.push_back({ "ndrange", B });
+            if (2 * B * B * sizeof(T) <= localMemory) {
+                candidates.push_back({ "tiled", B });
+            }
+        }
+        // sub-group kernels stack B / TM sub-groups in a work group
+        if (hasSubGroupSize) {
+            if (std::max<size_t>(B / 2, 1) * SUBGROUP_SIZE <= maxWorkGroup) {
+                candidates.push_back({ "subgroup2x2", B });
+            }
+            if (std::max<size_t>(B / 4, 1) * SUBGROUP_SIZE <= maxWorkGroup) {
+                candidates.push_back({ "subgroup", B });
+            }
+            if (std::max<size_t>(B / 8, 1) * SUBGROUP_SIZE <= maxWorkGroup) {
+                candidates.push_back({ "subgroup8x4", B });
+            }
+        }
+    }
+    return candidates;
+}
+
+template <typename T, typename AccT>
+event run_gemm(queue& deviceQueue, const GemmConfig& config, const T* in1, const T* in2, AccT* out, const GemmShape& shape) {
+    if (config.kernel == "ndrange") {
+        return mm_ndrange_kernel(deviceQueue, in1, in2, out, shape, config.B);
+    }
+    if (config.kernel == "tiled") {
+        return mm_tiled_kernel(deviceQueue, in1, in2, out, shape, config.B);
+    }
+    if (config.kernel == "subgroup") {
+        return mm_subgroup_kernel<T, AccT, 4, 4>(deviceQueue, in1, in2, out, shape, config.B);
+    }
+    if (config.kernel == "subgroup2x2") {
+        return mm_subgroup_kernel<T, AccT, 2, 2>(deviceQueue, in1, in2, out, shape, config.B);
+    }
+    if (config.kernel == "subgroup8x4") {
+        return mm_subgroup_kernel<T, AccT, 8, 4>(deviceQueue, in1, in2, out, shape, config.B);
+    }
+    throw std::invalid_argument("unknown kernel " + config.kernel);
+}
+
+template <typename T, typename AccT>
+GemmConfig tune_gemm(queue& deviceQueue, const GemmShape& shape) {
+    // tune on packed matrices, the leading dimensions hardly change which variant wins
+    GemmShape packed = make_shape(shape.M, shape.K, shape.N);
+    std::vector<T> in1(packed.M * packed.K);
+    std::vector<T> in2(packed.K * packed.N);
+    std::vector<AccT> out(packed.M * packed.N);
+    for (auto& value : in1) {
+        value = static_cast<T>(static_cast<float>(rand() % 100));
+    }
+    for (auto& value : in2) {
+        value = static_cast<T>(static_cast<float>(rand() % 100));
+    }
+
+    GemmConfig best;
+    for (auto& candidate : tune_candidates<T>(deviceQueue.get_device())) {
+        // the median of a few launches, ranked by kernel time from the event profile
+        std::vector<double> times;
+        try {
+            for (size_t iter = 0; iter < 1 + TUNE_ITERATIONS; iter++) {
+                event kernelEvent = run_gemm(deviceQueue, candidate, in1.data(), in2.data(), out.data(), packed);
+                if (iter == 0) {
+                    continue;
+                }
+                auto kernel_end = kernelEvent.get_profiling_info<info::event_profiling::command_end>();
+                auto kernel_start = kernelEvent.get_profiling_info<info::event_profiling::command_start>();
+                times.push_back((kernel_end - kernel_start) / 1.0e6);
+            }
+        }
+        catch (const std::exception&) {
+            // a configuration the device cannot launch is simply not a candidate
+            continue;
+        }
+        std::sort(times.begin(), times.end());
+        double milliseconds = times[times.size() / 2];
+        candidate.gflops = milliseconds > 0.0 ? 2.0 * packed.M * packed.K * packed.N / (milliseconds * 1.0e6) : 0.0;
+        std::cout << "  " << candidate.kernel << " B = " << candidate.B << ": " << candidate.gflops << " GFLOP/s\n";
+        if (candidate.gflops > best.gflops) {
+            best = candidate;
+        }
+    }
+    if (best.kernel.empty()) {
+        throw std::runtime_error("no kernel configuration could be launched on this device");
+    }
+    return best;
+}
+
+template <typename T, typename AccT>
+GemmConfig tuned_config(queue& deviceQueue, TuneCache& cache, const std::string& typeName, const GemmShape& shape, bool retune) {
+    std::string key = tune_key(deviceQueue.get_device(), typeName, shape);
+    GemmConfig config;
+    if (!retune && cache.lookup(key, config)) {
+        std::cout << "Tuned configuration from cache for " << key << ": " << config.kernel << " B = " << config.B << "\n";
+        return config;
+    }
+
+    std::cout << "Tuning " << key << "...\n";
+    config = tune_gemm<T, AccT>(deviceQueue, shape);
+    std::cout << "Best configuration: " << config.kernel << " B = " << config.B << " (" << config.gflops << " GFLOP/s)\n";
+    cache.store(key, config);
+    return config;
+}
+
+// the templates are defined in this file, so instantiate the element types used by the host program
+#define MM_INSTANTIATE_TUNE(T, AccT) \
+    template std::vector<GemmConfig> tune_candidates<T>(const device& offloadDevice); \
+    template event run_gemm<T, AccT>(queue& deviceQueue, const GemmConfig& config, const T* in1, const T* in2, AccT* out, const GemmShape& shape); \
+    template GemmConfig tune_gemm<T, AccT>(queue& deviceQueue, const GemmShape& shape); \
+    template GemmConfig tuned_config<T, AccT>(queue& deviceQueue, TuneCache& cache, const std::string& typeName, const GemmShape& shape, bool retune);
+MM_FOR_EACH_TYPE(MM_INSTANTIATE_TUNE)
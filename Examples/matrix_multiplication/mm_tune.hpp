@@ -0,0 +1,60 @@
+#pragma once
+#include <CL/sycl.hpp>
+#include <map>
+#include <string>
+#include <vector>
+#include "mm_kernels.hpp"
+using namespace sycl;
+
+// default file for the tuning cache, relative to the working directory
+#define TUNE_CACHE_FILE "mm_tune_cache.txt"
+// timed launches per candidate while tuning, after one untimed launch for JIT compilation
+#define TUNE_ITERATIONS 3
+
+// one kernel variant with its launch parameters
+// kernel is one of ndrange, tiled, subgroup2x2, subgroup (4x4), subgroup8x4, and B is the work group size
+struct GemmConfig {
+    std::string kernel;
+    size_t B = 0;
+    double gflops = 0.0;  // measured while tuning
+};
+
+// winners of earlier tuning runs, stored in a text file with one line per key
+// the key combines the device name, driver version, element type, and shape bucket, so a driver update
+// or a different device never reuses a stale result
+class TuneCache {
+public:
+    // read the cache file if it exists, a missing file is an empty cache
+    explicit TuneCache(const std::string& fileName = TUNE_CACHE_FILE);
+
+    bool lookup(const std::string& key, GemmConfig& config) const;
+
+    // add or replace an entry and write the whole cache back to the file
+    void store(const std::string& key, const GemmConfig& config);
+
+private:
+    std::string fileName;
+    std::map<std::string, GemmConfig> entries;
+};
+
+// build the cache key for a device, element type, and shape
+// every dimension is rounded up to a power of two, so similar shapes share one tuning result
+std::string tune_key(const device& offloadDevice, const std::string& typeName, const GemmShape& shape);
+
+// list the configurations worth trying on a device: work group sizes are limited by max_work_group_size,
+// the tiled kernel's two BxB tiles must fit in local memory, and the sub-group kernels need SUBGROUP_SIZE
+template <typename T>
+std::vector<GemmConfig> tune_candidates(const device& offloadDevice);
+
+// run one configuration on host memory, like the kernels it dispatches to
+template <typename T, typename AccT>
+event run_gemm(queue& deviceQueue, const GemmConfig& config, const T* in1, const T* in2, AccT* out, const GemmShape& shape);
+
+// benchmark every candidate on random inputs of the given shape and return the fastest one
+template <typename T, typename AccT>
+GemmConfig tune_gemm(queue& deviceQueue, const GemmShape& shape);
+
+// return the cached configuration for the device, type, and shape, tuning and caching it first when it is missing
+// retune ignores the cached entry and replaces it
+template <typename T, typename AccT>
+GemmConfig tuned_config(queue& deviceQueue, TuneCache& cache, const std::string& typeName, const GemmShape& shape, bool retune = false);
@@ -0,0 +1,141 @@
+#pragma once
+#include <CL/sycl.hpp>
+#include <functional>
+#include <memory>
+#include <vector>
+
+// record a small DAG of command groups once and replay it many times
+// with the sycl_ext_oneapi_graph extension (DPC++ defines SYCL_EXT_ONEAPI_GRAPH) the commands are recorded into a
+// command_graph and finalized into an executable graph, a replay is then a single submission that the runtime has
+// already scheduled, instead of one submission per command with its dependencies resolved every time
+// without the extension, or when the device does not report aspect::ext_oneapi_graph, the fallback recorder keeps the command groups and
+// their edges and submits them again with depends_on on every replay: the DAG is still built only once,
+// but the per-submit cost stays
+// the commands capture their pointers and sizes when they are recorded, to replay with new inputs, write the new
+// values to the memory the commands read (USM pointers, host memory used by memcpy) before calling replay
+class CommandGraph {
+public:
+	using Node = size_t;
+	using CommandGroup = std::function<void(cl::sycl::handler&)>;
+
+	explicit CommandGraph(cl::sycl::queue& deviceQueue) : deviceQueue(deviceQueue) {}
+
+	// add a command group that runs after the given nodes, the command group must not call depends_on itself
+	Node add(CommandGroup commandGroup, const std::vector<Node>& dependencies = {}) {
+		nodes.push_back({ std::move(commandGroup), dependencies });
+		return nodes.size() - 1;
+	}
+
+	// build the executable graph, or fall back to the recorder, call once after the last add
+	void finalize() {
+#ifdef SYCL_EXT_ONEAPI_GRAPH
+		// ask the device first instead of waiting for the recording to throw
+		if (deviceQueue.get_device().has(cl::sycl::aspect::ext_oneapi_graph)) {
+			try {
+				namespace graph_ext = cl::sycl::ext::oneapi::experimental;
+				graph_ext::command_graph<graph_ext::graph_state::modifiable> recorded(deviceQueue.get_context(), deviceQueue.get_device());
+				{
+					// stops the recording on every path out of this block, so if a command group throws the queue
+					// goes back to executing commands instead of recording them into a destroyed graph
+					RecordingGuard recording(recorded, deviceQueue);
+					submit_nodes();
+				}
+				executable = std::make_unique<graph_ext::command_graph<graph_ext::graph_state::executable>>(recorded.finalize());
+			}
+			catch (const cl::sycl::exception&) {
+				// the graph could not be built after all, replay through the recorder
+				executable.reset();
+			}
+		}
+#endif
+		finalized = true;
+	}
+
+	// submit the whole DAG, the event completes when every command of it has
+	cl::sycl::event replay() {
+		if (!finalized) {
+			finalize();
+		}
+#ifdef SYCL_EXT_ONEAPI_GRAPH
+		if (executable) {
+			return deviceQueue.ext_oneapi_graph(*executable);
+		}
+#endif
+		return submit_nodes();
+	}
+
+	// true when replays run as an executable graph, false when they go through the fallback recorder
+	bool native() const {
+#ifdef SYCL_EXT_ONEAPI_GRAPH
+		return executable != nullptr;
+#else
+		return false;
+#endif
+	}
+
+private:
+	struct Entry {
+		CommandGroup commandGroup;
+		std::vector<Node> dependencies;
+	};
+
+#ifdef SYCL_EXT_ONEAPI_GRAPH
+	// records the commands submitted to the queue into the graph while it is alive
+	class RecordingGuard {
+	public:
+		using Graph = cl::sycl::ext::oneapi::experimental::command_graph<cl::sycl::ext::oneapi::experimental::graph_state::modifiable>;
+
+		RecordingGuard(Graph& graph, cl::sycl::queue& recordedQueue) : graph(graph), recordedQueue(recordedQueue) {
+			graph.begin_recording(recordedQueue);
+		}
+		~RecordingGuard() {
+			graph.end_recording(recordedQueue);
+		}
+		RecordingGuard(const RecordingGuard&) = delete;
+		RecordingGuard& operator=(const RecordingGuard&) = delete;
+
+	private:
+		Graph& graph;
+		cl::sycl::queue& recordedQueue;
+	};
+#endif
+
+	// submit every node in the order it was added (so dependencies come first) with its edges as depends_on,
+	// and return the event of the last node, joined with every other node nothing depends on
+	cl::sycl::event submit_nodes() {
+		std::vector<cl::sycl::event> events;
+		std::vector<bool> hasDependent(nodes.size(), false);
+		for (auto& node : nodes) {
+			std::vector<cl::sycl::event> waitFor;
+			for (Node dependency : node.dependencies) {
+				waitFor.push_back(events[dependency]);
+				hasDependent[dependency] = true;
+			}
+			events.push_back(deviceQueue.submit([&](cl::sycl::handler& queueHandler) {
+				queueHandler.depends_on(waitFor);
+				node.commandGroup(queueHandler);
+			}));
+		}
+
+		std::vector<cl::sycl::event> sinks;
+		for (size_t i = 0; i < nodes.size(); i++) {
+			if (!hasDependent[i]) {
+				sinks.push_back(events[i]);
+			}
+		}
+		if (sinks.size() == 1) {
+			return sinks.front();
+		}
+		// an empty command group that only waits, so one event covers every sink
+		return deviceQueue.submit([&](cl::sycl::handler& queueHandler) {
+			queueHandler.depends_on(sinks);
+		});
+	}
+
+	cl::sycl::queue& deviceQueue;
+	std::vector<Entry> nodes;
+	bool finalized = false;
+#ifdef SYCL_EXT_ONEAPI_GRAPH
+	std::unique_ptr<cl::sycl::ext::oneapi::experimental::command_graph<cl::sycl::ext::oneapi::experimental::graph_state::executable>> executable;
+#endif
+};
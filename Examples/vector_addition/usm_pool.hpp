@@ -0,0 +1,224 @@
+#pragma once
+#include <CL/sycl.hpp>
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// blocks are rounded up to a power of two between these sizes, larger requests go straight to the driver
+#define USM_POOL_MIN_BLOCK 256
+#define USM_POOL_MAX_BLOCK (256 * 1024 * 1024)
+// free blocks kept for reuse, above this they are given back to the driver
+#define USM_POOL_RESERVE (1024 * 1024 * 1024)
+
+struct UsmPoolStats {
+	size_t requests = 0;            // allocate calls
+	size_t hits = 0;                // requests served from a cached block
+	size_t driverAllocations = 0;   // calls to sycl::malloc
+	size_t driverFrees = 0;         // calls to sycl::free
+	size_t bytesInUse = 0;          // handed out and not yet deallocated, in whole blocks
+	size_t peakBytesInUse = 0;
+	size_t bytesCached = 0;         // deallocated and kept for reuse, including blocks still used by pending work
+
+	double hit_rate() const { return requests > 0 ? static_cast<double>(hits) / requests : 0.0; }
+};
+
+// UsmPool caches USM allocations of one kind (device, shared, or host) for one device and context
+// malloc_device and friends go to the driver on every call, which costs far more than the kernel for small requests,
+// the pool keeps freed blocks in free lists by size class and hands them out again
+// deallocate can take the event of the last command that uses the block (stream-ordered reuse):
+// the block is only handed out by allocate once that event has completed, or right away by the allocate overload
+// that returns the event as a dependency for the next user, so nothing has to wait on the host
+class UsmPool {
+public:
+	UsmPool(const cl::sycl::queue& deviceQueue, cl::sycl::usm::alloc kind, size_t reserveBytes = USM_POOL_RESERVE)
+		: poolDevice(deviceQueue.get_device()), poolContext(deviceQueue.get_context()), kind(kind), reserveBytes(reserveBytes) {}
+
+	// every block goes back to the driver, blocks still in use by pending work are waited for first
+	~UsmPool() {
+		for (auto& [blockBytes, blocks] : freeLists) {
+			for (auto& block : blocks) {
+				block.lastUse.wait();
+				cl::sycl::free(block.pointer, poolContext);
+			}
+		}
+		for (auto& [pointer, blockBytes] : liveBlocks) {
+			cl::sycl::free(pointer, poolContext);
+		}
+	}
+
+	// the pool owns its blocks, so it cannot be copied
+	UsmPool(const UsmPool&) = delete;
+	UsmPool& operator=(const UsmPool&) = delete;
+
+	// a block of at least bytes whose previous user has finished
+	void* allocate(size_t bytes) {
+		return allocate(bytes, nullptr);
+	}
+
+	// a block of at least bytes that may still be in use by earlier work: the event of that work is added to
+	// dependencies, and commands using the block have to depend on it (handler::depends_on)
+	void* allocate(size_t bytes, std::vector<cl::sycl::event>& dependencies) {
+		return allocate(bytes, &dependencies);
+	}
+
+	template <typename T>
+	T* allocate(size_t count) {
+		return static_cast<T*>(allocate(count * sizeof(T)));
+	}
+
+	template <typename T>
+	T* allocate(size_t count, std::vector<cl::sycl::event>& dependencies) {
+		return static_cast<T*>(allocate(count * sizeof(T), dependencies));
+	}
+
+	// give a block back, it can be handed out again right away
+	void deallocate(void* pointer) {
+		deallocate(pointer, cl::sycl::event());
+	}
+
+	// give a block back that is still used by the command behind lastUse
+	void deallocate(void* pointer, const cl::sycl::event& lastUse) {
+		std::lock_guard<std::mutex> lock(poolMutex);
+		auto live = liveBlocks.find(pointer);
+		if (live == liveBlocks.end()) {
+			throw std::invalid_argument("the pointer was not allocated by this pool");
+		}
+		size_t blockBytes = live->second;
+		liveBlocks.erase(live);
+		poolStats.bytesInUse -= blockBytes;
+
+		// large blocks and blocks beyond the reserve go back to the driver once their last user is done
+		if (blockBytes > USM_POOL_MAX_BLOCK || poolStats.bytesCached + blockBytes > reserveBytes) {
+			cl::sycl::event(lastUse).wait();
+			cl::sycl::free(pointer, poolContext);
+			poolStats.driverFrees++;
+			return;
+		}
+		freeLists[blockBytes].push_back(Block{ pointer, lastUse });
+		poolStats.bytesCached += blockBytes;
+	}
+
+	// give every cached block back to the driver
+	void trim() {
+		std::lock_guard<std::mutex> lock(poolMutex);
+		release_cached();
+	}
+
+	UsmPoolStats stats() const {
+		std::lock_guard<std::mutex> lock(poolMutex);
+		return poolStats;
+	}
+
+	cl::sycl::usm::alloc alloc_kind() const { return kind; }
+
+private:
+	struct Block {
+		void* pointer;
+		cl::sycl::event lastUse;   // a default event counts as complete
+	};
+
+	static bool complete(const cl::sycl::event& lastUse) {
+		return lastUse.get_info<cl::sycl::info::event::command_execution_status>() == cl::sycl::info::event_command_status::complete;
+	}
+
+	// size class of a request: the next power of two, at least USM_POOL_MIN_BLOCK
+	static size_t block_size(size_t bytes) {
+		size_t blockBytes = USM_POOL_MIN_BLOCK;
+		while (blockBytes < bytes && blockBytes <= USM_POOL_MAX_BLOCK) {
+			blockBytes *= 2;
+		}
+		return blockBytes > USM_POOL_MAX_BLOCK ? bytes : blockBytes;
+	}
+
+	void* allocate(size_t bytes, std::vector<cl::sycl::event>* dependencies) {
+		std::lock_guard<std::mutex> lock(poolMutex);
+		size_t blockBytes = block_size(bytes);
+		poolStats.requests++;
+
+		// newest blocks first, they are the most likely to be in cache and the least likely to be finished,
+		// so without a dependency list look for a finished one
+		auto freeList = freeLists.find(blockBytes);
+		if (freeList != freeLists.end()) {
+			auto& blocks = freeList->second;
+			for (size_t i = blocks.size(); i-- > 0;) {
+				if (dependencies || complete(blocks[i].lastUse)) {
+					Block block = blocks[i];
+					blocks.erase(blocks.begin() + i);
+					if (dependencies) {
+						dependencies->push_back(block.lastUse);
+					}
+					poolStats.hits++;
+					poolStats.bytesCached -= blockBytes;
+					return hand_out(block.pointer, blockBytes);
+				}
+			}
+		}
+
+		// nothing to reuse, ask the driver, and if it is out of memory give the cached blocks back and try again
+		void* pointer = cl::sycl::malloc(blockBytes, poolDevice, poolContext, kind);
+		if (!pointer && poolStats.bytesCached > 0) {
+			release_cached();
+			pointer = cl::sycl::malloc(blockBytes, poolDevice, poolContext, kind);
+		}
+		if (!pointer) {
+			throw std::runtime_error("USM allocation of " + std::to_string(blockBytes) + " bytes failed");
+		}
+		poolStats.driverAllocations++;
+		return hand_out(pointer, blockBytes);
+	}
+
+	void* hand_out(void* pointer, size_t blockBytes) {
+		liveBlocks[pointer] = blockBytes;
+		poolStats.bytesInUse += blockBytes;
+		poolStats.peakBytesInUse = std::max(poolStats.peakBytesInUse, poolStats.bytesInUse);
+		return pointer;
+	}
+
+	void release_cached() {
+		for (auto& [blockBytes, blocks] : freeLists) {
+			for (auto& block : blocks) {
+				block.lastUse.wait();
+				cl::sycl::free(block.pointer, poolContext);
+				poolStats.driverFrees++;
+			}
+			blocks.clear();
+		}
+		poolStats.bytesCached = 0;
+	}
+
+	cl::sycl::device poolDevice;
+	cl::sycl::context poolContext;
+	cl::sycl::usm::alloc kind;
+	size_t reserveBytes;
+
+	mutable std::mutex poolMutex;
+	std::map<size_t, std::vector<Block>> freeLists;    // by block size
+	std::unordered_map<void*, size_t> liveBlocks;      // handed out blocks and their size
+	UsmPoolStats poolStats;
+};
+
+// one pool per device, context, and allocation kind, shared by every queue on them
+// USM allocations belong to a context (and device memory to a device), so queues in the same context can reuse each other's blocks
+inline UsmPool& usm_pool(const cl::sycl::queue& deviceQueue, cl::sycl::usm::alloc kind) {
+	struct Entry {
+		cl::sycl::device poolDevice;
+		cl::sycl::context poolContext;
+		cl::sycl::usm::alloc kind;
+		std::unique_ptr<UsmPool> pool;
+	};
+	static std::mutex registryMutex;
+	static std::vector<Entry> pools;
+	std::lock_guard<std::mutex> lock(registryMutex);
+	for (auto& entry : pools) {
+		if (entry.poolDevice == deviceQueue.get_device() && entry.poolContext == deviceQueue.get_context() && entry.kind == kind) {
+			return *entry.pool;
+		}
+	}
+	pools.push_back(Entry{ deviceQueue.get_device(), deviceQueue.get_context(), kind, std::make_unique<UsmPool>(deviceQueue, kind) });
+	return *pools.back().pool;
+}
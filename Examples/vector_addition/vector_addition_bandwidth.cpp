@@ -0,0 +1,227 @@
+#include <CL/sycl.hpp>
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// default values, each one can be changed from the command line
+#define VECTOR_SIZE (256 * 1024 * 1024)   // 1 GB per vector of int
+#define ELEMENTS_PER_ITEM 4              // vec loads per work item
+#define VECTOR_WIDTH 4                   // ints per vec load, 1, 2, 4, 8 or 16
+#define WORKGROUP_SIZE 256
+#define TIMED_ITERATIONS 10
+
+// add n elements with a grid-stride loop: work item id handles vec number id, id + stride, id + 2 * stride, ...
+// so neighbouring work items touch neighbouring vecs (coalesced) and any n runs with a fixed number of work items
+// the n % W elements after the last whole vec are added one by one with the same stride, so a range with fewer than n % W
+// work items still covers them
+template <int W>
+static void add_strided(const int* in1, const int* in2, int* out, size_t n, size_t id, size_t stride) {
+	using Vec = cl::sycl::vec<int, W>;
+	const Vec* in1Vec = reinterpret_cast<const Vec*>(in1);
+	const Vec* in2Vec = reinterpret_cast<const Vec*>(in2);
+	Vec* outVec = reinterpret_cast<Vec*>(out);
+	size_t numVecs = n / W;
+	for (size_t v = id; v < numVecs; v += stride) {
+		outVec[v] = in1Vec[v] + in2Vec[v];
+	}
+	for (size_t t = numVecs * W + id; t < n; t += stride) {
+		out[t] = in1[t] + in2[t];
+	}
+}
+
+// settings of one run
+struct Launch {
+	size_t vectorSize;
+	size_t elementsPerItem;
+	size_t workGroupSize;
+	size_t iterations;
+};
+
+// work items so every one of them loads about elementsPerItem vecs, rounded up to whole work groups
+static cl::sycl::nd_range<1> launch_range(const Launch& launch, int W) {
+	size_t numVecs = std::max<size_t>(launch.vectorSize / W, 1);
+	size_t items = (numVecs + launch.elementsPerItem - 1) / launch.elementsPerItem;
+	size_t groups = (items + launch.workGroupSize - 1) / launch.workGroupSize;
+	return cl::sycl::nd_range<1>{ cl::sycl::range<1>{ groups * launch.workGroupSize }, cl::sycl::range<1>{ launch.workGroupSize } };
+}
+
+// time of one command from its event profile in milliseconds
+static double event_time(cl::sycl::event& queueEvent) {
+	auto end = queueEvent.get_profiling_info<cl::sycl::info::event_profiling::command_end>();
+	auto start = queueEvent.get_profiling_info<cl::sycl::info::event_profiling::command_start>();
+	return (end - start) / 1.0e6;
+}
+
+// median kernel time of the timed iterations, after one untimed launch
+static double median_time(size_t iterations, const std::function<cl::sycl::event()>& run) {
+	run().wait();
+	std::vector<double> times;
+	for (size_t iter = 0; iter < iterations; iter++) {
+		cl::sycl::event kernelEvent = run();
+		kernelEvent.wait();
+		times.push_back(event_time(kernelEvent));
+	}
+	std::sort(times.begin(), times.end());
+	return times[times.size() / 2];
+}
+
+// buffer and accessor version, the buffers stay alive across iterations so the data is only moved to the device once
+template <int W>
+static double run_buffer(cl::sycl::queue& deviceQueue, const Launch& launch, std::vector<int>& in1, std::vector<int>& in2, std::vector<int>& out) {
+	size_t n = launch.vectorSize;
+	cl::sycl::nd_range<1> ndRange = launch_range(launch, W);
+	double time = 0.0;
+	{
+		cl::sycl::range<1> itemRange{ n };
+		cl::sycl::buffer<int, 1> in1Buffer(in1.data(), itemRange);
+		cl::sycl::buffer<int, 1> in2Buffer(in2.data(), itemRange);
+		cl::sycl::buffer<int, 1> outBuffer(out.data(), itemRange);
+
+		time = median_time(launch.iterations, [&]() {
+			return deviceQueue.submit([&](cl::sycl::handler& queueHandler) {
+				cl::sycl::accessor in1Accessor(in1Buffer, queueHandler, cl::sycl::read_only);
+				cl::sycl::accessor in2Accessor(in2Buffer, queueHandler, cl::sycl::read_only);
+				cl::sycl::accessor outAccessor(outBuffer, queueHandler, cl::sycl::write_only, cl::sycl::no_init);
+				queueHandler.parallel_for(ndRange, [=](cl::sycl::nd_item<1> item) {
+					add_strided<W>(in1Accessor.template get_multi_ptr<cl::sycl::access::decorated::no>().get(),
+						in2Accessor.template get_multi_ptr<cl::sycl::access::decorated::no>().get(),
+						outAccessor.template get_multi_ptr<cl::sycl::access::decorated::no>().get(),
+						n, item.get_global_id(0), item.get_global_range(0));
+				});
+			});
+		});
+	}
+	return time;
+}
+
+// USM version, inputs are copied to device memory once before the timed kernels
+template <int W>
+static double run_usm(cl::sycl::queue& deviceQueue, const Launch& launch, std::vector<int>& in1, std::vector<int>& in2, std::vector<int>& out) {
+	size_t n = launch.vectorSize;
+	cl::sycl::nd_range<1> ndRange = launch_range(launch, W);
+	int* in1Device = cl::sycl::malloc_device<int>(n, deviceQueue);
+	int* in2Device = cl::sycl::malloc_device<int>(n, deviceQueue);
+	int* outDevice = cl::sycl::malloc_device<int>(n, deviceQueue);
+	if (!in1Device || !in2Device || !outDevice) {
+		cl::sycl::free(in1Device, deviceQueue);
+		cl::sycl::free(in2Device, deviceQueue);
+		cl::sycl::free(outDevice, deviceQueue);
+		throw std::runtime_error("not enough device memory for the USM vectors");
+	}
+	deviceQueue.memcpy(in1Device, in1.data(), n * sizeof(int));
+	deviceQueue.memcpy(in2Device, in2.data(), n * sizeof(int));
+	deviceQueue.wait();
+
+	double time = median_time(launch.iterations, [&]() {
+		return deviceQueue.parallel_for(ndRange, [=](cl::sycl::nd_item<1> item) {
+			add_strided<W>(in1Device, in2Device, outDevice, n, item.get_global_id(0), item.get_global_range(0));
+		});
+	});
+
+	deviceQueue.memcpy(out.data(), outDevice, n * sizeof(int)).wait();
+	cl::sycl::free(in1Device, deviceQueue);
+	cl::sycl::free(in2Device, deviceQueue);
+	cl::sycl::free(outDevice, deviceQueue);
+	return time;
+}
+
+// call run<W> with the vector width chosen at run time
+template <typename Runner>
+static double with_width(int W, Runner runner) {
+	switch (W) {
+	case 1: return runner(std::integral_constant<int, 1>{});
+	case 2: return runner(std::integral_constant<int, 2>{});
+	case 4: return runner(std::integral_constant<int, 4>{});
+	case 8: return runner(std::integral_constant<int, 8>{});
+	case 16: return runner(std::integral_constant<int, 16>{});
+	}
+	throw std::invalid_argument("the vector width must be 1, 2, 4, 8 or 16");
+}
+
+int main(int argc, char* argv[]) {
+
+	// optional arguments: vector size, vec loads per work item, vector width, work group size, and the peak memory bandwidth in GB/s
+	Launch launch{ VECTOR_SIZE, ELEMENTS_PER_ITEM, WORKGROUP_SIZE, TIMED_ITERATIONS };
+	int W = VECTOR_WIDTH;
+	double peakBandwidth = 0.0;
+	try {
+		if (argc > 1) launch.vectorSize = std::stoull(argv[1]);
+		if (argc > 2) launch.elementsPerItem = std::stoul(argv[2]);
+		if (argc > 3) W = std::stoi(argv[3]);
+		if (argc > 4) launch.workGroupSize = std::stoul(argv[4]);
+		if (argc > 5) peakBandwidth = std::stod(argv[5]);
+		if (launch.vectorSize == 0 || launch.elementsPerItem == 0 || launch.workGroupSize == 0) {
+			throw std::invalid_argument("sizes must be at least 1");
+		}
+	}
+	catch (const std::exception& e) {
+		std::cout << "Error: " << e.what() << "\n"
+			<< "Usage: " << argv[0] << " [vector size] [vecs per work item] [vector width] [work group size] [peak GB/s]\n";
+		return -1;
+	}
+
+	size_t vectorBytes = launch.vectorSize * sizeof(int);
+	std::cout << "Performing vector addition bandwidth test...\n"
+		<< "Vector size: " << launch.vectorSize << " (" << vectorBytes / 1.0e9 << " GB per vector), vec<int, " << W << ">, "
+		<< launch.elementsPerItem << " vecs per work item, work group size " << launch.workGroupSize << std::endl;
+
+	// create the queue using default device, with profiling so only the kernel itself is timed,
+	// not queue creation, JIT compilation, or transfers
+	cl::sycl::queue deviceQueue(cl::sycl::default_selector{}, cl::sycl::property::queue::enable_profiling());
+	cl::sycl::device offloadDevice = deviceQueue.get_device();
+	std::cout << "Running on " << offloadDevice.get_info<cl::sycl::info::device::name>() << "\n";
+	if (vectorBytes > offloadDevice.get_info<cl::sycl::info::device::max_mem_alloc_size>()) {
+		std::cout << "A vector of " << vectorBytes << " bytes is larger than the largest allocation the device allows ("
+			<< offloadDevice.get_info<cl::sycl::info::device::max_mem_alloc_size>() << " bytes)\n";
+		return -1;
+	}
+
+	// load vectors, wrapped so the sums of multi-GB vectors do not overflow int
+	std::vector<int> in1(launch.vectorSize);
+	std::vector<int> in2(launch.vectorSize);
+	std::vector<int> out(launch.vectorSize);
+	for (size_t i = 0; i < launch.vectorSize; i++) {
+		in1[i] = static_cast<int>(i % 1000000);
+		in2[i] = static_cast<int>(i % 1000000);
+	}
+
+	// every element reads two ints and writes one
+	double bytesMoved = 3.0 * vectorBytes;
+	int status = 0;
+	auto report = [&](const char* name, double time) {
+		double bandwidth = bytesMoved / (time * 1.0e6);
+		std::cout << name << ": " << time << " ms, " << bandwidth << " GB/s";
+		if (peakBandwidth > 0.0) {
+			std::cout << " (" << 100.0 * bandwidth / peakBandwidth << " % of " << peakBandwidth << " GB/s peak)";
+		}
+		std::cout << "\n";
+		for (size_t i = 0; i < launch.vectorSize; i++) {
+			if (out[i] != in1[i] + in2[i]) {
+				std::cout << "Incorrect device values.\n" << out[i] << " != " << in1[i] + in2[i] << "\n";
+				status = -1;
+				break;
+			}
+		}
+		std::fill(out.begin(), out.end(), 0);
+	};
+
+	try {
+		report("Buffer/accessor", with_width(W, [&](auto width) { return run_buffer<decltype(width)::value>(deviceQueue, launch, in1, in2, out); }));
+		report("USM            ", with_width(W, [&](auto width) { return run_usm<decltype(width)::value>(deviceQueue, launch, in1, in2, out); }));
+	}
+	catch (const std::exception& e) {
+		std::cout << "Error: " << e.what() << "\n";
+		return -1;
+	}
+	if (peakBandwidth == 0.0) {
+		std::cout << "SYCL has no portable query for the memory bandwidth, pass the device's peak GB/s as the last argument to compare against it\n";
+	}
+
+	if (status == 0) {
+		std::cout << "Host and device values match\n";
+	}
+	return status;
+}
@@ -0,0 +1,175 @@
+#include <CL/sycl.hpp>
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <string>
+#include <vector>
+#include "command_graph.hpp"
+
+// default values, each one can be changed from the command line
+#define VECTOR_SIZE 1024
+#define ITERATIONS 1000
+
+// per-iteration latencies in microseconds
+struct Latency {
+	double median;
+	double mean;
+};
+
+// run one iteration after the other, every one gets new inputs from prepare, is timed from the first submit to the
+// end of its wait, and is checked by validate afterwards, the first iteration is not timed
+static Latency run_loop(size_t iterations, const std::function<void(size_t)>& prepare, const std::function<void()>& iteration,
+		const std::function<bool(size_t)>& validate, bool& passed) {
+	std::vector<double> times;
+	for (size_t iter = 0; iter <= iterations; iter++) {
+		prepare(iter);
+		auto start = std::chrono::steady_clock::now();
+		iteration();
+		auto end = std::chrono::steady_clock::now();
+		if (iter > 0) {
+			times.push_back(std::chrono::duration<double, std::micro>(end - start).count());
+		}
+		if (passed && !validate(iter)) {
+			passed = false;
+		}
+	}
+	double total = 0.0;
+	for (double time : times) {
+		total += time;
+	}
+	std::sort(times.begin(), times.end());
+	return { times[times.size() / 2], total / times.size() };
+}
+
+int main(int argc, char* argv[]) {
+
+	// optional arguments: vector size and iterations
+	size_t vectorSize = argc > 1 ? std::stoul(argv[1]) : VECTOR_SIZE;
+	size_t iterations = argc > 2 ? std::stoul(argv[2]) : ITERATIONS;
+	if (vectorSize == 0 || iterations == 0) {
+		std::cout << "Usage: " << argv[0] << " [vector size] [iterations], both at least 1\n";
+		return -1;
+	}
+
+	std::cout << "Comparing eager submission and graph replay...\n"
+		<< "Vector size: " << vectorSize << ", " << iterations << " iterations" << std::endl;
+
+	// create the queue using default device
+	cl::sycl::queue deviceQueue(cl::sycl::default_selector{});
+	std::cout << "Running on " << deviceQueue.get_device().get_info<cl::sycl::info::device::name>() << "\n\n";
+
+	// pinned host memory for the inputs and the result, the graph copies from and to these same pointers every replay
+	size_t bytes = vectorSize * sizeof(int);
+	int* in1Host = cl::sycl::malloc_host<int>(vectorSize, deviceQueue);
+	int* in2Host = cl::sycl::malloc_host<int>(vectorSize, deviceQueue);
+	int* outHost = cl::sycl::malloc_host<int>(vectorSize, deviceQueue);
+	int* in1Device = cl::sycl::malloc_device<int>(vectorSize, deviceQueue);
+	int* in2Device = cl::sycl::malloc_device<int>(vectorSize, deviceQueue);
+	int* outDevice = cl::sycl::malloc_device<int>(vectorSize, deviceQueue);
+
+	// every iteration adds different vectors, so a replay that reused old data would fail validation
+	auto prepare = [&](size_t iter) {
+		for (size_t i = 0; i < vectorSize; i++) {
+			in1Host[i] = static_cast<int>(i + iter);
+			in2Host[i] = static_cast<int>(2 * i);
+			outHost[i] = 0;
+		}
+	};
+	auto validate = [&](size_t iter) {
+		for (size_t i = 0; i < vectorSize; i++) {
+			if (outHost[i] != static_cast<int>(3 * i + iter)) {
+				std::cout << "Incorrect device values in iteration " << iter << ".\n" << outHost[i] << " != " << 3 * i + iter << "\n";
+				return false;
+			}
+		}
+		return true;
+	};
+	bool passed = true;
+
+	// the DAG of the vector addition examples: two uploads, the addition after both, the download after the addition
+	auto upload1 = [=](cl::sycl::handler& queueHandler) { queueHandler.memcpy(in1Device, in1Host, bytes); };
+	auto upload2 = [=](cl::sycl::handler& queueHandler) { queueHandler.memcpy(in2Device, in2Host, bytes); };
+	auto add = [=](cl::sycl::handler& queueHandler) {
+		queueHandler.parallel_for(cl::sycl::range<1>{ vectorSize }, [=](cl::sycl::id<1> i) {
+			outDevice[i] = in1Device[i] + in2Device[i];
+		});
+	};
+	auto download = [=](cl::sycl::handler& queueHandler) { queueHandler.memcpy(outHost, outDevice, bytes); };
+
+	// eager: the four commands are submitted every iteration, their dependencies through events
+	Latency eager = run_loop(iterations, prepare, [&]() {
+		auto upload1Event = deviceQueue.submit(upload1);
+		auto upload2Event = deviceQueue.submit(upload2);
+		auto addEvent = deviceQueue.submit([&](cl::sycl::handler& queueHandler) {
+			queueHandler.depends_on({ upload1Event, upload2Event });
+			add(queueHandler);
+		});
+		deviceQueue.submit([&](cl::sycl::handler& queueHandler) {
+			queueHandler.depends_on(addEvent);
+			download(queueHandler);
+		}).wait();
+	}, validate, passed);
+
+	// eager with buffers: the same DAG with the dependencies found from the accessors, as in vector_addition_with_dependency
+	Latency eagerBuffer{ 0.0, 0.0 };
+	{
+		cl::sycl::buffer<int, 1> in1Buffer(in1Host, cl::sycl::range<1>{ vectorSize });
+		cl::sycl::buffer<int, 1> in2Buffer(in2Host, cl::sycl::range<1>{ vectorSize });
+		cl::sycl::buffer<int, 1> outBuffer(outHost, cl::sycl::range<1>{ vectorSize });
+		eagerBuffer = run_loop(iterations, [&](size_t iter) {
+			// the buffers own the host memory while they exist, so the new inputs are written through host accessors
+			cl::sycl::host_accessor in1Accessor(in1Buffer, cl::sycl::write_only);
+			cl::sycl::host_accessor in2Accessor(in2Buffer, cl::sycl::write_only);
+			for (size_t i = 0; i < vectorSize; i++) {
+				in1Accessor[i] = static_cast<int>(i + iter);
+				in2Accessor[i] = static_cast<int>(2 * i);
+			}
+		}, [&]() {
+			deviceQueue.submit([&](cl::sycl::handler& queueHandler) {
+				cl::sycl::accessor in1Accessor(in1Buffer, queueHandler, cl::sycl::read_only);
+				cl::sycl::accessor in2Accessor(in2Buffer, queueHandler, cl::sycl::read_only);
+				cl::sycl::accessor outAccessor(outBuffer, queueHandler, cl::sycl::write_only, cl::sycl::no_init);
+				queueHandler.parallel_for(cl::sycl::range<1>{ vectorSize }, [=](cl::sycl::id<1> i) {
+					outAccessor[i] = in1Accessor[i] + in2Accessor[i];
+				});
+			});
+			// reading the result waits for the kernel and copies it back
+			cl::sycl::host_accessor outAccessor(outBuffer, cl::sycl::read_only);
+		}, [&](size_t iter) {
+			cl::sycl::host_accessor outAccessor(outBuffer, cl::sycl::read_only);
+			for (size_t i = 0; i < vectorSize; i++) {
+				if (outAccessor[i] != static_cast<int>(3 * i + iter)) {
+					std::cout << "Incorrect device values with buffers in iteration " << iter << ".\n";
+					return false;
+				}
+			}
+			return true;
+		}, passed);
+	}
+
+	// replay: the DAG is recorded once, every iteration only writes new inputs and replays it
+	CommandGraph graph(deviceQueue);
+	auto upload1Node = graph.add(upload1);
+	auto upload2Node = graph.add(upload2);
+	auto addNode = graph.add(add, { upload1Node, upload2Node });
+	graph.add(download, { addNode });
+	graph.finalize();
+	Latency replay = run_loop(iterations, prepare, [&]() { graph.replay().wait(); }, validate, passed);
+
+	std::cout << "Per-iteration latency in microseconds (median, mean)\n"
+		<< "  eager USM    : " << eager.median << ", " << eager.mean << "\n"
+		<< "  eager buffers: " << eagerBuffer.median << ", " << eagerBuffer.mean << "\n"
+		<< "  graph replay : " << replay.median << ", " << replay.mean
+		<< (graph.native() ? " (sycl_ext_oneapi_graph)" : " (fallback recorder, the graph extension is not available)") << "\n"
+		<< "  speedup of replay over eager USM: " << eager.median / replay.median << "x\n";
+
+	cl::sycl::free(in1Device, deviceQueue);
+	cl::sycl::free(in2Device, deviceQueue);
+	cl::sycl::free(outDevice, deviceQueue);
+	cl::sycl::free(in1Host, deviceQueue);
+	cl::sycl::free(in2Host, deviceQueue);
+	cl::sycl::free(outHost, deviceQueue);
+
+	std::cout << (passed ? "Host and device values match\n" : "Validation failed\n");
+	return passed ? 0 : -1;
+}
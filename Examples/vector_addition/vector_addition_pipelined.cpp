@@ -0,0 +1,224 @@
+#include <CL/sycl.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "../common/sycl_trace.hpp"
+
+// default values, each one can be changed from the command line
+#define VECTOR_SIZE (64 * 1024 * 1024)
+#define CHUNK_SIZE (4 * 1024 * 1024)
+#define CHUNKS_IN_FLIGHT 3
+
+// time of one command from its event profile in milliseconds
+static double event_time(cl::sycl::event& queueEvent) {
+	auto end = queueEvent.get_profiling_info<cl::sycl::info::event_profiling::command_end>();
+	auto start = queueEvent.get_profiling_info<cl::sycl::info::event_profiling::command_start>();
+	return (end - start) / 1.0e6;
+}
+
+// device time of a list of commands: the sum of their own times, and the span from the first start to the last end
+static void add_event_times(std::vector<cl::sycl::event>& events, double& total, uint64_t& first, uint64_t& last) {
+	for (auto& queueEvent : events) {
+		total += event_time(queueEvent);
+		first = std::min<uint64_t>(first, queueEvent.get_profiling_info<cl::sycl::info::event_profiling::command_start>());
+		last = std::max<uint64_t>(last, queueEvent.get_profiling_info<cl::sycl::info::event_profiling::command_end>());
+	}
+}
+
+// print where the time went, and how much of the transfer time ran while something else was running
+static void report(const char* name, double wallTime, size_t vectorSize,
+		std::vector<cl::sycl::event>& uploads, std::vector<cl::sycl::event>& kernels, std::vector<cl::sycl::event>& downloads) {
+	double uploadTime = 0.0;
+	double computeTime = 0.0;
+	double downloadTime = 0.0;
+	uint64_t first = UINT64_MAX;
+	uint64_t last = 0;
+	add_event_times(uploads, uploadTime, first, last);
+	add_event_times(kernels, computeTime, first, last);
+	add_event_times(downloads, downloadTime, first, last);
+	double spanTime = (last - first) / 1.0e6;
+
+	// serialized, the span is the sum of all commands, every millisecond below that was spent on two things at once
+	double transferTime = uploadTime + downloadTime;
+	double hidden = transferTime > 0.0 ? std::min(std::max((uploadTime + computeTime + downloadTime - spanTime) / transferTime, 0.0), 1.0) : 0.0;
+
+	// two inputs in and one output out
+	double bandwidth = 3.0 * vectorSize * sizeof(int) / (wallTime * 1.0e6);
+
+	std::cout << name << ":\n"
+		<< "  total time          : " << wallTime << " ms (" << bandwidth << " GB/s end to end)\n"
+		<< "  upload / compute / download : " << uploadTime << " / " << computeTime << " / " << downloadTime << " ms\n"
+		<< "  device span         : " << spanTime << " ms\n"
+		<< "  transfer overlapped : " << 100.0 * hidden << " %\n";
+}
+
+int main(int argc, char* argv[]) {
+
+	// optional arguments: vector size, chunk size, number of chunks in flight, and a file for the Chrome trace
+	size_t vectorSize = argc > 1 ? std::stoul(argv[1]) : VECTOR_SIZE;
+	size_t chunkSize = argc > 2 ? std::stoul(argv[2]) : CHUNK_SIZE;
+	size_t inFlight = argc > 3 ? std::stoul(argv[3]) : CHUNKS_IN_FLIGHT;
+	std::string traceFile = argc > 4 ? argv[4] : "";
+	if (vectorSize == 0 || chunkSize == 0 || inFlight == 0) {
+		std::cout << "Usage: " << argv[0] << " [vector size] [chunk size] [chunks in flight] [trace file], all sizes at least 1\n";
+		return -1;
+	}
+	chunkSize = std::min(chunkSize, vectorSize);
+	size_t numChunks = (vectorSize + chunkSize - 1) / chunkSize;
+
+	std::cout << "Performing pipelined vector addition...\n"
+		<< "Vector size: " << vectorSize << ", chunk size: " << chunkSize << " (" << numChunks << " chunks), chunks in flight: " << inFlight << std::endl;
+
+	// create the queue using default device, with profiling so the time of every copy and kernel can be read
+	// the queue is out of order, so commands without dependencies between them may run at the same time
+	cl::sycl::queue deviceQueue(cl::sycl::default_selector{}, cl::sycl::property::queue::enable_profiling());
+	std::cout << "Running on " << deviceQueue.get_device().get_info<cl::sycl::info::device::name>() << "\n";
+
+	// host vectors are pinned (malloc_host), pageable memory would make every copy a blocking staged copy
+	int* in1Host = cl::sycl::malloc_host<int>(vectorSize, deviceQueue);
+	int* in2Host = cl::sycl::malloc_host<int>(vectorSize, deviceQueue);
+	int* outHost = cl::sycl::malloc_host<int>(vectorSize, deviceQueue);
+
+	// load vectors
+	for (size_t i = 0; i < vectorSize; i++) {
+		in1Host[i] = i;
+		in2Host[i] = i;
+		outHost[i] = 0;
+	}
+
+	double serialTime = 0.0;
+	double pipelineTime = 0.0;
+
+	// every command and wait goes through the tracer, so both versions end up in one timeline
+	Tracer tracer;
+
+	//------------------------ SERIALIZED BASELINE ----------------------------------------------
+
+	// same steps as vector_addition_usm: copy both inputs, wait, compute, copy back
+	{
+		auto in1Device = cl::sycl::malloc_device<int>(vectorSize, deviceQueue);
+		auto in2Device = cl::sycl::malloc_device<int>(vectorSize, deviceQueue);
+		auto outDevice = cl::sycl::malloc_device<int>(vectorSize, deviceQueue);
+
+		auto serialStart = std::chrono::high_resolution_clock::now();
+		std::vector<cl::sycl::event> uploads;
+		uploads.push_back(tracer.record(deviceQueue, "serialized upload", [&]() { return deviceQueue.memcpy(in1Device, in1Host, vectorSize * sizeof(int)); }));
+		uploads.push_back(tracer.record(deviceQueue, "serialized upload", [&]() { return deviceQueue.memcpy(in2Device, in2Host, vectorSize * sizeof(int)); }));
+		tracer.wait(deviceQueue, "serialized upload");
+
+		std::vector<cl::sycl::event> kernels;
+		kernels.push_back(tracer.record(deviceQueue, "serialized add", [&]() {
+			return deviceQueue.parallel_for(cl::sycl::range<1>{ vectorSize }, [=](cl::sycl::id<1> i) {
+				outDevice[i] = in1Device[i] + in2Device[i];
+			});
+		}));
+		tracer.wait(deviceQueue, "serialized add");
+
+		std::vector<cl::sycl::event> downloads;
+		downloads.push_back(tracer.record(deviceQueue, "serialized download", [&]() { return deviceQueue.memcpy(outHost, outDevice, vectorSize * sizeof(int)); }));
+		tracer.wait(deviceQueue, "serialized download");
+		auto serialStop = std::chrono::high_resolution_clock::now();
+
+		serialTime = std::chrono::duration<double, std::milli>(serialStop - serialStart).count();
+		report("Serialized", serialTime, vectorSize, uploads, kernels, downloads);
+
+		cl::sycl::free(in1Device, deviceQueue);
+		cl::sycl::free(in2Device, deviceQueue);
+		cl::sycl::free(outDevice, deviceQueue);
+	}
+
+	//------------------------ PIPELINED ----------------------------------------------
+
+	// reset the output so the pipelined result is checked on its own
+	std::fill(outHost, outHost + vectorSize, 0);
+
+	// device memory for inFlight chunks only, chunk c uses slot c % inFlight
+	// while chunk c computes, chunk c + 1 can upload into the next slot and chunk c - 1 download from the previous one
+	{
+		size_t slots = std::min(inFlight, numChunks);
+		auto in1Device = cl::sycl::malloc_device<int>(slots * chunkSize, deviceQueue);
+		auto in2Device = cl::sycl::malloc_device<int>(slots * chunkSize, deviceQueue);
+		auto outDevice = cl::sycl::malloc_device<int>(slots * chunkSize, deviceQueue);
+
+		std::vector<cl::sycl::event> uploads;
+		std::vector<cl::sycl::event> kernels;
+		std::vector<cl::sycl::event> downloads;
+
+		auto pipelineStart = std::chrono::high_resolution_clock::now();
+		for (size_t chunk = 0; chunk < numChunks; chunk++) {
+			size_t offset = chunk * chunkSize;
+			size_t count = std::min(chunkSize, vectorSize - offset);
+			int* in1Slot = in1Device + (chunk % slots) * chunkSize;
+			int* in2Slot = in2Device + (chunk % slots) * chunkSize;
+			int* outSlot = outDevice + (chunk % slots) * chunkSize;
+
+			// a slot can be overwritten once the chunk that used it before has been copied back
+			std::vector<cl::sycl::event> slotFree;
+			if (chunk >= slots) {
+				slotFree.push_back(downloads[chunk - slots]);
+			}
+
+			// nothing here waits on the host, the chain of events orders the commands of one chunk
+			auto in1Event = tracer.submit(deviceQueue, "pipelined upload", [&](cl::sycl::handler& queueHandler) {
+				queueHandler.depends_on(slotFree);
+				queueHandler.memcpy(in1Slot, in1Host + offset, count * sizeof(int));
+			});
+			auto in2Event = tracer.submit(deviceQueue, "pipelined upload", [&](cl::sycl::handler& queueHandler) {
+				queueHandler.depends_on(slotFree);
+				queueHandler.memcpy(in2Slot, in2Host + offset, count * sizeof(int));
+			});
+			auto evaluationEvent = tracer.submit(deviceQueue, "pipelined add", [&](cl::sycl::handler& queueHandler) {
+				queueHandler.depends_on({ in1Event, in2Event });
+				queueHandler.parallel_for(cl::sycl::range<1>{ count }, [=](cl::sycl::id<1> i) {
+					outSlot[i] = in1Slot[i] + in2Slot[i];
+				});
+			});
+			auto outEvent = tracer.submit(deviceQueue, "pipelined download", [&](cl::sycl::handler& queueHandler) {
+				queueHandler.depends_on(evaluationEvent);
+				queueHandler.memcpy(outHost + offset, outSlot, count * sizeof(int));
+			});
+
+			uploads.push_back(in1Event);
+			uploads.push_back(in2Event);
+			kernels.push_back(evaluationEvent);
+			downloads.push_back(outEvent);
+		}
+		tracer.wait(deviceQueue, "pipelined");
+		auto pipelineStop = std::chrono::high_resolution_clock::now();
+
+		pipelineTime = std::chrono::duration<double, std::milli>(pipelineStop - pipelineStart).count();
+		report("Pipelined", pipelineTime, vectorSize, uploads, kernels, downloads);
+
+		cl::sycl::free(in1Device, deviceQueue);
+		cl::sycl::free(in2Device, deviceQueue);
+		cl::sycl::free(outDevice, deviceQueue);
+	}
+
+	std::cout << "Pipelined speedup over serialized: " << serialTime / pipelineTime << "x\n\n";
+	tracer.print_summary();
+	if (!traceFile.empty()) {
+		std::cout << (tracer.write_chrome_trace(traceFile) ? "Trace written to " : "Could not write the trace to ") << traceFile << "\n";
+	}
+
+	// validate
+	int status = 0;
+	for (size_t i = 0; i < vectorSize; i++) {
+		if (outHost[i] != in1Host[i] + in2Host[i]) {
+			std::cout << "Incorrect device values.\n"
+				<< outHost[i] << " != " << in1Host[i] + in2Host[i] << "\n";
+			status = -1;
+			break;
+		}
+	}
+	if (status == 0) {
+		std::cout << "Host and device values match\n";
+	}
+
+	cl::sycl::free(in1Host, deviceQueue);
+	cl::sycl::free(in2Host, deviceQueue);
+	cl::sycl::free(outHost, deviceQueue);
+
+	return status;
+}
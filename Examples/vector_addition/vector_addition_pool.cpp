@@ -0,0 +1,160 @@
+#include <CL/sycl.hpp>
+#include <chrono>
+#include <string>
+#include <vector>
+#include "usm_pool.hpp"
+
+// default values, each one can be changed from the command line
+#define ITERATIONS 1000       // allocate/free pairs timed per size
+#define REQUESTS 200          // vector additions in the service loop
+#define VECTOR_SIZE (1024 * 1024)
+
+// average time of one allocate/free pair in microseconds
+template <typename Allocate, typename Free>
+static double pair_time(size_t iterations, Allocate allocate, Free release) {
+	auto start = std::chrono::steady_clock::now();
+	for (size_t iter = 0; iter < iterations; iter++) {
+		release(allocate());
+	}
+	auto end = std::chrono::steady_clock::now();
+	return std::chrono::duration<double, std::micro>(end - start).count() / iterations;
+}
+
+static const char* kind_name(cl::sycl::usm::alloc kind) {
+	switch (kind) {
+	case cl::sycl::usm::alloc::device: return "malloc_device";
+	case cl::sycl::usm::alloc::shared: return "malloc_shared";
+	case cl::sycl::usm::alloc::host: return "malloc_host  ";
+	default: return "unknown      ";
+	}
+}
+
+static void print_stats(const UsmPoolStats& stats) {
+	std::cout << "  requests " << stats.requests << ", hit rate " << 100.0 * stats.hit_rate() << " %, "
+		<< stats.driverAllocations << " driver allocations, " << stats.driverFrees << " driver frees, peak "
+		<< stats.peakBytesInUse / 1.0e6 << " MB in use, " << stats.bytesCached / 1.0e6 << " MB cached\n";
+}
+
+int main(int argc, char* argv[]) {
+
+	// optional arguments: allocate/free pairs per size, vector additions, and the largest vector size
+	size_t iterations = argc > 1 ? std::stoul(argv[1]) : ITERATIONS;
+	size_t requests = argc > 2 ? std::stoul(argv[2]) : REQUESTS;
+	size_t vectorSize = argc > 3 ? std::stoul(argv[3]) : VECTOR_SIZE;
+	if (iterations == 0 || requests == 0 || vectorSize < 8) {
+		std::cout << "Usage: " << argv[0] << " [allocations per size] [requests] [vector size], the vector size at least 8\n";
+		return -1;
+	}
+
+	std::cout << "Comparing pooled and raw USM allocations...\n";
+
+	// create the queue using default device
+	cl::sycl::queue deviceQueue(cl::sycl::default_selector{});
+	std::cout << "Running on " << deviceQueue.get_device().get_info<cl::sycl::info::device::name>() << "\n\n";
+
+	// allocation latency: the pool is asked once before timing, so every timed request is a hit
+	std::cout << "Average allocate + free time in microseconds\n";
+	std::vector<size_t> sizes = { 1024, 64 * 1024, 1024 * 1024, 16 * 1024 * 1024 };
+	for (auto kind : { cl::sycl::usm::alloc::device, cl::sycl::usm::alloc::shared, cl::sycl::usm::alloc::host }) {
+		UsmPool& pool = usm_pool(deviceQueue, kind);
+		for (size_t bytes : sizes) {
+			double rawTime = pair_time(iterations,
+				[&]() { return cl::sycl::malloc(bytes, deviceQueue.get_device(), deviceQueue.get_context(), kind); },
+				[&](void* pointer) { cl::sycl::free(pointer, deviceQueue); });
+			pool.deallocate(pool.allocate(bytes));
+			double pooledTime = pair_time(iterations,
+				[&]() { return pool.allocate(bytes); },
+				[&](void* pointer) { pool.deallocate(pointer); });
+			std::cout << "  " << kind_name(kind) << " " << bytes / 1024 << " KB: raw " << rawTime << ", pooled " << pooledTime
+				<< ", speedup " << rawTime / pooledTime << "x\n";
+		}
+		pool.trim();
+	}
+	std::cout << "\n";
+
+	// load vectors
+	std::vector<int> in1Host(vectorSize);
+	std::vector<int> in2Host(vectorSize);
+	std::vector<int> outHost(vectorSize);
+	for (size_t i = 0; i < vectorSize; i++) {
+		in1Host.at(i) = i;
+		in2Host.at(i) = i;
+	}
+
+	// a service loop: every request adds two vectors of its own size (vectorSize, vectorSize / 2, ... / 8)
+	// in fresh device memory, the way code that allocates per call does
+	bool passed = true;
+	auto check = [&](size_t n) {
+		for (size_t i = 0; i < n; i++) {
+			if (outHost[i] != in1Host[i] + in2Host[i]) {
+				std::cout << "Incorrect device values.\n" << outHost[i] << " != " << in1Host[i] + in2Host[i] << "\n";
+				passed = false;
+				return;
+			}
+		}
+	};
+	auto add = [&](int* in1Device, int* in2Device, int* outDevice, size_t n, const std::vector<cl::sycl::event>& dependencies) {
+		auto upload1 = deviceQueue.submit([&](cl::sycl::handler& queueHandler) {
+			queueHandler.depends_on(dependencies);
+			queueHandler.memcpy(in1Device, in1Host.data(), n * sizeof(int));
+		});
+		auto upload2 = deviceQueue.submit([&](cl::sycl::handler& queueHandler) {
+			queueHandler.depends_on(dependencies);
+			queueHandler.memcpy(in2Device, in2Host.data(), n * sizeof(int));
+		});
+		auto evaluationEvent = deviceQueue.submit([&](cl::sycl::handler& queueHandler) {
+			queueHandler.depends_on({ upload1, upload2 });
+			queueHandler.parallel_for(cl::sycl::range<1>{ n }, [=](cl::sycl::id<1> i) {
+				outDevice[i] = in1Device[i] + in2Device[i];
+			});
+		});
+		return deviceQueue.submit([&](cl::sycl::handler& queueHandler) {
+			queueHandler.depends_on(evaluationEvent);
+			queueHandler.memcpy(outHost.data(), outDevice, n * sizeof(int));
+		});
+	};
+
+	auto start = std::chrono::steady_clock::now();
+	for (size_t request = 0; request < requests; request++) {
+		size_t n = vectorSize >> (request % 4);
+		auto in1Device = cl::sycl::malloc_device<int>(n, deviceQueue);
+		auto in2Device = cl::sycl::malloc_device<int>(n, deviceQueue);
+		auto outDevice = cl::sycl::malloc_device<int>(n, deviceQueue);
+		add(in1Device, in2Device, outDevice, n, {}).wait();
+		cl::sycl::free(in1Device, deviceQueue);
+		cl::sycl::free(in2Device, deviceQueue);
+		cl::sycl::free(outDevice, deviceQueue);
+		check(n);
+	}
+	auto end = std::chrono::steady_clock::now();
+	double rawTime = std::chrono::duration<double, std::milli>(end - start).count();
+
+	// the same loop on a pool of its own, so its statistics only count this loop
+	// blocks are given back with the event of the download that last reads them,
+	// and taken with their pending events as dependencies, so a block can be reused without a wait in between
+	UsmPool pool(deviceQueue, cl::sycl::usm::alloc::device);
+	start = std::chrono::steady_clock::now();
+	for (size_t request = 0; request < requests; request++) {
+		size_t n = vectorSize >> (request % 4);
+		std::vector<cl::sycl::event> dependencies;
+		auto in1Device = pool.allocate<int>(n, dependencies);
+		auto in2Device = pool.allocate<int>(n, dependencies);
+		auto outDevice = pool.allocate<int>(n, dependencies);
+		auto downloadEvent = add(in1Device, in2Device, outDevice, n, dependencies);
+		pool.deallocate(in1Device, downloadEvent);
+		pool.deallocate(in2Device, downloadEvent);
+		pool.deallocate(outDevice, downloadEvent);
+		downloadEvent.wait();
+		check(n);
+	}
+	end = std::chrono::steady_clock::now();
+	double pooledTime = std::chrono::duration<double, std::milli>(end - start).count();
+
+	std::cout << requests << " vector additions with per-request allocations\n"
+		<< "  raw malloc_device: " << rawTime << " ms\n"
+		<< "  pooled           : " << pooledTime << " ms, speedup " << rawTime / pooledTime << "x\n";
+	print_stats(pool.stats());
+
+	std::cout << (passed ? "Host and device values match\n" : "Validation failed\n");
+	return passed ? 0 : -1;
+}
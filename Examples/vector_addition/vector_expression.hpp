@@ -0,0 +1,147 @@
+#pragma once
+#include <CL/sycl.hpp>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// expression templates for element-wise operations on device vectors
+// writing an expression such as max(a * x + y, 0) does not compute anything, it builds a small tree of structs
+// (one per operation) holding the device pointers and the scalars
+// assigning the tree to a DeviceVector launches a single parallel_for whose kernel evaluates the whole tree for
+// its element, so a chain of operations is fused into one kernel at compile time: every input is read once and
+// the output is written once, with no temporary vectors between the steps
+// all vectors in one expression must have the same size, it is not checked
+
+// leaf: element i of a vector in device memory
+template <typename T>
+struct VectorTerm {
+	using value_type = T;
+	const T* data;
+	T operator[](size_t i) const { return data[i]; }
+};
+
+// leaf: the same number for every element
+template <typename T>
+struct ScalarTerm {
+	using value_type = T;
+	T value;
+	T operator[](size_t) const { return value; }
+};
+
+// node: an operation applied element by element to two sub-expressions
+template <typename Op, typename L, typename R>
+struct BinaryTerm {
+	using value_type = decltype(Op::apply(std::declval<typename L::value_type>(), std::declval<typename R::value_type>()));
+	L left;
+	R right;
+	value_type operator[](size_t i) const { return Op::apply(left[i], right[i]); }
+};
+
+// the operations, plain functions so they compile the same in device code
+struct AddOp { template <typename A, typename B> static auto apply(A a, B b) { return a + b; } };
+struct SubOp { template <typename A, typename B> static auto apply(A a, B b) { return a - b; } };
+struct MulOp { template <typename A, typename B> static auto apply(A a, B b) { return a * b; } };
+struct DivOp { template <typename A, typename B> static auto apply(A a, B b) { return a / b; } };
+struct MaxOp { template <typename A, typename B> static auto apply(A a, B b) { return a > b ? a : b; } };
+struct MinOp { template <typename A, typename B> static auto apply(A a, B b) { return a < b ? a : b; } };
+
+template <typename T>
+class DeviceVector;
+
+template <typename X> struct is_vector_term : std::false_type {};
+template <typename T> struct is_vector_term<VectorTerm<T>> : std::true_type {};
+template <typename T> struct is_vector_term<ScalarTerm<T>> : std::true_type {};
+template <typename Op, typename L, typename R> struct is_vector_term<BinaryTerm<Op, L, R>> : std::true_type {};
+template <typename T> struct is_vector_term<DeviceVector<T>> : std::true_type {};
+
+// the operators below only take part when one operand is a vector or an expression and the other one is too, or is a number
+template <typename L, typename R>
+constexpr bool is_vector_operation = (is_vector_term<L>::value && (is_vector_term<R>::value || std::is_arithmetic_v<R>))
+	|| (std::is_arithmetic_v<L> && is_vector_term<R>::value);
+
+// a vector becomes a leaf, an expression is used as it is
+template <typename T>
+VectorTerm<T> term_of(const DeviceVector<T>& vector) { return { vector.data() }; }
+template <typename X, typename = std::enable_if_t<is_vector_term<X>::value>>
+X term_of(const X& term) { return term; }
+
+// a number takes the element type of the other operand, so float expressions are not promoted to double by a literal
+template <typename Other, typename X>
+auto as_term(const X& operand) {
+	if constexpr (std::is_arithmetic_v<X>) {
+		using V = typename decltype(term_of(std::declval<const Other&>()))::value_type;
+		return ScalarTerm<V>{ static_cast<V>(operand) };
+	}
+	else {
+		return term_of(operand);
+	}
+}
+
+template <typename Op, typename L, typename R>
+auto make_term(const L& left, const R& right) {
+	auto leftTerm = as_term<R>(left);
+	auto rightTerm = as_term<L>(right);
+	return BinaryTerm<Op, decltype(leftTerm), decltype(rightTerm)>{ leftTerm, rightTerm };
+}
+
+#define VECTOR_OPERATION(NAME, OP) \
+	template <typename L, typename R, typename = std::enable_if_t<is_vector_operation<L, R>>> \
+	auto NAME(const L& left, const R& right) { return make_term<OP>(left, right); }
+VECTOR_OPERATION(operator+, AddOp)
+VECTOR_OPERATION(operator-, SubOp)
+VECTOR_OPERATION(operator*, MulOp)
+VECTOR_OPERATION(operator/, DivOp)
+VECTOR_OPERATION(max, MaxOp)
+VECTOR_OPERATION(min, MinOp)
+#undef VECTOR_OPERATION
+
+// a vector in USM device memory that expressions can be assigned to
+template <typename T>
+class DeviceVector {
+public:
+	DeviceVector(cl::sycl::queue& deviceQueue, size_t count)
+		: deviceQueue(deviceQueue), pointer(cl::sycl::malloc_device<T>(count, deviceQueue)), count(count) {}
+	~DeviceVector() {
+		deviceQueue.wait();
+		cl::sycl::free(pointer, deviceQueue);
+	}
+
+	// the vector owns its device memory, so it cannot be copied, assigning one vector to another copies the elements
+	DeviceVector(const DeviceVector&) = delete;
+	DeviceVector& operator=(const DeviceVector& other) {
+		assign(other).wait();
+		return *this;
+	}
+
+	T* data() const { return pointer; }
+	size_t size() const { return count; }
+
+	cl::sycl::event copy_from(const T* host) { return deviceQueue.memcpy(pointer, host, count * sizeof(T)); }
+	cl::sycl::event copy_to(T* host) { return deviceQueue.memcpy(host, pointer, count * sizeof(T)); }
+
+	// evaluate the expression into this vector with one kernel, without waiting, and return its event
+	// the vector may appear in the expression itself (out = max(out, 0)), every element only reads its own index
+	template <typename E>
+	cl::sycl::event assign(const E& expression, const std::vector<cl::sycl::event>& dependencies = {}) {
+		auto term = as_term<DeviceVector>(expression);
+		T* out = pointer;
+		return deviceQueue.submit([&](cl::sycl::handler& queueHandler) {
+			queueHandler.depends_on(dependencies);
+			queueHandler.parallel_for(cl::sycl::range<1>{ count }, [=](cl::sycl::id<1> i) {
+				out[i] = static_cast<T>(term[i]);
+			});
+		});
+	}
+
+	// out = expression, blocking
+	template <typename E, typename = std::enable_if_t<is_vector_term<E>::value || std::is_arithmetic_v<E>>>
+	DeviceVector& operator=(const E& expression) {
+		assign(expression).wait();
+		return *this;
+	}
+
+private:
+	cl::sycl::queue deviceQueue;
+	T* pointer;
+	size_t count;
+};
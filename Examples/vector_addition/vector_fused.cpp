@@ -0,0 +1,143 @@
+#include <CL/sycl.hpp>
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <string>
+#include <vector>
+#include "vector_expression.hpp"
+
+// default values, each one can be changed from the command line
+#define VECTOR_SIZE (16 * 1024 * 1024)
+#define TIMED_ITERATIONS 10
+
+// time of one command from its event profile in milliseconds
+static double event_time(cl::sycl::event& queueEvent) {
+	auto end = queueEvent.get_profiling_info<cl::sycl::info::event_profiling::command_end>();
+	auto start = queueEvent.get_profiling_info<cl::sycl::info::event_profiling::command_start>();
+	return (end - start) / 1.0e6;
+}
+
+// run one version of a chain a few times and return the median of the summed kernel times
+static double time_chain(cl::sycl::queue& deviceQueue, size_t iterations, const std::function<std::vector<cl::sycl::event>()>& chain) {
+	// the first run includes JIT compilation and is not timed
+	chain();
+	deviceQueue.wait();
+	std::vector<double> times;
+	for (size_t iter = 0; iter < iterations; iter++) {
+		std::vector<cl::sycl::event> kernels = chain();
+		deviceQueue.wait();
+		double time = 0.0;
+		for (auto& kernelEvent : kernels) {
+			time += event_time(kernelEvent);
+		}
+		times.push_back(time);
+	}
+	std::sort(times.begin(), times.end());
+	return times[times.size() / 2];
+}
+
+int main(int argc, char* argv[]) {
+
+	// optional arguments: vector size and timed iterations
+	size_t vectorSize = argc > 1 ? std::stoul(argv[1]) : VECTOR_SIZE;
+	size_t iterations = argc > 2 ? std::stoul(argv[2]) : TIMED_ITERATIONS;
+	if (vectorSize == 0 || iterations == 0) {
+		std::cout << "Usage: " << argv[0] << " [vector size] [iterations], both at least 1\n";
+		return -1;
+	}
+
+	std::cout << "Comparing fused and unfused element-wise kernels...\n"
+		<< "Vector size: " << vectorSize << std::endl;
+
+	// create the queue using default device, with profiling so the kernel times can be read
+	cl::sycl::queue deviceQueue(cl::sycl::default_selector{}, cl::sycl::property::queue::enable_profiling());
+	std::cout << "Running on " << deviceQueue.get_device().get_info<cl::sycl::info::device::name>() << "\n\n";
+
+	// load vectors, values on both sides of zero so max and min change something
+	std::vector<float> xHost(vectorSize);
+	std::vector<float> yHost(vectorSize);
+	std::vector<float> bHost(vectorSize);
+	for (size_t i = 0; i < vectorSize; i++) {
+		xHost.at(i) = static_cast<float>(i % 17) - 8.0f;
+		yHost.at(i) = static_cast<float>(i % 5) - 2.0f;
+		bHost.at(i) = static_cast<float>(i % 3);
+	}
+	float a = 0.75f;
+	float scale = 0.5f;
+
+	DeviceVector<float> x(deviceQueue, vectorSize);
+	DeviceVector<float> y(deviceQueue, vectorSize);
+	DeviceVector<float> b(deviceQueue, vectorSize);
+	DeviceVector<float> tmp(deviceQueue, vectorSize);
+	DeviceVector<float> out(deviceQueue, vectorSize);
+	x.copy_from(xHost.data());
+	y.copy_from(yHost.data());
+	b.copy_from(bHost.data());
+	deviceQueue.wait();
+
+	std::vector<float> outHost(vectorSize);
+	bool passed = true;
+
+	// time both versions of a chain, check both results against the host, and report the memory traffic
+	// unfusedAccesses and fusedAccesses count the vector elements each version reads and writes per element
+	auto compare = [&](const std::string& name, size_t unfusedAccesses, size_t fusedAccesses,
+			const std::function<std::vector<cl::sycl::event>()>& unfused, const std::function<std::vector<cl::sycl::event>()>& fused,
+			const std::function<float(size_t)>& reference) {
+		auto validate = [&](const char* version) {
+			out.copy_to(outHost.data()).wait();
+			for (size_t i = 0; i < vectorSize; i++) {
+				float expected = reference(i);
+				if (std::abs(outHost.at(i) - expected) > 1e-5f * (std::abs(expected) + 1.0f)) {
+					std::cout << "Incorrect device values in " << name << " (" << version << ").\n"
+						<< outHost.at(i) << " != " << expected << "\n";
+					passed = false;
+					return;
+				}
+			}
+		};
+		double unfusedTime = time_chain(deviceQueue, iterations, unfused);
+		validate("unfused");
+		double fusedTime = time_chain(deviceQueue, iterations, fused);
+		validate("fused");
+
+		double unfusedBytes = static_cast<double>(unfusedAccesses) * vectorSize * sizeof(float);
+		double fusedBytes = static_cast<double>(fusedAccesses) * vectorSize * sizeof(float);
+		std::cout << name << "\n"
+			<< "  unfused: " << unfusedTime << " ms, " << unfusedBytes / 1.0e6 << " MB moved, " << unfusedBytes / (unfusedTime * 1.0e6) << " GB/s\n"
+			<< "  fused  : " << fusedTime << " ms, " << fusedBytes / 1.0e6 << " MB moved, " << fusedBytes / (fusedTime * 1.0e6) << " GB/s\n"
+			<< "  speedup: " << unfusedTime / fusedTime << "x\n\n";
+	};
+
+	// out = max(a * x + y, 0)
+	// unfused: three kernels chained by events, every step reads its inputs from and writes its result to device memory
+	compare("out = max(a * x + y, 0)", 2 + 3 + 2, 3,
+		[&]() {
+			auto step1 = tmp.assign(a * x);
+			auto step2 = tmp.assign(tmp + y, { step1 });
+			auto step3 = out.assign(max(tmp, 0), { step2 });
+			return std::vector<cl::sycl::event>{ step1, step2, step3 };
+		},
+		[&]() {
+			return std::vector<cl::sycl::event>{ out.assign(max(a * x + y, 0)) };
+		},
+		[&](size_t i) { return std::max(a * xHost[i] + yHost[i], 0.0f); });
+
+	// out = min(max(a * x + y, 0), 6) * scale + b
+	compare("out = min(max(a * x + y, 0), 6) * scale + b", 2 + 3 + 2 + 2 + 2 + 3, 4,
+		[&]() {
+			auto step1 = tmp.assign(a * x);
+			auto step2 = tmp.assign(tmp + y, { step1 });
+			auto step3 = tmp.assign(max(tmp, 0), { step2 });
+			auto step4 = tmp.assign(min(tmp, 6), { step3 });
+			auto step5 = tmp.assign(tmp * scale, { step4 });
+			auto step6 = out.assign(tmp + b, { step5 });
+			return std::vector<cl::sycl::event>{ step1, step2, step3, step4, step5, step6 };
+		},
+		[&]() {
+			return std::vector<cl::sycl::event>{ out.assign(min(max(a * x + y, 0), 6) * scale + b) };
+		},
+		[&](size_t i) { return std::min(std::max(a * xHost[i] + yHost[i], 0.0f), 6.0f) * scale + bHost[i]; });
+
+	std::cout << (passed ? "Host and device values match\n" : "Validation failed\n");
+	return passed ? 0 : -1;
+}
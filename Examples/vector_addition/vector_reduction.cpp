@@ -0,0 +1,286 @@
+#include <CL/sycl.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <execution>
+#include <functional>
+#include <numeric>
+#include <string>
+#include <vector>
+#include "usm_pool.hpp"
+#include "vector_reduction.hpp"
+
+// default values, each one can be changed from the command line
+#define MIN_VECTOR_SIZE 1024
+#define MAX_VECTOR_SIZE (1024 * 1024 * 1024)   // 4 GB per vector of float
+#define WORKGROUP_SIZE 256
+#define TIMED_ITERATIONS 5
+
+// exact answers computed on the host in double, to check every version against
+struct Reference {
+	double sum = 0.0;
+	double sumAbs = 0.0;
+	float min = 0.0f;
+	float max = 0.0f;
+	size_t argmax = 0;
+	double dot = 0.0;
+	double dotAbs = 0.0;
+	double sumSquares = 0.0;
+};
+
+static Reference reference(const float* x, const float* y, size_t n) {
+	Reference ref;
+	ref.min = x[0];
+	ref.max = x[0];
+	for (size_t i = 0; i < n; i++) {
+		ref.sum += x[i];
+		ref.sumAbs += std::abs(x[i]);
+		ref.min = std::min(ref.min, x[i]);
+		// ordered like ArgMaxOp, so a maximum of zero with both signs gives the index of the +0.0f
+		if (argmax_key(x[i]) > argmax_key(ref.max)) {
+			ref.max = x[i];
+			ref.argmax = i;
+		}
+		ref.dot += static_cast<double>(x[i]) * y[i];
+		ref.dotAbs += std::abs(static_cast<double>(x[i]) * y[i]);
+		ref.sumSquares += static_cast<double>(x[i]) * x[i];
+	}
+	return ref;
+}
+
+// float sums are allowed a small error relative to the sum of the magnitudes, the order of the additions differs
+static bool close(double value, double expected, double scale) {
+	return std::abs(value - expected) <= 1e-4 * scale + 1e-6;
+}
+
+static bool check(SumReduction, float value, const Reference& ref) { return close(value, ref.sum, ref.sumAbs); }
+static bool check(MinReduction, float value, const Reference& ref) { return value == ref.min; }
+static bool check(MaxReduction, float value, const Reference& ref) { return value == ref.max; }
+static bool check(ArgMaxReduction, ArgMax value, const Reference& ref) { return value.index == ref.argmax && value.value == ref.max; }
+static bool check(DotReduction, float value, const Reference& ref) { return close(value, ref.dot, ref.dotAbs); }
+static bool check(NormReduction, float value, const Reference& ref) { return close(value, std::sqrt(ref.sumSquares), std::sqrt(ref.sumSquares)); }
+
+// host versions with the parallel standard algorithms, sums accumulate in double so a serial fallback
+// does not lose the small terms once the total is large
+static float host_reduce(SumReduction, const float* x, const float*, size_t n) {
+	return static_cast<float>(std::reduce(std::execution::par_unseq, x, x + n, 0.0));
+}
+static float host_reduce(MinReduction, const float* x, const float*, size_t n) {
+	return std::reduce(std::execution::par_unseq, x, x + n, MinReduction::identity(), [](float a, float b) { return std::min(a, b); });
+}
+static float host_reduce(MaxReduction, const float* x, const float*, size_t n) {
+	return std::reduce(std::execution::par_unseq, x, x + n, MaxReduction::identity(), [](float a, float b) { return std::max(a, b); });
+}
+static ArgMax host_reduce(ArgMaxReduction, const float* x, const float*, size_t n) {
+	const float* largest = std::max_element(std::execution::par_unseq, x, x + n,
+		[](float a, float b) { return argmax_key(a) < argmax_key(b); });
+	return { *largest, static_cast<uint32_t>(largest - x) };
+}
+static float host_reduce(DotReduction, const float* x, const float* y, size_t n) {
+	return static_cast<float>(std::transform_reduce(std::execution::par_unseq, x, x + n, y, 0.0, std::plus<double>(),
+		[](float a, float b) { return static_cast<double>(a) * b; }));
+}
+static float host_reduce(NormReduction, const float* x, const float*, size_t n) {
+	return static_cast<float>(std::sqrt(std::transform_reduce(std::execution::par_unseq, x, x + n, 0.0, std::plus<double>(),
+		[](float a) { return static_cast<double>(a) * a; })));
+}
+
+// time of one command from its event profile in milliseconds
+static double event_time(cl::sycl::event& queueEvent) {
+	auto end = queueEvent.get_profiling_info<cl::sycl::info::event_profiling::command_end>();
+	auto start = queueEvent.get_profiling_info<cl::sycl::info::event_profiling::command_start>();
+	return (end - start) / 1.0e6;
+}
+
+// median time of the timed iterations, after one untimed run, every pass of a version counts
+static double device_time(size_t iterations, const std::function<std::vector<cl::sycl::event>()>& run) {
+	cl::sycl::event::wait(run());
+	std::vector<double> times;
+	for (size_t iter = 0; iter < iterations; iter++) {
+		std::vector<cl::sycl::event> passes = run();
+		cl::sycl::event::wait(passes);
+		double time = 0.0;
+		for (auto& passEvent : passes) {
+			time += event_time(passEvent);
+		}
+		times.push_back(time);
+	}
+	std::sort(times.begin(), times.end());
+	return times[times.size() / 2];
+}
+
+static double host_time(size_t iterations, const std::function<void()>& run) {
+	run();
+	std::vector<double> times;
+	for (size_t iter = 0; iter < iterations; iter++) {
+		auto start = std::chrono::steady_clock::now();
+		run();
+		auto end = std::chrono::steady_clock::now();
+		times.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+	}
+	std::sort(times.begin(), times.end());
+	return times[times.size() / 2];
+}
+
+// inputs in device memory and on the host, and the settings of the run
+struct Inputs {
+	cl::sycl::queue& deviceQueue;
+	const float* xDevice;
+	const float* yDevice;
+	const float* xHost;
+	const float* yHost;
+	size_t workGroupSize;
+	size_t iterations;
+	bool atomic64;
+};
+
+// run the three device versions and the host version of one reduction on n elements, print a row of GB/s
+template <typename R>
+static bool benchmark(const char* name, const Inputs& in, size_t n, const Reference& ref) {
+	using T = typename R::T;
+	cl::sycl::queue& deviceQueue = in.deviceQueue;
+	UsmPool& pool = usm_pool(deviceQueue, cl::sycl::usm::alloc::device);
+	T* partials = pool.allocate<T>(REDUCTION_MAX_GROUPS);
+	T* result = pool.allocate<T>(1);
+	auto atomicResult = pool.allocate<typename R::AtomicT>(1);
+
+	bool passed = true;
+	auto validate = [&](const char* version, T value) {
+		if (!check(R{}, R::finish(value), ref)) {
+			std::cout << "\nIncorrect " << name << " from " << version << " for " << n << " elements\n";
+			passed = false;
+		}
+	};
+	auto readResult = [&]() {
+		T value;
+		deviceQueue.memcpy(&value, result, sizeof(T)).wait();
+		return value;
+	};
+
+	const float* x = in.xDevice;
+	const float* y = in.yDevice;
+	double syclTime = device_time(in.iterations, [&]() { return reduce_sycl<R>(deviceQueue, x, y, n, result); });
+	validate("sycl::reduction", readResult());
+	double treeTime = device_time(in.iterations, [&]() { return reduce_tree<R>(deviceQueue, x, y, n, in.workGroupSize, partials, result); });
+	validate("the tree", readResult());
+	// without 64-bit atomics the submit would throw and end the whole sweep, the atomic version is skipped instead
+	bool runAtomic = !R::needsAtomic64 || in.atomic64;
+	double atomicTime = 0.0;
+	if (runAtomic) {
+		atomicTime = device_time(in.iterations, [&]() { return reduce_atomic<R>(deviceQueue, x, y, n, in.workGroupSize, atomicResult); });
+		typename R::AtomicT atomicValue;
+		deviceQueue.memcpy(&atomicValue, atomicResult, sizeof(atomicValue)).wait();
+		validate("the atomics", R::from_atomic(atomicValue));
+	}
+
+	auto hostValue = host_reduce(R{}, in.xHost, in.yHost, n);
+	double hostTime = host_time(in.iterations, [&]() { hostValue = host_reduce(R{}, in.xHost, in.yHost, n); });
+	if (!check(R{}, hostValue, ref)) {
+		std::cout << "\nIncorrect " << name << " from the host for " << n << " elements\n";
+		passed = false;
+	}
+
+	pool.deallocate(partials);
+	pool.deallocate(result);
+	pool.deallocate(atomicResult);
+
+	double bytes = static_cast<double>(R::vectors) * n * sizeof(float);
+	auto bandwidth = [&](double time) { return bytes / (time * 1.0e6); };
+	std::cout << "  " << name << ": sycl::reduction " << bandwidth(syclTime) << ", tree " << bandwidth(treeTime) << ", atomic ";
+	if (runAtomic) {
+		std::cout << bandwidth(atomicTime);
+	}
+	else {
+		std::cout << "skipped (no atomic64)";
+	}
+	std::cout << ", host " << bandwidth(hostTime) << " GB/s\n";
+	return passed;
+}
+
+int main(int argc, char* argv[]) {
+
+	// optional arguments: largest vector size, work group size, and timed iterations
+	size_t maxSize = MAX_VECTOR_SIZE;
+	size_t workGroupSize = WORKGROUP_SIZE;
+	size_t iterations = TIMED_ITERATIONS;
+	try {
+		if (argc > 1) maxSize = std::stoull(argv[1]);
+		if (argc > 2) workGroupSize = std::stoul(argv[2]);
+		if (argc > 3) iterations = std::stoul(argv[3]);
+		if (maxSize < MIN_VECTOR_SIZE || maxSize > 0xFFFFFFFFull || workGroupSize == 0 || iterations == 0) {
+			throw std::invalid_argument("the vector size must be between " + std::to_string(MIN_VECTOR_SIZE) + " and 2^32 - 1");
+		}
+	}
+	catch (const std::exception& e) {
+		std::cout << "Error: " << e.what() << "\n"
+			<< "Usage: " << argv[0] << " [largest vector size] [work group size] [iterations]\n";
+		return -1;
+	}
+
+	// create the queue using default device, with profiling so only the kernels are timed
+	cl::sycl::queue deviceQueue(cl::sycl::default_selector{}, cl::sycl::property::queue::enable_profiling());
+	cl::sycl::device offloadDevice = deviceQueue.get_device();
+	std::cout << "Comparing reductions...\n"
+		<< "Running on " << offloadDevice.get_info<cl::sycl::info::device::name>() << "\n";
+
+	// two vectors have to fit in device memory, smaller sizes are still run when the largest one does not
+	size_t requestedSize = maxSize;
+	while (maxSize >= MIN_VECTOR_SIZE && (maxSize * sizeof(float) > offloadDevice.get_info<cl::sycl::info::device::max_mem_alloc_size>()
+		|| 2 * maxSize * sizeof(float) > offloadDevice.get_info<cl::sycl::info::device::global_mem_size>())) {
+		maxSize /= 2;
+	}
+	if (maxSize < MIN_VECTOR_SIZE) {
+		std::cout << "Not enough device memory for two vectors of " << MIN_VECTOR_SIZE << " floats\n";
+		return -1;
+	}
+	if (maxSize != requestedSize) {
+		std::cout << "Vectors of " << requestedSize << " floats do not fit in device memory, the largest size is " << maxSize << "\n";
+	}
+
+	// inputs between -1 and 1 that do not repeat with a short period, so the maximum is not at a predictable index
+	std::vector<float> xHost(maxSize);
+	std::vector<float> yHost(maxSize);
+	for (size_t i = 0; i < maxSize; i++) {
+		xHost[i] = static_cast<float>((i * 2654435761ull) % 2000001) / 1.0e6f - 1.0f;
+		yHost[i] = static_cast<float>((i * 40503ull + 7) % 2000001) / 1.0e6f - 1.0f;
+	}
+	float* xDevice = cl::sycl::malloc_device<float>(maxSize, deviceQueue);
+	float* yDevice = cl::sycl::malloc_device<float>(maxSize, deviceQueue);
+	if (!xDevice || !yDevice) {
+		cl::sycl::free(xDevice, deviceQueue);
+		cl::sycl::free(yDevice, deviceQueue);
+		std::cout << "Not enough device memory for the input vectors\n";
+		return -1;
+	}
+	deviceQueue.memcpy(xDevice, xHost.data(), maxSize * sizeof(float));
+	deviceQueue.memcpy(yDevice, yHost.data(), maxSize * sizeof(float));
+	deviceQueue.wait();
+
+	bool atomic64 = offloadDevice.has(cl::sycl::aspect::atomic64);
+	if (!atomic64) {
+		std::cout << "The device has no 64-bit atomics, argmax skips the atomic version\n";
+	}
+	Inputs in{ deviceQueue, xDevice, yDevice, xHost.data(), yHost.data(), workGroupSize, iterations, atomic64 };
+	bool passed = true;
+	try {
+		for (size_t n = MIN_VECTOR_SIZE; n <= maxSize; n *= 4) {
+			Reference ref = reference(xHost.data(), yHost.data(), n);
+			std::cout << "\n" << n << " elements (" << n * sizeof(float) / 1.0e6 << " MB per vector)\n";
+			passed &= benchmark<SumReduction>("sum   ", in, n, ref);
+			passed &= benchmark<MinReduction>("min   ", in, n, ref);
+			passed &= benchmark<MaxReduction>("max   ", in, n, ref);
+			passed &= benchmark<ArgMaxReduction>("argmax", in, n, ref);
+			passed &= benchmark<DotReduction>("dot   ", in, n, ref);
+			passed &= benchmark<NormReduction>("norm  ", in, n, ref);
+		}
+	}
+	catch (const std::exception& e) {
+		std::cout << "Error: " << e.what() << "\n";
+		passed = false;
+	}
+
+	cl::sycl::free(xDevice, deviceQueue);
+	cl::sycl::free(yDevice, deviceQueue);
+	std::cout << (passed ? "\nHost and device values match\n" : "\nValidation failed\n");
+	return passed ? 0 : -1;
+}
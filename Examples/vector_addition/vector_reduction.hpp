@@ -0,0 +1,223 @@
+#pragma once
+#include <CL/sycl.hpp>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+// work items of the hand-written versions each reduce about this many elements before the group reduction,
+// and no more work groups than REDUCTION_MAX_GROUPS are launched, so the second pass stays small
+#define REDUCTION_ELEMENTS_PER_ITEM 16
+#define REDUCTION_MAX_GROUPS 1024
+
+// a reduction is described by a struct:
+//   T         the value that is reduced
+//   SyclOp    the function object that combines two values, associative and commutative
+//   identity  the value that changes nothing when combined
+//   map       turns element i of the input vectors into a value
+//   finish    turns the total into the answer (the square root of the norm)
+//   vectors   how many input vectors are read, for the GB/s
+//   AtomicT, to_atomic, from_atomic, atomic_combine   how the atomic version keeps the total in global memory
+//   needsAtomic64   true when AtomicT is 64 bits wide, so the atomic version needs aspect::atomic64
+// the reductions of floats share everything but map, the operation, and the identity
+template <typename Op>
+struct FloatReduction {
+	using T = float;
+	using SyclOp = Op;
+	using AtomicT = float;
+	static constexpr int vectors = 1;
+	static constexpr bool needsAtomic64 = false;
+	static T map(const float* x, const float*, size_t i) { return x[i]; }
+	static T finish(T total) { return total; }
+	static AtomicT to_atomic(T value) { return value; }
+	static T from_atomic(AtomicT value) { return value; }
+};
+
+struct SumReduction : FloatReduction<cl::sycl::plus<float>> {
+	static T identity() { return 0.0f; }
+	template <typename Ref> static void atomic_combine(Ref& total, T value) { total.fetch_add(value); }
+};
+
+struct MinReduction : FloatReduction<cl::sycl::minimum<float>> {
+	static T identity() { return std::numeric_limits<float>::infinity(); }
+	template <typename Ref> static void atomic_combine(Ref& total, T value) { total.fetch_min(value); }
+};
+
+struct MaxReduction : FloatReduction<cl::sycl::maximum<float>> {
+	static T identity() { return -std::numeric_limits<float>::infinity(); }
+	template <typename Ref> static void atomic_combine(Ref& total, T value) { total.fetch_max(value); }
+};
+
+struct DotReduction : SumReduction {
+	static constexpr int vectors = 2;
+	static T map(const float* x, const float* y, size_t i) { return x[i] * y[i]; }
+};
+
+struct NormReduction : SumReduction {
+	static T map(const float* x, const float*, size_t i) { return x[i] * x[i]; }
+	static T finish(T total) { return cl::sycl::sqrt(total); }
+};
+
+// the largest element and its index, on ties the smallest index
+// elements are compared by argmax_key, not by float comparison, so -0.0f is smaller than +0.0f in every version,
+// the atomic one included, and the versions give the same index for the same input
+struct ArgMax {
+	float value;
+	uint32_t index;
+};
+
+// the float bits with the sign bit flipped for positive values and every bit flipped for negative ones,
+// the unsigned order of the keys is the order of the floats, with -0.0f below +0.0f
+inline uint32_t argmax_key(float value) {
+	uint32_t bits = cl::sycl::bit_cast<uint32_t>(value);
+	return (bits & 0x80000000u) ? ~bits : (bits | 0x80000000u);
+}
+
+struct ArgMaxOp {
+	ArgMax operator()(const ArgMax& a, const ArgMax& b) const {
+		uint32_t aKey = argmax_key(a.value);
+		uint32_t bKey = argmax_key(b.value);
+		if (aKey != bKey) {
+			return aKey > bKey ? a : b;
+		}
+		return a.index < b.index ? a : b;
+	}
+};
+
+// the atomic version packs the key and the index into one 64-bit integer whose order is the order of ArgMaxOp,
+// so a single fetch_max combines them, the index is stored inverted so the smaller index is the larger integer
+// indices are 32 bits, enough for vectors of up to 4G elements
+// a 64-bit atomic_ref needs aspect::atomic64, devices without it skip the atomic version (needsAtomic64)
+struct ArgMaxReduction {
+	using T = ArgMax;
+	using SyclOp = ArgMaxOp;
+	using AtomicT = uint64_t;
+	static constexpr int vectors = 1;
+	static constexpr bool needsAtomic64 = true;
+	static T identity() { return { -std::numeric_limits<float>::infinity(), 0xFFFFFFFFu }; }
+	static T map(const float* x, const float*, size_t i) { return { x[i], static_cast<uint32_t>(i) }; }
+	static T finish(T total) { return total; }
+	static AtomicT to_atomic(T value) {
+		return (static_cast<uint64_t>(argmax_key(value.value)) << 32) | (0xFFFFFFFFu - value.index);
+	}
+	static T from_atomic(AtomicT packed) {
+		uint32_t key = static_cast<uint32_t>(packed >> 32);
+		uint32_t bits = (key & 0x80000000u) ? (key & 0x7FFFFFFFu) : ~key;
+		return { cl::sycl::bit_cast<float>(bits), 0xFFFFFFFFu - static_cast<uint32_t>(packed) };
+	}
+	template <typename Ref> static void atomic_combine(Ref& total, T value) { total.fetch_max(to_atomic(value)); }
+};
+
+// work groups for n elements, at least one and at most REDUCTION_MAX_GROUPS
+inline size_t reduction_groups(size_t n, size_t workGroupSize) {
+	size_t perGroup = workGroupSize * REDUCTION_ELEMENTS_PER_ITEM;
+	size_t groups = (n + perGroup - 1) / perGroup;
+	return groups < 1 ? 1 : (groups > REDUCTION_MAX_GROUPS ? REDUCTION_MAX_GROUPS : groups);
+}
+
+// hand-written sub-group reduction: in step k every lane combines its value with the one 2^k lanes up,
+// lanes whose partner is past the end keep their value, so after log2(size) steps lane 0 holds the total,
+// for any sub-group size, not only powers of two
+template <typename R>
+typename R::T subgroup_reduce(const cl::sycl::sub_group& subGroup, typename R::T value) {
+	size_t lane = subGroup.get_local_linear_id();
+	size_t size = subGroup.get_local_linear_range();
+	for (size_t offset = 1; offset < size; offset *= 2) {
+		typename R::T other = cl::sycl::shift_group_left(subGroup, value, offset);
+		if (lane + offset < size) {
+			value = typename R::SyclOp{}(value, other);
+		}
+	}
+	return value;
+}
+
+// every work item combines elements id, id + stride, ... of load, and the work items of a group are reduced with
+// sub-group shifts and then, across the sub-groups, through local memory, one value per group is written to out
+template <typename R, typename Load>
+cl::sycl::event group_reduce_pass(cl::sycl::queue& deviceQueue, size_t n, size_t groups, size_t workGroupSize, Load load,
+		typename R::T* out, const std::vector<cl::sycl::event>& dependencies) {
+	using T = typename R::T;
+	return deviceQueue.submit([&](cl::sycl::handler& queueHandler) {
+		queueHandler.depends_on(dependencies);
+		// one entry per sub-group, workGroupSize entries are enough for any sub-group size
+		cl::sycl::local_accessor<T, 1> subgroupTotals(cl::sycl::range<1>{ workGroupSize }, queueHandler);
+		cl::sycl::nd_range<1> ndRange{ cl::sycl::range<1>{ groups * workGroupSize }, cl::sycl::range<1>{ workGroupSize } };
+		queueHandler.parallel_for(ndRange, [=](cl::sycl::nd_item<1> item) {
+			T value = R::identity();
+			for (size_t i = item.get_global_id(0); i < n; i += item.get_global_range(0)) {
+				value = typename R::SyclOp{}(value, load(i));
+			}
+			cl::sycl::sub_group subGroup = item.get_sub_group();
+			value = subgroup_reduce<R>(subGroup, value);
+			if (subGroup.get_local_linear_id() == 0) {
+				subgroupTotals[subGroup.get_group_linear_id()] = value;
+			}
+			cl::sycl::group_barrier(item.get_group());
+
+			// the first sub-group reduces the totals of all sub-groups
+			if (subGroup.get_group_linear_id() == 0) {
+				T total = R::identity();
+				for (size_t s = subGroup.get_local_linear_id(); s < subGroup.get_group_linear_range(); s += subGroup.get_local_linear_range()) {
+					total = typename R::SyclOp{}(total, subgroupTotals[s]);
+				}
+				total = subgroup_reduce<R>(subGroup, total);
+				if (subGroup.get_local_linear_id() == 0) {
+					out[item.get_group_linear_id()] = total;
+				}
+			}
+		});
+	});
+}
+
+// sycl::reduction: the runtime picks the strategy, one kernel
+template <typename R>
+std::vector<cl::sycl::event> reduce_sycl(cl::sycl::queue& deviceQueue, const float* x, const float* y, size_t n, typename R::T* result) {
+	auto kernelEvent = deviceQueue.submit([&](cl::sycl::handler& queueHandler) {
+		auto reducer = cl::sycl::reduction(result, R::identity(), typename R::SyclOp{},
+			cl::sycl::property_list{ cl::sycl::property::reduction::initialize_to_identity() });
+		queueHandler.parallel_for(cl::sycl::range<1>{ n }, reducer, [=](cl::sycl::id<1> i, auto& total) {
+			total.combine(R::map(x, y, i[0]));
+		});
+	});
+	return { kernelEvent };
+}
+
+// hand-written tree, two passes: every work group writes its total to partials, then one work group reduces those
+// partials needs room for REDUCTION_MAX_GROUPS values
+template <typename R>
+std::vector<cl::sycl::event> reduce_tree(cl::sycl::queue& deviceQueue, const float* x, const float* y, size_t n, size_t workGroupSize,
+		typename R::T* partials, typename R::T* result) {
+	size_t groups = reduction_groups(n, workGroupSize);
+	auto firstPass = group_reduce_pass<R>(deviceQueue, n, groups, workGroupSize,
+		[=](size_t i) { return R::map(x, y, i); }, partials, {});
+	auto secondPass = group_reduce_pass<R>(deviceQueue, groups, 1, workGroupSize,
+		[=](size_t i) { return partials[i]; }, result, { firstPass });
+	return { firstPass, secondPass };
+}
+
+// atomics, two passes: the total is set to the identity, then every sub-group reduces its elements with shifts
+// and its first lane combines the sub-group total into it with one atomic, there is no local memory and no barrier
+template <typename R>
+std::vector<cl::sycl::event> reduce_atomic(cl::sycl::queue& deviceQueue, const float* x, const float* y, size_t n, size_t workGroupSize,
+		typename R::AtomicT* result) {
+	using AtomicT = typename R::AtomicT;
+	size_t groups = reduction_groups(n, workGroupSize);
+	auto initEvent = deviceQueue.fill(result, R::to_atomic(R::identity()), 1);
+	auto reduceEvent = deviceQueue.submit([&](cl::sycl::handler& queueHandler) {
+		queueHandler.depends_on(initEvent);
+		cl::sycl::nd_range<1> ndRange{ cl::sycl::range<1>{ groups * workGroupSize }, cl::sycl::range<1>{ workGroupSize } };
+		queueHandler.parallel_for(ndRange, [=](cl::sycl::nd_item<1> item) {
+			typename R::T value = R::identity();
+			for (size_t i = item.get_global_id(0); i < n; i += item.get_global_range(0)) {
+				value = typename R::SyclOp{}(value, R::map(x, y, i));
+			}
+			cl::sycl::sub_group subGroup = item.get_sub_group();
+			value = subgroup_reduce<R>(subGroup, value);
+			if (subGroup.get_local_linear_id() == 0) {
+				cl::sycl::atomic_ref<AtomicT, cl::sycl::memory_order::relaxed, cl::sycl::memory_scope::device,
+					cl::sycl::access::address_space::global_space> total(*result);
+				R::atomic_combine(total, value);
+			}
+		});
+	});
+	return { initEvent, reduceEvent };
+}
@@ -0,0 +1,152 @@
+#include <CL/sycl.hpp>
+#include <algorithm>
+#include <chrono>
+#include <execution>
+#include <functional>
+#include <numeric>
+#include <string>
+#include <vector>
+#include "vector_scan.hpp"
+
+// default values, each one can be changed from the command line
+#define MIN_VECTOR_SIZE 1024
+#define MAX_VECTOR_SIZE (256 * 1024 * 1024)   // 1 GB per vector of int
+#define TIMED_ITERATIONS 5
+
+// time of one command from its event profile in milliseconds
+static double event_time(cl::sycl::event& queueEvent) {
+	auto end = queueEvent.get_profiling_info<cl::sycl::info::event_profiling::command_end>();
+	auto start = queueEvent.get_profiling_info<cl::sycl::info::event_profiling::command_start>();
+	return (end - start) / 1.0e6;
+}
+
+// median time of the timed iterations, after one untimed run, every pass counts
+static double device_time(size_t iterations, const std::function<std::vector<cl::sycl::event>()>& run) {
+	cl::sycl::event::wait(run());
+	std::vector<double> times;
+	for (size_t iter = 0; iter < iterations; iter++) {
+		std::vector<cl::sycl::event> passes = run();
+		cl::sycl::event::wait(passes);
+		double time = 0.0;
+		for (auto& passEvent : passes) {
+			time += event_time(passEvent);
+		}
+		times.push_back(time);
+	}
+	std::sort(times.begin(), times.end());
+	return times[times.size() / 2];
+}
+
+static double host_time(size_t iterations, const std::function<void()>& run) {
+	run();
+	std::vector<double> times;
+	for (size_t iter = 0; iter < iterations; iter++) {
+		auto start = std::chrono::steady_clock::now();
+		run();
+		auto end = std::chrono::steady_clock::now();
+		times.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+	}
+	std::sort(times.begin(), times.end());
+	return times[times.size() / 2];
+}
+
+int main(int argc, char* argv[]) {
+
+	// optional arguments: largest vector size, work group size, and timed iterations
+	size_t maxSize = MAX_VECTOR_SIZE;
+	size_t workGroupSize = SCAN_WORKGROUP_SIZE;
+	size_t iterations = TIMED_ITERATIONS;
+	try {
+		if (argc > 1) maxSize = std::stoull(argv[1]);
+		if (argc > 2) workGroupSize = std::stoul(argv[2]);
+		if (argc > 3) iterations = std::stoul(argv[3]);
+		// values are at most 3, so the sums stay below 2^31 up to 700M elements
+		if (maxSize < MIN_VECTOR_SIZE || maxSize > 700000000 || workGroupSize == 0 || iterations == 0) {
+			throw std::invalid_argument("the vector size must be between " + std::to_string(MIN_VECTOR_SIZE) + " and 700000000");
+		}
+	}
+	catch (const std::exception& e) {
+		std::cout << "Error: " << e.what() << "\n"
+			<< "Usage: " << argv[0] << " [largest vector size] [work group size] [iterations]\n";
+		return -1;
+	}
+
+	// create the queue using default device, with profiling so only the kernels are timed
+	cl::sycl::queue deviceQueue(cl::sycl::default_selector{}, cl::sycl::property::queue::enable_profiling());
+	std::cout << "Comparing prefix scans and stream compaction...\n"
+		<< "Running on " << deviceQueue.get_device().get_info<cl::sycl::info::device::name>() << "\n";
+
+	// values from 0 to 3, a quarter of them zero, compaction keeps the non-zero ones
+	std::vector<int> in(maxSize);
+	for (size_t i = 0; i < maxSize; i++) {
+		in[i] = static_cast<int>((i * 2654435761ull >> 7) % 4);
+	}
+	std::vector<int> out(maxSize);
+	std::vector<int> expected(maxSize);
+
+	int* inDevice = cl::sycl::malloc_device<int>(maxSize, deviceQueue);
+	int* outDevice = cl::sycl::malloc_device<int>(maxSize, deviceQueue);
+	if (!inDevice || !outDevice) {
+		cl::sycl::free(inDevice, deviceQueue);
+		cl::sycl::free(outDevice, deviceQueue);
+		std::cout << "Not enough device memory for " << maxSize << " elements\n";
+		return -1;
+	}
+	deviceQueue.memcpy(inDevice, in.data(), maxSize * sizeof(int)).wait();
+	ScanWorkspace<int> scanWorkspace(deviceQueue);
+	ScanWorkspace<uint32_t> compactWorkspace(deviceQueue);
+	auto nonZero = [](int value) { return value != 0; };
+
+	bool passed = true;
+	auto check = [&](const char* name, size_t n, size_t count) {
+		deviceQueue.memcpy(out.data(), outDevice, count * sizeof(int)).wait();
+		if (!std::equal(expected.begin(), expected.begin() + count, out.begin())) {
+			std::cout << "Incorrect " << name << " for " << n << " elements\n";
+			passed = false;
+		}
+	};
+
+	try {
+		for (size_t n = MIN_VECTOR_SIZE; n <= maxSize; n *= 4) {
+			double bytes = 2.0 * n * sizeof(int);
+			auto bandwidth = [](double moved, double time) { return moved / (time * 1.0e6); };
+			std::cout << "\n" << n << " elements (" << n * sizeof(int) / 1.0e6 << " MB)\n";
+
+			// exclusive scan, the host version is also the reference
+			double hostTime = host_time(iterations, [&]() { std::exclusive_scan(std::execution::par, in.begin(), in.begin() + n, expected.begin(), 0); });
+			double deviceTime = device_time(iterations, [&]() { return device_exclusive_scan(deviceQueue, inDevice, outDevice, n, 0, scanWorkspace, workGroupSize); });
+			check("exclusive scan", n, n);
+			std::cout << "  exclusive scan: device " << deviceTime << " ms, " << bandwidth(bytes, deviceTime) << " GB/s; host " << hostTime << " ms, "
+				<< bandwidth(bytes, hostTime) << " GB/s\n";
+
+			hostTime = host_time(iterations, [&]() { std::inclusive_scan(std::execution::par, in.begin(), in.begin() + n, expected.begin()); });
+			deviceTime = device_time(iterations, [&]() { return device_inclusive_scan(deviceQueue, inDevice, outDevice, n, scanWorkspace, workGroupSize); });
+			check("inclusive scan", n, n);
+			std::cout << "  inclusive scan: device " << deviceTime << " ms, " << bandwidth(bytes, deviceTime) << " GB/s; host " << hostTime << " ms, "
+				<< bandwidth(bytes, hostTime) << " GB/s\n";
+
+			// compaction reads every element and writes the kept ones
+			size_t kept = 0;
+			hostTime = host_time(iterations, [&]() { kept = std::copy_if(std::execution::par, in.begin(), in.begin() + n, expected.begin(), nonZero) - expected.begin(); });
+			deviceTime = device_time(iterations, [&]() { return device_copy_if(deviceQueue, inDevice, outDevice, n, nonZero, compactWorkspace, workGroupSize); });
+			size_t deviceKept = compactWorkspace.total();
+			if (deviceKept != kept) {
+				std::cout << "Incorrect copy_if count for " << n << " elements: " << deviceKept << " != " << kept << "\n";
+				passed = false;
+			}
+			check("copy_if", n, std::min(kept, deviceKept));
+			double compactBytes = static_cast<double>(n + kept) * sizeof(int);
+			std::cout << "  copy_if (" << kept << " kept): device " << deviceTime << " ms, " << bandwidth(compactBytes, deviceTime) << " GB/s; host "
+				<< hostTime << " ms, " << bandwidth(compactBytes, hostTime) << " GB/s\n";
+		}
+	}
+	catch (const std::exception& e) {
+		std::cout << "Error: " << e.what() << "\n";
+		passed = false;
+	}
+
+	cl::sycl::free(inDevice, deviceQueue);
+	cl::sycl::free(outDevice, deviceQueue);
+	std::cout << (passed ? "\nHost and device values match\n" : "\nValidation failed\n");
+	return passed ? 0 : -1;
+}
@@ -0,0 +1,227 @@
+#pragma once
+#include <CL/sycl.hpp>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+// elements every work item scans in one tile, a tile is SCAN_ITEMS_PER_WORK_ITEM * work group size elements
+#define SCAN_ITEMS_PER_WORK_ITEM 8
+// at most this many work groups, so the group totals fit in one tile-by-tile pass of a single work group
+#define SCAN_MAX_GROUPS 1024
+#define SCAN_WORKGROUP_SIZE 256
+
+// prefix scans and stream compaction, reduce-then-scan in three passes:
+//   1. every work group reduces its contiguous chunk of the input to one total
+//   2. one work group scans the group totals, so every group knows the sum of all chunks before its own
+//   3. every work group scans its chunk again, tile by tile, starting from that sum
+// inside a tile every work item combines its SCAN_ITEMS_PER_WORK_ITEM consecutive elements and exclusive_scan_over_group
+// gives the prefix of its first one, the total of the tile is carried into the next tile
+// global memory is read and written striped (neighbouring work items touch neighbouring elements, so the accesses
+// coalesce) and the tile is transposed through local memory to and from the consecutive elements of every work item,
+// which needs work group size * SCAN_ITEMS_PER_WORK_ITEM elements of local memory
+// the input is read twice, a single-pass decoupled look-back reads it once, but it waits on groups that started earlier,
+// which needs forward progress between work groups that SYCL does not guarantee, three passes run on every device
+// the operation has to be one of the SYCL function objects with a known identity (plus, maximum, minimum, ...)
+
+// device memory for the group totals, keep one per element type and reuse it across calls
+// every scan on a workspace waits for the previous one, so scans that share it are ordered even on an out-of-order queue
+// without passing their events as dependencies, scans that should overlap need a workspace each
+template <typename T>
+class ScanWorkspace {
+public:
+	explicit ScanWorkspace(cl::sycl::queue& deviceQueue)
+		: deviceQueue(deviceQueue), totals(cl::sycl::malloc_device<T>(SCAN_MAX_GROUPS + 1, deviceQueue)) {
+		if (!totals) {
+			throw std::runtime_error("not enough device memory for the scan workspace");
+		}
+	}
+	~ScanWorkspace() {
+		deviceQueue.wait();
+		cl::sycl::free(totals, deviceQueue);
+	}
+
+	// the workspace owns its device memory, so it cannot be copied
+	ScanWorkspace(const ScanWorkspace&) = delete;
+	ScanWorkspace& operator=(const ScanWorkspace&) = delete;
+
+	T* data() const { return totals; }
+
+	// the combination of every scanned value of the last scan, without init: the number of elements device_copy_if kept
+	// blocks until the device has written it
+	T total() {
+		T value;
+		deviceQueue.memcpy(&value, totals + SCAN_MAX_GROUPS, sizeof(T), last).wait();
+		return value;
+	}
+
+	// the last pass of the latest scan on this workspace, the next scan depends on it
+	cl::sycl::event last_event() const { return last; }
+	void set_last_event(cl::sycl::event scanEvent) { last = scanEvent; }
+
+private:
+	cl::sycl::queue deviceQueue;
+	T* totals;
+	cl::sycl::event last;
+};
+
+// how the input is split: groups work groups with chunk elements each (the last one may have fewer),
+// chunk is a whole number of tiles
+struct ScanLayout {
+	size_t groups;
+	size_t chunk;
+};
+
+inline ScanLayout scan_layout(size_t n, size_t workGroupSize) {
+	size_t tile = workGroupSize * SCAN_ITEMS_PER_WORK_ITEM;
+	size_t tiles = n > 0 ? (n + tile - 1) / tile : 1;
+	size_t tilesPerGroup = (tiles + SCAN_MAX_GROUPS - 1) / SCAN_MAX_GROUPS;
+	size_t chunk = tilesPerGroup * tile;
+	return { n > 0 ? (n + chunk - 1) / chunk : 1, chunk };
+}
+
+// scan elements begin to end with the whole work group, starting from carry, and return the carry after the last element
+// map(i) gives element i, write(i, prefix, value) gets the exclusive prefix of element i and its value
+// tile is local memory for work group size * SCAN_ITEMS_PER_WORK_ITEM elements
+// every work item of the group has to call it with the same begin and end
+template <typename T, typename Op, typename Map, typename Write, typename Tile>
+T scan_range(const cl::sycl::nd_item<1>& item, size_t begin, size_t end, T carry, Op op, const Map& map, const Write& write, const Tile& tile) {
+	auto group = item.get_group();
+	size_t workGroupSize = item.get_local_range(0);
+	size_t localId = item.get_local_id(0);
+	size_t first = localId * SCAN_ITEMS_PER_WORK_ITEM;
+	for (size_t tileBegin = begin; tileBegin < end; tileBegin += workGroupSize * SCAN_ITEMS_PER_WORK_ITEM) {
+		// striped load, element k * workGroupSize + localId of the tile, kept in registers for the write
+		T striped[SCAN_ITEMS_PER_WORK_ITEM];
+		for (size_t k = 0; k < SCAN_ITEMS_PER_WORK_ITEM; k++) {
+			size_t i = tileBegin + k * workGroupSize + localId;
+			striped[k] = i < end ? map(i) : cl::sycl::known_identity_v<Op, T>;
+			tile[k * workGroupSize + localId] = striped[k];
+		}
+		cl::sycl::group_barrier(group);
+
+		// every work item scans its consecutive elements
+		T values[SCAN_ITEMS_PER_WORK_ITEM];
+		T sum = cl::sycl::known_identity_v<Op, T>;
+		for (size_t k = 0; k < SCAN_ITEMS_PER_WORK_ITEM; k++) {
+			values[k] = tile[first + k];
+			sum = op(sum, values[k]);
+		}
+		T prefix = cl::sycl::exclusive_scan_over_group(group, sum, op);
+		T running = op(carry, prefix);
+		cl::sycl::group_barrier(group);
+		for (size_t k = 0; k < SCAN_ITEMS_PER_WORK_ITEM; k++) {
+			tile[first + k] = running;
+			running = op(running, values[k]);
+		}
+		cl::sycl::group_barrier(group);
+
+		// striped write, with the prefixes read back in the order of the load
+		for (size_t k = 0; k < SCAN_ITEMS_PER_WORK_ITEM; k++) {
+			size_t i = tileBegin + k * workGroupSize + localId;
+			if (i < end) {
+				write(i, tile[k * workGroupSize + localId], striped[k]);
+			}
+		}
+		// the last work item's prefix plus its sum is the total of the tile
+		carry = op(carry, cl::sycl::group_broadcast(group, op(prefix, sum), workGroupSize - 1));
+		// the next tile overwrites the local memory only after every work item has read its prefixes
+		cl::sycl::group_barrier(group);
+	}
+	return carry;
+}
+
+// the three passes for n elements, the scan of element i starts from init
+template <typename T, typename Op, typename Map, typename Write>
+std::vector<cl::sycl::event> scan_passes(cl::sycl::queue& deviceQueue, size_t n, size_t workGroupSize, T init, Op op, Map map, Write write,
+		ScanWorkspace<T>& workspace, const std::vector<cl::sycl::event>& dependencies) {
+	ScanLayout layout = scan_layout(n, workGroupSize);
+	size_t chunk = layout.chunk;
+	size_t tileSize = workGroupSize * SCAN_ITEMS_PER_WORK_ITEM;
+	T* totals = workspace.data();
+	cl::sycl::nd_range<1> groupsRange{ cl::sycl::range<1>{ layout.groups * workGroupSize }, cl::sycl::range<1>{ workGroupSize } };
+
+	// 1. one total per chunk
+	auto reduceEvent = deviceQueue.submit([&](cl::sycl::handler& queueHandler) {
+		queueHandler.depends_on(dependencies);
+		queueHandler.depends_on(workspace.last_event());
+		queueHandler.parallel_for(groupsRange, [=](cl::sycl::nd_item<1> item) {
+			size_t begin = item.get_group(0) * chunk;
+			size_t end = cl::sycl::min(begin + chunk, n);
+			T sum = cl::sycl::known_identity_v<Op, T>;
+			for (size_t i = begin + item.get_local_id(0); i < end; i += item.get_local_range(0)) {
+				sum = op(sum, map(i));
+			}
+			T total = cl::sycl::reduce_over_group(item.get_group(), sum, op);
+			if (item.get_local_id(0) == 0) {
+				totals[item.get_group(0)] = total;
+			}
+		});
+	});
+
+	// 2. exclusive scan of the totals in place, and the total of everything after them
+	size_t groups = layout.groups;
+	auto totalsEvent = deviceQueue.submit([&](cl::sycl::handler& queueHandler) {
+		queueHandler.depends_on(reduceEvent);
+		cl::sycl::local_accessor<T, 1> tile(cl::sycl::range<1>{ tileSize }, queueHandler);
+		cl::sycl::nd_range<1> oneGroup{ cl::sycl::range<1>{ workGroupSize }, cl::sycl::range<1>{ workGroupSize } };
+		queueHandler.parallel_for(oneGroup, [=](cl::sycl::nd_item<1> item) {
+			T total = scan_range(item, 0, groups, cl::sycl::known_identity_v<Op, T>, op,
+				[=](size_t i) { return totals[i]; },
+				[=](size_t i, T prefix, T) { totals[i] = prefix; }, tile);
+			if (item.get_local_id(0) == 0) {
+				totals[SCAN_MAX_GROUPS] = total;
+			}
+		});
+	});
+
+	// 3. every chunk scanned from init and the totals of the chunks before it
+	auto scanEvent = deviceQueue.submit([&](cl::sycl::handler& queueHandler) {
+		queueHandler.depends_on(totalsEvent);
+		cl::sycl::local_accessor<T, 1> tile(cl::sycl::range<1>{ tileSize }, queueHandler);
+		queueHandler.parallel_for(groupsRange, [=](cl::sycl::nd_item<1> item) {
+			size_t begin = item.get_group(0) * chunk;
+			size_t end = cl::sycl::min(begin + chunk, n);
+			scan_range(item, begin, end, op(init, totals[item.get_group(0)]), op, map, write, tile);
+		});
+	});
+	workspace.set_last_event(scanEvent);
+	return { reduceEvent, totalsEvent, scanEvent };
+}
+
+// out[i] = init op in[0] op ... op in[i - 1], in and out may be the same
+template <typename T, typename Op = cl::sycl::plus<T>>
+std::vector<cl::sycl::event> device_exclusive_scan(cl::sycl::queue& deviceQueue, const T* in, T* out, size_t n, T init, ScanWorkspace<T>& workspace,
+		size_t workGroupSize = SCAN_WORKGROUP_SIZE, const std::vector<cl::sycl::event>& dependencies = {}) {
+	return scan_passes(deviceQueue, n, workGroupSize, init, Op{},
+		[=](size_t i) { return in[i]; },
+		[=](size_t i, T prefix, T) { out[i] = prefix; },
+		workspace, dependencies);
+}
+
+// out[i] = in[0] op ... op in[i], in and out may be the same
+template <typename T, typename Op = cl::sycl::plus<T>>
+std::vector<cl::sycl::event> device_inclusive_scan(cl::sycl::queue& deviceQueue, const T* in, T* out, size_t n, ScanWorkspace<T>& workspace,
+		size_t workGroupSize = SCAN_WORKGROUP_SIZE, const std::vector<cl::sycl::event>& dependencies = {}) {
+	Op op;
+	return scan_passes(deviceQueue, n, workGroupSize, cl::sycl::known_identity_v<Op, T>, op,
+		[=](size_t i) { return in[i]; },
+		[=](size_t i, T prefix, T value) { out[i] = op(prefix, value); },
+		workspace, dependencies);
+}
+
+// stream compaction: the elements for which predicate is true, in their order, to the front of out,
+// the exclusive scan of the 0/1 predicate values is the position of every kept element
+// the number of kept elements is workspace.total() once the events have completed
+// out must not overlap in, a group may write into a chunk that another group has not read yet
+template <typename T, typename Predicate>
+std::vector<cl::sycl::event> device_copy_if(cl::sycl::queue& deviceQueue, const T* in, T* out, size_t n, Predicate predicate,
+		ScanWorkspace<uint32_t>& workspace, size_t workGroupSize = SCAN_WORKGROUP_SIZE, const std::vector<cl::sycl::event>& dependencies = {}) {
+	return scan_passes(deviceQueue, n, workGroupSize, 0u, cl::sycl::plus<uint32_t>{},
+		[=](size_t i) { return predicate(in[i]) ? 1u : 0u; },
+		[=](size_t i, uint32_t position, uint32_t keep) {
+			if (keep) {
+				out[position] = in[i];
+			}
+		},
+		workspace, dependencies);
+}
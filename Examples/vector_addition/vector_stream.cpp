@@ -0,0 +1,302 @@
+#include <CL/sycl.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <iomanip>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// default values, each one can be changed from the command line
+#define ARRAY_SIZE (32 * 1024 * 1024)
+#define STREAM_ITERATIONS 10
+#define STREAM_SCALAR 3
+
+// the four STREAM kernels (McCalpin): Copy c = a, Scale b = s * c, Add c = a + b, Triad a = b + s * c
+enum StreamKernel { COPY, SCALE, ADD, TRIAD, NUM_KERNELS };
+static const char* kernelNames[NUM_KERNELS] = { "Copy", "Scale", "Add", "Triad" };
+// arrays read and written per element by every kernel
+static const int kernelArrays[NUM_KERNELS] = { 2, 2, 3, 3 };
+
+// the allocation kinds that are compared
+// shared+advise applies the device specific mem_advise value before the prefetch, and only runs when one is given
+static const std::vector<std::string> memoryKinds{ "buffer", "device", "shared", "shared+prefetch", "shared+advise", "host" };
+
+struct StreamResult {
+	std::string device;
+	std::string memory;
+	std::string type;
+	double first[NUM_KERNELS];     // GB/s of the first iteration, with JIT compilation and data that moves on first use
+	double best[NUM_KERNELS];      // GB/s of the fastest iteration after the first
+	double average[NUM_KERNELS];   // GB/s over the iterations after the first, like STREAM
+	bool valid;
+};
+
+// run the four kernels in order for every iteration, submit launches one kernel and returns its event
+// every kernel is timed on the host from submission to completion, like STREAM, so data that moves on first use
+// (shared allocations) is part of the time
+static std::vector<std::vector<double>> time_kernels(size_t iterations, const std::function<cl::sycl::event(int)>& submit) {
+	std::vector<std::vector<double>> times(NUM_KERNELS);
+	for (size_t iter = 0; iter < iterations; iter++) {
+		for (int k = 0; k < NUM_KERNELS; k++) {
+			auto start = std::chrono::high_resolution_clock::now();
+			submit(k).wait();
+			auto stop = std::chrono::high_resolution_clock::now();
+			times[k].push_back(std::chrono::duration<double>(stop - start).count());
+		}
+	}
+	return times;
+}
+
+// the kernels on plain pointers, used by every USM kind
+template <typename T>
+static cl::sycl::event submit_usm(cl::sycl::queue& deviceQueue, int kernel, T* a, T* b, T* c, size_t n) {
+	T scalar = STREAM_SCALAR;
+	cl::sycl::range<1> itemRange{ n };
+	switch (kernel) {
+	case COPY: return deviceQueue.parallel_for(itemRange, [=](cl::sycl::id<1> i) { c[i] = a[i]; });
+	case SCALE: return deviceQueue.parallel_for(itemRange, [=](cl::sycl::id<1> i) { b[i] = scalar * c[i]; });
+	case ADD: return deviceQueue.parallel_for(itemRange, [=](cl::sycl::id<1> i) { c[i] = a[i] + b[i]; });
+	default: return deviceQueue.parallel_for(itemRange, [=](cl::sycl::id<1> i) { a[i] = b[i] + scalar * c[i]; });
+	}
+}
+
+// the same kernels on buffers through accessors
+template <typename T>
+static cl::sycl::event submit_buffer(cl::sycl::queue& deviceQueue, int kernel, cl::sycl::buffer<T, 1>& aBuffer, cl::sycl::buffer<T, 1>& bBuffer,
+		cl::sycl::buffer<T, 1>& cBuffer) {
+	T scalar = STREAM_SCALAR;
+	return deviceQueue.submit([&](cl::sycl::handler& queueHandler) {
+		cl::sycl::range<1> itemRange = aBuffer.get_range();
+		if (kernel == COPY) {
+			cl::sycl::accessor a(aBuffer, queueHandler, cl::sycl::read_only);
+			cl::sycl::accessor c(cBuffer, queueHandler, cl::sycl::write_only, cl::sycl::no_init);
+			queueHandler.parallel_for(itemRange, [=](cl::sycl::id<1> i) { c[i] = a[i]; });
+		}
+		else if (kernel == SCALE) {
+			cl::sycl::accessor c(cBuffer, queueHandler, cl::sycl::read_only);
+			cl::sycl::accessor b(bBuffer, queueHandler, cl::sycl::write_only, cl::sycl::no_init);
+			queueHandler.parallel_for(itemRange, [=](cl::sycl::id<1> i) { b[i] = scalar * c[i]; });
+		}
+		else if (kernel == ADD) {
+			cl::sycl::accessor a(aBuffer, queueHandler, cl::sycl::read_only);
+			cl::sycl::accessor b(bBuffer, queueHandler, cl::sycl::read_only);
+			cl::sycl::accessor c(cBuffer, queueHandler, cl::sycl::write_only, cl::sycl::no_init);
+			queueHandler.parallel_for(itemRange, [=](cl::sycl::id<1> i) { c[i] = a[i] + b[i]; });
+		}
+		else {
+			cl::sycl::accessor b(bBuffer, queueHandler, cl::sycl::read_only);
+			cl::sycl::accessor c(cBuffer, queueHandler, cl::sycl::read_only);
+			cl::sycl::accessor a(aBuffer, queueHandler, cl::sycl::write_only, cl::sycl::no_init);
+			queueHandler.parallel_for(itemRange, [=](cl::sycl::id<1> i) { a[i] = b[i] + scalar * c[i]; });
+		}
+	});
+}
+
+// the arrays start as a = 1, b = 2, c = 0, every element goes through the same steps, so one scalar per array
+// predicts the final values, a grows by 15 per iteration
+struct StreamExpected {
+	double a, b, c;
+};
+
+static StreamExpected expected_arrays(size_t iterations) {
+	StreamExpected expected{ 1.0, 2.0, 0.0 };
+	double scalar = STREAM_SCALAR;
+	for (size_t iter = 0; iter < iterations; iter++) {
+		expected.c = expected.a;
+		expected.b = scalar * expected.c;
+		expected.c = expected.a + expected.b;
+		expected.a = expected.b + scalar * expected.c;
+	}
+	return expected;
+}
+
+// a small relative error is allowed since the device may contract a + s * c into an fma,
+// values that are not finite fail, inf - inf is NaN and would otherwise pass every comparison
+template <typename T>
+static bool check_arrays(const T* a, const T* b, const T* c, size_t n, size_t iterations) {
+	StreamExpected expected = expected_arrays(iterations);
+	double epsilon = std::is_same_v<T, double> ? 1e-12 : 1e-5;
+	for (size_t i = 0; i < n; i++) {
+		if (!std::isfinite(a[i]) || !std::isfinite(b[i]) || !std::isfinite(c[i])
+			|| std::abs(a[i] - expected.a) > epsilon * expected.a || std::abs(b[i] - expected.b) > epsilon * expected.b
+			|| std::abs(c[i] - expected.c) > epsilon * expected.c) {
+			return false;
+		}
+	}
+	return true;
+}
+
+// run the suite with one allocation kind on one device
+template <typename T>
+static StreamResult run_memory(cl::sycl::queue& deviceQueue, const std::string& memory, size_t n, size_t iterations, int advice) {
+	// the values grow by 15 per iteration, past the largest T they are inf and nothing can be checked
+	if (!(expected_arrays(iterations).a <= std::numeric_limits<T>::max())) {
+		throw std::invalid_argument(std::to_string(iterations) + " iterations overflow " + (std::is_same_v<T, double> ? "double" : "float"));
+	}
+	std::vector<std::vector<double>> times;
+	bool valid = false;
+
+	if (memory == "buffer") {
+		std::vector<T> a(n, T(1)), b(n, T(2)), c(n, T(0));
+		{
+			cl::sycl::buffer<T, 1> aBuffer(a.data(), cl::sycl::range<1>{ n });
+			cl::sycl::buffer<T, 1> bBuffer(b.data(), cl::sycl::range<1>{ n });
+			cl::sycl::buffer<T, 1> cBuffer(c.data(), cl::sycl::range<1>{ n });
+			times = time_kernels(iterations, [&](int kernel) { return submit_buffer(deviceQueue, kernel, aBuffer, bBuffer, cBuffer); });
+		}
+		valid = check_arrays(a.data(), b.data(), c.data(), n, iterations);
+	}
+	else {
+		// device memory is filled on the device, shared and host memory are filled on the host, so shared pages start out on the host
+		T* arrays[3];
+		for (int array = 0; array < 3; array++) {
+			if (memory == "device") {
+				arrays[array] = cl::sycl::malloc_device<T>(n, deviceQueue);
+			}
+			else if (memory == "host") {
+				arrays[array] = cl::sycl::malloc_host<T>(n, deviceQueue);
+			}
+			else {
+				arrays[array] = cl::sycl::malloc_shared<T>(n, deviceQueue);
+			}
+			if (!arrays[array]) {
+				for (int i = 0; i < array; i++) {
+					cl::sycl::free(arrays[i], deviceQueue);
+				}
+				throw std::runtime_error("cannot allocate " + memory + " memory");
+			}
+		}
+		T* a = arrays[0];
+		T* b = arrays[1];
+		T* c = arrays[2];
+		if (memory == "device") {
+			deviceQueue.fill(a, T(1), n);
+			deviceQueue.fill(b, T(2), n);
+			deviceQueue.fill(c, T(0), n);
+		}
+		else {
+			std::fill(a, a + n, T(1));
+			std::fill(b, b + n, T(2));
+			std::fill(c, c + n, T(0));
+		}
+
+		// move the shared pages to the device before the first kernel instead of on demand, advice values are device specific
+		if (memory == "shared+prefetch" || memory == "shared+advise") {
+			for (T* array : arrays) {
+				if (memory == "shared+advise") {
+					deviceQueue.mem_advise(array, n * sizeof(T), advice);
+				}
+				deviceQueue.prefetch(array, n * sizeof(T));
+			}
+		}
+		deviceQueue.wait();
+
+		times = time_kernels(iterations, [&](int kernel) { return submit_usm(deviceQueue, kernel, a, b, c, n); });
+
+		if (memory == "device") {
+			std::vector<T> aHost(n), bHost(n), cHost(n);
+			deviceQueue.memcpy(aHost.data(), a, n * sizeof(T));
+			deviceQueue.memcpy(bHost.data(), b, n * sizeof(T));
+			deviceQueue.memcpy(cHost.data(), c, n * sizeof(T));
+			deviceQueue.wait();
+			valid = check_arrays(aHost.data(), bHost.data(), cHost.data(), n, iterations);
+		}
+		else {
+			valid = check_arrays(a, b, c, n, iterations);
+		}
+		for (T* array : arrays) {
+			cl::sycl::free(array, deviceQueue);
+		}
+	}
+
+	StreamResult result;
+	result.memory = memory;
+	result.valid = valid;
+	for (int k = 0; k < NUM_KERNELS; k++) {
+		double bytes = static_cast<double>(kernelArrays[k]) * n * sizeof(T);
+		// the first iteration is reported on its own, best and average use the rest when there is more than one
+		auto steady = times[k].size() > 1 ? times[k].begin() + 1 : times[k].begin();
+		double best = *std::min_element(steady, times[k].end());
+		double total = 0.0;
+		for (auto time = steady; time != times[k].end(); ++time) {
+			total += *time;
+		}
+		result.first[k] = bytes / times[k].front() / 1.0e9;
+		result.best[k] = bytes / best / 1.0e9;
+		result.average[k] = bytes / (total / (times[k].end() - steady)) / 1.0e9;
+	}
+	return result;
+}
+
+// whether a device can allocate the memory kind, buffers work everywhere
+static bool supports_memory(const cl::sycl::device& offloadDevice, const std::string& memory) {
+	if (memory == "device") return offloadDevice.has(cl::sycl::aspect::usm_device_allocations);
+	if (memory == "host") return offloadDevice.has(cl::sycl::aspect::usm_host_allocations);
+	if (memory == "shared" || memory == "shared+prefetch" || memory == "shared+advise") return offloadDevice.has(cl::sycl::aspect::usm_shared_allocations);
+	return true;
+}
+
+int main(int argc, char* argv[]) {
+
+	// optional arguments: array size, iterations, and a device specific mem_advise value for shared+advise
+	size_t arraySize = argc > 1 ? std::stoul(argv[1]) : ARRAY_SIZE;
+	size_t iterations = argc > 2 ? std::stoul(argv[2]) : STREAM_ITERATIONS;
+	int advice = argc > 3 ? std::stoi(argv[3]) : -1;
+	if (arraySize == 0 || iterations == 0) {
+		std::cout << "Usage: " << argv[0] << " [array size] [iterations] [mem_advise value], sizes at least 1\n";
+		return -1;
+	}
+
+	std::cout << "Running STREAM kernels...\n"
+		<< "Array size: " << arraySize << ", iterations: " << iterations << std::endl;
+
+	std::vector<StreamResult> results;
+	for (auto& offloadDevice : cl::sycl::device::get_devices()) {
+		std::string deviceName = offloadDevice.get_info<cl::sycl::info::device::name>();
+		cl::sycl::queue deviceQueue(offloadDevice);
+
+		// STREAM uses double, devices without fp64 run float
+		bool fp64 = offloadDevice.has(cl::sycl::aspect::fp64);
+		std::cout << "Running on " << deviceName << " (" << (fp64 ? "double" : "float") << ")\n";
+
+		for (auto& memory : memoryKinds) {
+			if (!supports_memory(offloadDevice, memory)) {
+				std::cout << "  skipping " << memory << ": not supported\n";
+				continue;
+			}
+			if (memory == "shared+advise" && advice < 0) {
+				std::cout << "  skipping " << memory << ": mem_advise values are device specific, pass one as the third argument\n";
+				continue;
+			}
+			try {
+				StreamResult result = fp64 ? run_memory<double>(deviceQueue, memory, arraySize, iterations, advice)
+					: run_memory<float>(deviceQueue, memory, arraySize, iterations, advice);
+				result.device = deviceName;
+				result.type = fp64 ? "double" : "float";
+				results.push_back(result);
+			}
+			catch (const std::exception& e) {
+				std::cout << "  skipping " << memory << ": " << e.what() << "\n";
+			}
+		}
+	}
+
+	// the first iteration carries JIT compilation, the buffer copies to the device and data that moves on first use,
+	// so it has its own column and best and average are the steady state of the remaining iterations
+	std::cout << "\n" << std::left << std::setw(40) << "device" << std::setw(18) << "memory" << std::setw(8) << "kernel"
+		<< std::right << std::setw(12) << "first GB/s" << std::setw(12) << "best GB/s" << std::setw(12) << "avg GB/s" << "  check\n";
+	bool allValid = true;
+	for (auto& result : results) {
+		for (int k = 0; k < NUM_KERNELS; k++) {
+			std::cout << std::left << std::setw(40) << result.device.substr(0, 39) << std::setw(18) << result.memory << std::setw(8) << kernelNames[k]
+				<< std::right << std::fixed << std::setprecision(1) << std::setw(12) << result.first[k] << std::setw(12) << result.best[k] << std::setw(12) << result.average[k]
+				<< "  " << (result.valid ? "ok" : "FAILED") << "\n";
+		}
+		allValid = allValid && result.valid;
+	}
+	return allValid ? 0 : -1;
+}